@@ -0,0 +1,26 @@
+
+#ifndef ASTEROID_H
+#define ASTEROID_H
+
+#include <celestial/CelestialBody.h>
+
+namespace SolarSystem {
+
+	class Asteroid : public CelestialBody {
+
+		// Minor body such as an asteroid or comet nucleus. Catalogs hold these by the million and each is at most a
+		// few pixels wide on screen, so they are tessellated far more coarsely than planets.
+
+	public:
+
+		Asteroid(double mass, const Utilities::Vector& velocity, double radius, std::string name, const Utilities::Vector& position, double angularVelocity)
+			: CelestialBody(mass, velocity, radius, std::move(name), position, angularVelocity, 12, 6) {}
+
+		glm::vec3 getColor() const override {
+			return glm::vec3(0.6f, 0.58f, 0.55f);
+		}
+
+	};
+}
+
+#endif
@@ -0,0 +1,78 @@
+
+#ifndef BODYARENA_H
+#define BODYARENA_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <celestial/CelestialBody.h>
+#include <utils/MemoryArena.h>
+
+namespace SolarSystem {
+
+	class BodyArena;
+
+	// Destroys a body and hands its storage back to the arena it came from. Bodies created elsewhere carry no arena
+	// and are deleted normally, so heap allocated bodies can still be added to a model.
+	struct BodyDeleter {
+		BodyArena* arena = nullptr;
+		std::size_t size = 0;
+
+		void operator()(CelestialBody* body) const;
+	};
+
+	using BodyPointer = std::unique_ptr<CelestialBody, BodyDeleter>;
+
+	class BodyArena {
+
+		// Pooled storage for the polymorphic celestial bodies owned by a model. Bodies are placed into large blocks,
+		// so loading a big catalog costs a few allocations instead of one per body, and the storage of removed bodies
+		// is reused by the next body of the same size.
+
+	public:
+
+		template <typename T, typename... Args>
+		BodyPointer create(Args&&... args) {
+			static_assert(std::is_base_of<CelestialBody, T>::value, "Body arenas only hold celestial bodies.");
+
+			void* memory = this->pool.allocate(sizeof(T));
+			T* body;
+			try {
+				body = new (memory) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				this->pool.deallocate(memory, sizeof(T));
+				throw;
+			}
+			++this->liveCount;
+			return BodyPointer(body, BodyDeleter{ this, sizeof(T) });
+		}
+
+		// Makes room for count bodies of type T in a single block
+		template <typename T>
+		void reserve(std::size_t count) {
+			this->pool.reserve(count * sizeof(T) + count * alignof(std::max_align_t));
+		}
+
+		inline std::size_t getLiveCount() const {
+			return this->liveCount;
+		}
+
+		inline std::size_t getCapacity() const {
+			return this->pool.getCapacity();
+		}
+
+	private:
+
+		friend struct BodyDeleter;
+
+		Utilities::MemoryPool pool;
+		std::size_t liveCount = 0;
+
+		void destroy(CelestialBody* body, std::size_t size);
+	};
+}
+
+#endif
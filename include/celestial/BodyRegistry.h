@@ -0,0 +1,105 @@
+
+#ifndef BODYREGISTRY_H
+#define BODYREGISTRY_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <celestial/CelestialBody.h>
+#include <celestial/BodyArena.h>
+#include <utils/MemoryArena.h>
+
+namespace SolarSystem {
+
+	// Stable reference to a body. A handle outlives the body it names and simply stops resolving once the body is
+	// removed, even if its slot has been reused by a newer body since.
+	struct BodyHandle {
+		std::uint32_t slot = INVALID_SLOT;
+		std::uint32_t generation = 0;
+
+		static constexpr std::uint32_t INVALID_SLOT = 0xffffffffu;
+
+		inline bool isNull() const {
+			return this->slot == INVALID_SLOT;
+		}
+
+		inline bool operator==(const BodyHandle& other) const {
+			return this->slot == other.slot && this->generation == other.generation;
+		}
+
+		inline bool operator!=(const BodyHandle& other) const {
+			return !(*this == other);
+		}
+	};
+
+	class BodyRegistry {
+
+		// Generational slot map owning the celestial bodies. Bodies are kept densely packed so the simulation loops
+		// can walk them by index, while handles go through a slot table that follows every move. Removal swaps the
+		// last body into the hole, so both add and remove are O(1) and the dense index of at most one other body
+		// changes. Freed slots are reused with a bumped generation, invalidating every old handle to them.
+
+	public:
+
+		// Result of a removal, so owners of per-body columns can apply the same swap
+		struct Removal {
+			std::size_t removedIndex;				// Dense index the body occupied
+			std::size_t movedFromIndex;				// Old dense index of the body now at removedIndex, equal to removedIndex when nothing moved
+			BodyPointer body;
+		};
+
+		BodyHandle add(BodyPointer body);
+
+		// Throws when the handle does not resolve
+		Removal remove(BodyHandle handle);
+
+		void reserve(std::size_t capacity);
+
+		bool contains(BodyHandle handle) const;
+
+		// Returns nullptr for stale or null handles
+		CelestialBody* get(BodyHandle handle) const;
+
+		std::optional<std::size_t> indexOf(BodyHandle handle) const;
+
+		std::optional<BodyHandle> find(const std::string& name) const;
+
+		inline BodyHandle handleAt(std::size_t denseIndex) const {
+			return BodyHandle{ this->denseSlots[denseIndex], this->slots[this->denseSlots[denseIndex]].generation };
+		}
+
+		inline const std::vector<BodyPointer>& getBodies() const {
+			return this->bodies;
+		}
+
+		inline std::size_t size() const {
+			return this->bodies.size();
+		}
+
+	private:
+
+		struct Slot {
+			std::uint32_t generation = 0;
+			std::uint32_t denseIndex = BodyHandle::INVALID_SLOT;	// INVALID_SLOT while the slot is free
+			std::uint32_t nextFree = BodyHandle::INVALID_SLOT;
+		};
+
+		std::vector<BodyPointer> bodies;			// Dense, in body store order
+		std::vector<std::uint32_t> denseSlots;		// Slot of every dense entry
+		std::vector<Slot> slots;
+		std::uint32_t firstFreeSlot = BodyHandle::INVALID_SLOT;
+
+		using NameIndex = std::unordered_map<std::string, BodyHandle, std::hash<std::string>, std::equal_to<std::string>,
+			Utilities::PoolAllocator<std::pair<const std::string, BodyHandle>>>;
+
+		Utilities::MemoryPool nameNodePool{ 64 * 1024 };
+		NameIndex nameIndex{ 0, std::hash<std::string>(), std::equal_to<std::string>(), NameIndex::allocator_type(nameNodePool) };
+	};
+}
+
+#endif
@@ -0,0 +1,124 @@
+
+#ifndef BODYSTORE_H
+#define BODYSTORE_H
+
+#include <vector>
+#include <cstddef>
+#include <utils/Vector.h>
+
+namespace SolarSystem {
+
+	class AccelerationHistory {
+
+		// Per-body ring buffer of past accelerations used by multistep integrators. Every body owns a contiguous
+		// block of `depth` slots and all blocks share a single head, so pushing a new step never moves data.
+
+	public:
+
+		void setDepth(std::size_t depth);
+
+		// Room for capacity bodies at the current depth and any depth set later
+		void reserve(std::size_t capacity);
+
+		void addBody();
+
+		void removeBody(std::size_t bodyIndex);
+
+		// Forgets every stored step while keeping the allocation
+		inline void reset() {
+			this->count = 0;
+		}
+
+		// Stores one acceleration per body as the newest entry, overwriting the oldest once the ring is full
+		void push(const std::vector<Utilities::Vector>& accelerations);
+
+		// age 0 is the newest entry, age count - 1 the oldest still stored
+		inline const Utilities::Vector& get(std::size_t bodyIndex, std::size_t age) const {
+			std::size_t slot = (this->head + this->depth - age) % this->depth;
+			return this->slots[bodyIndex * this->depth + slot];
+		}
+
+		inline std::size_t getCount() const {
+			return this->count;
+		}
+
+		inline std::size_t getDepth() const {
+			return this->depth;
+		}
+
+		inline std::size_t getHead() const {
+			return this->head;
+		}
+
+		// Raw ring storage, for checkpoints
+		inline const std::vector<Utilities::Vector>& getSlots() const {
+			return this->slots;
+		}
+
+		// Puts back storage taken with getSlots, the depth and body count must already match
+		void restore(std::size_t head, std::size_t count, const std::vector<Utilities::Vector>& slots);
+
+	private:
+
+		std::vector<Utilities::Vector> slots;		// bodyCount * depth accelerations, body major
+		std::size_t bodyCount = 0;
+		std::size_t reservedBodies = 0;
+		std::size_t depth = 0;
+		std::size_t head = 0;						// Slot holding the newest entry
+		std::size_t count = 0;						// Number of valid entries, at most depth
+	};
+
+	class BodyStore {
+
+		// Per-body simulation state that lives outside the CelestialBody objects. Entries are indexed in the same
+		// order as the model's BodyRegistry and are kept in step with it on every add and remove.
+		// The force kernels work purely in accelerations, so every body carries its cached gravitational
+		// parameter mu = G * m and the net acceleration from the last force evaluation.
+
+	public:
+
+		void addBody(double gravitationalParameter);
+
+		void reserve(std::size_t capacity);
+
+		// Moves the last body into bodyIndex, the same swap BodyRegistry::remove performs
+		void removeBody(std::size_t bodyIndex);
+
+		inline std::size_t size() const {
+			return this->bodyCount;
+		}
+
+		inline double getGravitationalParameter(std::size_t bodyIndex) const {
+			return this->gravitationalParameters[bodyIndex];
+		}
+
+		inline const std::vector<double>& getGravitationalParameters() const {
+			return this->gravitationalParameters;
+		}
+
+		inline std::vector<Utilities::Vector>& getAccelerations() {
+			return this->accelerations;
+		}
+
+		inline const std::vector<Utilities::Vector>& getAccelerations() const {
+			return this->accelerations;
+		}
+
+		inline AccelerationHistory& getAccelerationHistory() {
+			return this->accelerationHistory;
+		}
+
+		inline const AccelerationHistory& getAccelerationHistory() const {
+			return this->accelerationHistory;
+		}
+
+	private:
+
+		std::size_t bodyCount = 0;
+		std::vector<double> gravitationalParameters;		// mu = G * m in km^3 s^-2
+		std::vector<Utilities::Vector> accelerations;		// Net acceleration in km s^-2
+		AccelerationHistory accelerationHistory;
+	};
+}
+
+#endif
@@ -4,12 +4,16 @@
 
 #include <string>
 #include <vector>
+#ifndef SOLAR_SYSTEM_HEADLESS
 #include <GL/glew.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#ifndef SOLAR_SYSTEM_HEADLESS
 #include <utils/GeometryManager.h>
+#endif
 #include<utils/Vector.h>
 
 namespace SolarSystem {
@@ -28,6 +32,11 @@ namespace SolarSystem {
 				geometryID(0), numIndices(0) 
 		{}
 
+		// A copy would release the shared mesh reference a second time when destroyed
+		CelestialBody(const CelestialBody&) = delete;
+
+		CelestialBody& operator=(const CelestialBody&) = delete;
+
 		inline double getMass() const {
 			return this->mass;
 		}
@@ -36,7 +45,7 @@ namespace SolarSystem {
 			return this->radius;
 		}
 
-		inline Utilities::Vector getVelocity() const {
+		inline const Utilities::Vector& getVelocity() const {
 			return this->velocity;
 		}
 
@@ -64,11 +73,37 @@ namespace SolarSystem {
 			this->angularVelocity = omega;
 		}
 
+		inline unsigned int getLongitudeSegments() const {
+			return this->longitudeSegments;
+		}
+
+		inline unsigned int getLatitudeSegments() const {
+			return this->latitudeSegments;
+		}
+
+#ifndef SOLAR_SYSTEM_HEADLESS
+		inline bool hasGraphics() const {
+			return this->geometryID != 0;
+		}
+
+		// Unit sphere mesh the body is drawn with, scaled by the radius per instance
+		inline Utilities::GeometryManager::GeometryData getGeometry() const {
+			return Utilities::GeometryManager::GeometryData{ this->geometryID, this->numIndices };
+		}
+
+		// Takes a reference to the cached unit sphere matching the body's tessellation, released with the body
 		virtual void initializeGraphics(Utilities::GeometryManager& geomManager);
+#endif
 
-		virtual void draw(GLuint shaderProgram);
+		// Model matrix placing the unit sphere mesh at the body's position and size
+		glm::mat4 getModelMatrix() const;
 
-		virtual ~CelestialBody() = default;
+		virtual glm::vec3 getColor() const {
+			return glm::vec3(0.55f, 0.7f, 1.0f);
+		}
+
+		// Releases the body's mesh, so a body with graphics must be destroyed while its GL context is current
+		virtual ~CelestialBody();
 
 	private:
 
@@ -82,8 +117,6 @@ namespace SolarSystem {
 		unsigned int numIndices;
 		unsigned int longitudeSegments;
 		unsigned int latitudeSegments;
-
-		void generateSphereData(std::vector<float>& vertices, std::vector<unsigned int>& indices);
 	};
 }
 
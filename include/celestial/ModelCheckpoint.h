@@ -0,0 +1,69 @@
+
+#ifndef MODELCHECKPOINT_H
+#define MODELCHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utils/Vector.h>
+
+namespace SolarSystem {
+
+	enum class IntegrationMethod {
+		Kinematic,					// Score based force reuse followed by a constant acceleration update
+		AdamsBashforthMoulton		// Multistep predictor-corrector with one exact force evaluation per step
+	};
+
+	// Same values as Utilities::CatalogBodyType, so catalogs and checkpoints agree on what a type number means
+	enum class CheckpointBodyType : std::uint8_t {
+		Star = 0,
+		Planet = 1,
+		Asteroid = 2
+	};
+
+	struct ModelCheckpoint {
+
+		// Everything SolarSystemModel::advance carries from one step to the next, as plain arrays. Restoring it into an
+		// empty model continues the run bit for bit, including the pair scores and couplings of the kinematic
+		// integrator, the multistep acceleration history and the close encounter grouping. Body handles are not part
+		// of it, the restored bodies get new ones.
+
+		double simulationTime = 0.0;						// Not used by the model, kept for the caller's clock
+
+		// Bodies in body store order
+		std::vector<CheckpointBodyType> bodyTypes;
+		std::vector<std::string> names;
+		std::vector<double> masses;
+		std::vector<double> radii;
+		std::vector<double> angularVelocities;
+		std::vector<double> luminosities;					// Stars only, zero for every other body
+		std::vector<double> surfaceTemperatures;
+		std::vector<Utilities::Vector> positions;
+		std::vector<Utilities::Vector> velocities;
+		std::vector<Utilities::Vector> accelerations;
+
+		// Pair table in pair index order, empty for systems too large to keep one
+		std::vector<std::int32_t> pairScores;
+		std::vector<Utilities::Vector> pairCouplings;
+		std::vector<std::uint8_t> pairInEncounter;
+
+		IntegrationMethod integrationMethod = IntegrationMethod::Kinematic;
+		std::uint32_t multistepOrder = 0;
+		double multistepTimestep = 0.0;
+		bool historyIsCurrent = false;
+		std::uint64_t historyHead = 0;
+		std::uint64_t historyCount = 0;
+		std::vector<Utilities::Vector> historySlots;		// bodyCount * multistepOrder, body major
+
+		bool closeEncounterHandling = false;
+		double encounterTimescaleRatio = 16.0;
+		std::vector<std::uint64_t> encounterGroupOf;		// Per body group index or UINT64_MAX
+
+		inline std::size_t bodyCount() const {
+			return this->names.size();
+		}
+	};
+}
+
+#endif
@@ -13,8 +13,6 @@ namespace SolarSystem {
 		Planet(double mass, const Utilities::Vector& velocity, double radius, std::string name, const Utilities::Vector& position, double angularVelocity)
 			: CelestialBody(mass, velocity, radius, name, position, angularVelocity) {}
 
-		//void draw(GLuint shaderProgram) override;
-
 	};
 }
 
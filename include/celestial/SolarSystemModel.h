@@ -11,12 +11,24 @@
 #include <utility>
 #include <future>
 #include <atomic>
+#include <thread>
 #include <iostream>
 #include <utils/Vector.h>
 #include <celestial/CelestialBody.h>
-#include <utils/PairDefinitions.h>
+#include <celestial/BodyRegistry.h>
+#include <celestial/BodyStore.h>
+#include <celestial/ModelCheckpoint.h>
+#include <physics/AdamsBashforthMoulton.h>
+#include <physics/CloseEncounterIntegrator.h>
+#include <physics/PararealIntegrator.h>
 #include <utils/MathUtils.h>
+#include <utils/MemoryArena.h>
+#ifndef SOLAR_SYSTEM_HEADLESS
+#include <utils/SphereRenderer.h>
+#include <utils/PointSpriteRenderer.h>
+#include <utils/Frustum.h>
 #include <GL/glew.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -24,21 +36,62 @@
 
 namespace SolarSystem {
 
+	struct PairInteraction {
+		int score;							// Frames left before the coupling is recomputed
+		Utilities::Vector coupling;			// (r2 - r1) / |r2 - r1|^3, see MathUtils::calculateGravitationalCoupling
+		std::size_t firstIndex;				// Body store index of the first body of the pair
+		std::size_t secondIndex;			// Body store index of the second body of the pair
+		bool inEncounter = false;			// Integrated by the close encounter subsystem instead of the global step
+	};
+
 	class SolarSystemModel {
 
 	public:
 
 		SolarSystemModel() = default;
 
-		void addCelestialBody(std::unique_ptr<CelestialBody> celestialBody);
+		// Throws when a body with the same name is already part of the system
+		BodyHandle addCelestialBody(std::unique_ptr<CelestialBody> celestialBody);
+
+		// Adds a whole batch, sizing every per-body structure once and filling the new pairs in one parallel pass.
+		// Nothing is added when a body is null or its name is already taken, by the system or earlier in the batch.
+		// Handles are returned in batch order.
+		std::vector<BodyHandle> addCelestialBodies(std::vector<std::unique_ptr<CelestialBody>> celestialBodies);
+
+		// Constructs the body in the model's body arena instead of on the heap
+		template <typename T, typename... Args>
+		BodyHandle emplaceCelestialBody(Args&&... args) {
+			return registerCelestialBody(this->bodyArena.create<T>(std::forward<Args>(args)...));
+		}
+
+		// Sizes every per-body structure for count more bodies of type T, so a large load does a few big allocations
+		template <typename T = CelestialBody>
+		void reserveCelestialBodies(std::size_t count) {
+			this->bodyArena.reserve<T>(count);
+			reserveBodyState(this->bodyRegistry.size() + count);
+		}
+
+		// Densely packed in body store order. Removing a body moves the last body into its place.
+		const std::vector<BodyPointer>& getCelestialBodies() const {
+			return this->bodyRegistry.getBodies();
+		}
 
-		const std::vector<std::unique_ptr<CelestialBody>>& getCelestialBodies() const {
-			return this->celestialBodies;
+		inline const BodyRegistry& getBodyRegistry() const {
+			return this->bodyRegistry;
 		}
 
+		inline const BodyStore& getBodyStore() const {
+			return this->bodyStore;
+		}
+
+		// Force on body1 from body2 and the pair's score, in either argument order. The score is -1 for unknown bodies.
+		// Systems too large for the pair table compute the force on demand and report a score of 0.
 		std::pair<int, Utilities::Vector> getForceBetweenBodies(const CelestialBody* body1, const CelestialBody* body2) const;
 
-		void removeCelestialBody(const std::string& name);
+		// Both overloads drop every pair and per-body entry of the body and return false when it does not exist
+		bool removeCelestialBody(const std::string& name);
+
+		bool removeCelestialBody(BodyHandle handle);
 	
 		void calculateForceVectorsBasedOnTimestep(float timestep, float fps);
 
@@ -48,26 +101,166 @@ namespace SolarSystem {
 
 		void updateCelestialBodyPositionsAndVelocities(float timestep);
 
-		// Method to initialize the rendering context
+		// Recomputes every pair force regardless of its score
+		void calculateForceVectorsExact();
+
+		// Selects the integrator used by advance(). The order is the number of history steps for multistep methods.
+		void setIntegrationMethod(IntegrationMethod method, unsigned int order = 10);
+
+		inline IntegrationMethod getIntegrationMethod() const {
+			return this->integrationMethod;
+		}
+
+		// Runs one full simulation step with the selected integration method
+		void advance(float timestep, float fps);
+
+		// When enabled, pairs whose dynamical time sqrt(r^3 / (mu1 + mu2)) drops below timescaleRatio global steps are
+		// grouped and integrated separately with Bulirsch-Stoer, so the rest of the system keeps its large step
+		void setCloseEncounterHandling(bool enabled, double timescaleRatio = 16.0);
+
+		// Advances the whole system by duration seconds with parallel-in-time Parareal integration and returns the number
+		// of iterations it needed. Meant for long unattended runs, it bypasses the per frame integrators.
+		unsigned int integrateParallelInTime(double duration, const PararealSettings& settings = PararealSettings());
+
+		// Copies the complete simulation state between two steps. Only flat arrays are copied, so the caller can hand
+		// the result to another thread and keep stepping straight away. Throws for bodies of a type it cannot recreate.
+		ModelCheckpoint captureCheckpoint() const;
+
+		// Rebuilds the system from a checkpoint, after which advance() continues exactly where the checkpointed run
+		// stopped. Throws when the model already holds bodies or the checkpoint is inconsistent.
+		void restoreCheckpoint(const ModelCheckpoint& checkpoint);
+
+		// Groups of body store indices currently handled by the close encounter subsystem
+		std::vector<std::vector<std::size_t>> getCloseEncounterGroups() const;
+
+#ifndef SOLAR_SYSTEM_HEADLESS
+		// Method to initialize the rendering context. Bodies and renderers free their GL objects when the model is
+		// destroyed, so from then on the model must be destroyed while the same context is current.
 		void initializeRendering(Utilities::GeometryManager& geomManager);
 
-		// Method to render the scene
+		// Gives every body that has none yet a unit sphere mesh from the geometry cache. Needs the shader program to
+		// be set.
+		void initializeGraphics(Utilities::GeometryManager& geomManager);
+
+		// Method to render the scene, all bodies sharing a mesh are drawn with one instanced call
 		void render(const glm::mat4& view, const glm::mat4& projection);
 
+		// With level of detail on, the default, render() tessellates each body by its size on screen and draws bodies
+		// only a few pixels across as point sprites. Off, every body uses the tessellation it was created with.
+		inline void setLevelOfDetail(bool enabled) {
+			this->levelOfDetail = enabled;
+		}
+
+		// With frustum culling on, the default, render() skips bodies outside the camera's view before queuing them
+		inline void setFrustumCulling(bool enabled) {
+			this->frustumCulling = enabled;
+		}
+
+		inline const Utilities::FrustumCuller& getFrustumCuller() const {
+			return this->frustumCuller;
+		}
+
+		inline const Utilities::SphereRenderer& getSphereRenderer() const {
+			return this->sphereRenderer;
+		}
+
+		inline const Utilities::PointSpriteRenderer& getPointSpriteRenderer() const {
+			return this->pointSpriteRenderer;
+		}
+
 		inline void setShaderProgram(GLuint shaderProgram) {
 			this->shaderProgram = shaderProgram;
 		}
+#endif
 
 	private:
 
-		std::vector<std::unique_ptr<CelestialBody>> celestialBodies;		
-		std::unordered_map<std::pair<const CelestialBody*, const CelestialBody*>, std::pair<int, Utilities::Vector>, Utilities::PairHash, Utilities::PairEqual> forceCalculationMap;
-		std::unordered_map<const CelestialBody*, Utilities::Vector> netForces;
+		using PairKey = std::pair<const CelestialBody*, const CelestialBody*>;
+		using PairEntry = std::pair<PairKey, PairInteraction>;
+
+		// Pairs are stored densely by body store index. Pair (i, j) with i < j lives at j * (j - 1) / 2 + i, so the
+		// pairs of body j form one contiguous row and adding bodies only ever appends rows. Above a body count limit
+		// the table is left empty and every force comes from MathUtils::calculateAccelerations instead.
+		static inline std::size_t pairIndex(std::size_t first, std::size_t second) {
+			return second * (second - 1) / 2 + first;
+		}
+
+		// The arena is declared first so it outlives the bodies allocated from it
+		BodyArena bodyArena;
+		BodyRegistry bodyRegistry;
+		std::vector<PairEntry> pairInteractions;
+		BodyStore bodyStore;
+#ifndef SOLAR_SYSTEM_HEADLESS
 		GLuint shaderProgram;
+		Utilities::SphereRenderer sphereRenderer;
+		Utilities::PointSpriteRenderer pointSpriteRenderer;
+		bool levelOfDetail = true;
+		bool frustumCulling = true;
+		Utilities::FrustumCuller frustumCuller;
+		std::vector<Utilities::Vec3> cullingCenters;			// Bounding spheres handed to the culler, rebuilt every frame
+		std::vector<double> cullingRadii;
+		std::vector<std::uint32_t> allBodyIndices;				// What render() draws with culling off
+#endif
+
+		IntegrationMethod integrationMethod = IntegrationMethod::Kinematic;
+		AdamsBashforthMoulton multistepCoefficients;
+		double multistepTimestep = 0.0;				// Step size the acceleration history was built with
+		bool historyIsCurrent = false;				// True once the newest history entry matches the current positions
+
+		struct EncounterGroup {
+			std::vector<std::size_t> members;
+			std::vector<Utilities::Vector> positions;
+			std::vector<Utilities::Vector> velocities;
+			std::vector<Utilities::Vector> externalAccelerationsAtStart;
+			std::vector<Utilities::Vector> externalAccelerationsAtEnd;
+			std::vector<double> gravitationalParameters;
+		};
+
+		static constexpr std::size_t NO_ENCOUNTER_GROUP = static_cast<std::size_t>(-1);
+
+		bool closeEncounterHandling = false;
+		double encounterTimescaleRatio = 16.0;
+		CloseEncounterIntegrator encounterIntegrator;
+		std::vector<EncounterGroup> encounterGroups;
+		std::vector<std::size_t> encounterGroupOf;			// Per body index into encounterGroups or NO_ENCOUNTER_GROUP
+		std::vector<std::size_t> encounterParent;			// Union-find scratch used while grouping close pairs
+		std::vector<std::size_t> nextEncounterGroupOf;		// Grouping being built, swapped with encounterGroupOf
 
-		int determineNewScore(const Utilities::Vector& force, float timestep);
+		// Temporaries that only live for one advance(), rewound at the start of every step
+		Utilities::MonotonicArena frameArena;
+
+		template <typename T>
+		using FrameVector = std::vector<T, Utilities::ArenaAllocator<T>>;
+
+		// Integrator scratch, kept between steps to avoid reallocating every frame
+		std::vector<Utilities::Vector> stepStartPositions;
+		std::vector<Utilities::Vector> stepStartVelocities;
+		std::vector<Utilities::Vector> stageVelocities;
+		std::vector<Utilities::Vector> stageAccelerations;
+		std::vector<Utilities::Vector> velocityIncrements;
+		std::vector<Utilities::Vector> positionIncrements;
+		std::vector<Utilities::Vector> directPositions;			// Input of the direct kernel for systems without a pair table
+
+		BodyHandle registerCelestialBody(BodyPointer celestialBody);
+		void reserveBodyState(std::size_t bodyCount);
+		void buildPairRows(std::size_t firstNewBody);
+		bool usesPairTable() const;
+		void calculateDirectAccelerations();
+		std::optional<std::size_t> indexOfBody(const CelestialBody* celestialBody) const;
+		int determineNewScore(const PairInteraction& interaction, float timestep);
 		int adjustScoreBasedOnTimestep(int currentScore, float timestep, float fps);
-		void processForceCalculationForPair(const std::pair<const CelestialBody*, const CelestialBody*>& pair, int& score, Utilities::Vector& force, float timestep, float fps);
+		void processForceCalculationForPair(const std::pair<const CelestialBody*, const CelestialBody*>& pair, PairInteraction& interaction, float timestep, float fps);
+
+		void evaluateAccelerations(std::vector<Utilities::Vector>& accelerations);
+		void advanceAdamsBashforthMoulton(double timestep);
+		void advanceRungeKuttaStartup(double timestep);
+
+		// Returns true when the set of bodies in close encounters changed
+		bool updateCloseEncounters(double timestep);
+		void beginCloseEncounterStep();
+		void finishCloseEncounterStep(double timestep);
+		void calculateExternalAccelerations(std::size_t groupIndex, const Utilities::Vector* memberPositions, std::size_t memberCount, std::vector<Utilities::Vector>& accelerations) const;
+		void clearCloseEncounters();
 
 	};
 }
@@ -16,7 +16,8 @@ namespace SolarSystem {
 		Star(double mass, const Utilities::Vector& velocity, double radius, std::string name, const Utilities::Vector& position, double angularVelocity, double luminosity, double temperature)
 			: CelestialBody(mass, velocity, radius, name, position, angularVelocity), luminosity(luminosity), temperature(temperature) {}
 
-		//void draw(GLuint shaderProgram) override;
+		// Tinted by temperature, from orange for cool stars through white to blue for hot ones
+		glm::vec3 getColor() const override;
 
 		inline double getLuminosity() const {
 			return this->luminosity;
@@ -0,0 +1,62 @@
+
+#ifndef ADAMSBASHFORTHMOULTON_H
+#define ADAMSBASHFORTHMOULTON_H
+
+#include <vector>
+#include <cstddef>
+
+namespace SolarSystem {
+
+	class AdamsBashforthMoulton {
+
+		// Coefficient tables for a k-step Adams-Bashforth predictor and Adams-Moulton corrector applied to the
+		// second order system r'' = a(r). Velocities use the classic Adams weights, positions use the doubly
+		// integrated (1 - s) weighted form so both are advanced from the same acceleration history:
+		//
+		//     v(n+1) = v(n) + h * sum(velocityWeight[j] * a[j])
+		//     r(n+1) = r(n) + h * v(n) + h^2 * sum(positionWeight[j] * a[j])
+		//
+		// Predictor entry j is the acceleration j steps in the past, corrector entry 0 is the predicted
+		// acceleration at the new time followed by the k - 1 most recent history entries.
+
+	public:
+
+		static constexpr unsigned int MIN_ORDER = 2;
+		static constexpr unsigned int MAX_ORDER = 12;
+
+		explicit AdamsBashforthMoulton(unsigned int order = 10);
+
+		inline unsigned int getOrder() const {
+			return this->order;
+		}
+
+		inline const std::vector<double>& getPredictorVelocityWeights() const {
+			return this->predictorVelocityWeights;
+		}
+
+		inline const std::vector<double>& getPredictorPositionWeights() const {
+			return this->predictorPositionWeights;
+		}
+
+		inline const std::vector<double>& getCorrectorVelocityWeights() const {
+			return this->correctorVelocityWeights;
+		}
+
+		inline const std::vector<double>& getCorrectorPositionWeights() const {
+			return this->correctorPositionWeights;
+		}
+
+	private:
+
+		unsigned int order;
+		std::vector<double> predictorVelocityWeights;
+		std::vector<double> predictorPositionWeights;
+		std::vector<double> correctorVelocityWeights;
+		std::vector<double> correctorPositionWeights;
+
+		// Integrates every Lagrange basis polynomial through the given nodes over [0, 1]
+		static void computeWeights(const std::vector<long double>& nodes, std::vector<double>& velocityWeights, std::vector<double>& positionWeights);
+	};
+}
+
+#endif
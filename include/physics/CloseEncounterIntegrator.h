@@ -0,0 +1,66 @@
+
+#ifndef CLOSEENCOUNTERINTEGRATOR_H
+#define CLOSEENCOUNTERINTEGRATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <utils/Vector.h>
+
+namespace SolarSystem {
+
+	class CloseEncounterIntegrator {
+
+		// Bulirsch-Stoer integrator for the small groups of bodies that are currently in a close encounter.
+		// A group is advanced over the global timestep with its own adaptive substeps, using the exact mutual
+		// attraction of its members plus the external acceleration from the rest of the system, interpolated
+		// linearly between the start and the end of the step. A comet grazing a planet therefore never forces
+		// the global integrator to shrink its step.
+
+	public:
+
+		explicit CloseEncounterIntegrator(double tolerance = 1e-12) : tolerance(tolerance) {}
+
+		inline void setTolerance(double newTolerance) {
+			this->tolerance = newTolerance;
+		}
+
+		// Advances the group in place over duration seconds. All vectors hold one entry per group member.
+		void integrate(std::vector<Utilities::Vector>& positions, std::vector<Utilities::Vector>& velocities,
+			const std::vector<double>& gravitationalParameters, const std::vector<Utilities::Vector>& externalAccelerationsAtStart,
+			const std::vector<Utilities::Vector>& externalAccelerationsAtEnd, double duration);
+
+		// Number of substeps taken by the last call to integrate, useful for judging how hard an encounter is
+		inline std::size_t getLastSubstepCount() const {
+			return this->lastSubstepCount;
+		}
+
+	private:
+
+		static constexpr int MAX_COLUMNS = 8;				// Midpoint sequence 2, 4, ..., 16
+		static constexpr int MAX_STEP_HALVINGS = 60;
+
+		double tolerance;
+		std::size_t lastSubstepCount = 0;
+
+		// State is packed as [x, y, z, vx, vy, vz] per member
+		const std::vector<double>* gravitationalParameters = nullptr;
+		const std::vector<Utilities::Vector>* externalAtStart = nullptr;
+		const std::vector<Utilities::Vector>* externalAtEnd = nullptr;
+		double totalDuration = 0.0;
+		// Scratch kept between calls, so a steady stream of encounters never touches the heap
+		std::vector<double> state, result;
+		std::vector<double> startDerivative, scale, current, next;
+		std::vector<double> derivative;
+		std::vector<double> midpointPrevious, midpointCurrent, midpointNext;
+		std::vector<double> tableau[MAX_COLUMNS];
+
+		void evaluateDerivative(double time, const std::vector<double>& state, std::vector<double>& out) const;
+
+		void modifiedMidpoint(double time, const std::vector<double>& start, const std::vector<double>& startDerivative, double step, int substeps, std::vector<double>& out);
+
+		// Attempts one extrapolated step, returns the number of columns used or 0 when the step did not converge
+		int tryStep(double time, const std::vector<double>& start, double step, std::vector<double>& out);
+	};
+}
+
+#endif
@@ -0,0 +1,133 @@
+
+#ifndef DISTRIBUTEDSIMULATION_H
+#define DISTRIBUTEDSIMULATION_H
+
+// Multi-process N-body mode. Only compiled when the build defines SOLAR_SYSTEM_WITH_MPI and links an MPI
+// implementation (MS-MPI on Windows, Open MPI or MPICH elsewhere). CMakeLists.txt builds it on Linux with the
+// headless driver in src/Distributed Solar System Simulator.cpp.
+#ifdef SOLAR_SYSTEM_WITH_MPI
+
+#include <mpi.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace SolarSystem {
+
+	class SolarSystemModel;
+
+	// Plain data record exchanged between ranks
+	struct DistributedBody {
+		std::uint64_t id;						// Stable identifier, the body store index on the originating model
+		double gravitationalParameter;			// mu = G * m in km^3 s^-2
+		double position[3];						// km
+		double velocity[3];						// km/s
+	};
+
+	struct DistributedSettings {
+		double openingAngle = 0.5;				// Barnes-Hut opening angle, 0 makes every interaction exact
+		unsigned int rebalanceInterval = 32;	// Steps between forced load rebalances, 0 only rebalances on imbalance
+		double imbalanceTolerance = 0.2;		// Rebalance early once the busiest rank exceeds the mean cost by this fraction
+	};
+
+	class DistributedSimulation {
+
+		// Spreads the bodies of one simulation across MPI ranks. Ownership follows ranges of a Morton (Z-order)
+		// curve over the global bounding box, cut so every rank carries the same measured force cost. Each step
+		// every rank sends every other rank its locally essential tree: single pseudo-bodies for octree cells that
+		// are far enough from the receiver's domain and individual bodies for the cells that are not. Forces are
+		// then evaluated entirely from local data and bodies advance with kick-drift-kick leapfrog. Bodies that
+		// drift into another rank's range migrate at the next rebalance.
+
+	public:
+
+		DistributedSimulation(MPI_Comm communicator, DistributedSettings settings = DistributedSettings());
+
+		// Collective. Any rank may pass any subset of the bodies, they are redistributed by domain.
+		void distributeBodies(const std::vector<DistributedBody>& bodies);
+
+		// Collective. Advances every body by timestep seconds.
+		void step(double timestep);
+
+		// Collective. Recomputes the Morton ranges from the last measured per-body cost and migrates bodies.
+		void rebalance();
+
+		// Collective. Returns every body sorted by id on the root rank and an empty vector elsewhere.
+		std::vector<DistributedBody> gatherBodies(int root = 0) const;
+
+		inline const std::vector<DistributedBody>& getLocalBodies() const {
+			return this->localBodies;
+		}
+
+		inline int getRank() const {
+			return this->rank;
+		}
+
+		inline int getRankCount() const {
+			return this->rankCount;
+		}
+
+		inline unsigned int getRebalanceCount() const {
+			return this->rebalanceCount;
+		}
+
+		// Conversions to and from the single process model, ids are body store indices
+		static std::vector<DistributedBody> collectBodies(const SolarSystemModel& model);
+		static void applyBodies(const std::vector<DistributedBody>& bodies, SolarSystemModel& model);
+
+	private:
+
+		struct TreeNode {
+			double center[3];					// Geometric center of the node's cube
+			double size;						// Edge length of the node's cube
+			double centerOfMass[3];
+			double gravitationalParameter;
+			std::size_t firstBody;				// Range into treeOrder
+			std::size_t bodyCount;
+			int children[8];					// Child node indices, -1 where an octant is empty
+			bool leaf;
+		};
+
+		// Remote bodies and far cells both reduce to a point mass
+		struct PointMass {
+			double position[3];
+			double gravitationalParameter;
+		};
+
+		struct Bounds {
+			double minimum[3];
+			double maximum[3];
+		};
+
+		MPI_Comm communicator;
+		DistributedSettings settings;
+		int rank = 0;
+		int rankCount = 1;
+		unsigned int stepsSinceRebalance = 0;
+		unsigned int rebalanceCount = 0;
+
+		std::vector<DistributedBody> localBodies;
+		std::vector<double> localAccelerations;		// Three entries per local body
+		std::vector<double> localCosts;				// Interactions evaluated for each local body in the last force pass
+		bool accelerationsValid = false;
+
+		std::vector<TreeNode> tree;
+		std::vector<std::size_t> treeOrder;
+		std::vector<Bounds> rankBounds;
+		std::vector<PointMass> remoteMasses;
+		std::vector<std::size_t> partitionScratch;
+
+		void computeAccelerations();
+		void buildTree();
+		int buildNode(std::size_t first, std::size_t count, const double center[3], double size, int depth);
+		void collectEssentialMasses(int nodeIndex, const Bounds& remote, std::vector<PointMass>& out) const;
+		void accumulateFromTree(int nodeIndex, std::size_t bodyIndex, double acceleration[3], double& cost) const;
+		void exchangeEssentialTrees();
+		Bounds computeGlobalBounds() const;
+		bool isImbalanced() const;
+	};
+}
+
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+
+#ifndef PARAREALINTEGRATOR_H
+#define PARAREALINTEGRATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <utils/Vector.h>
+
+namespace SolarSystem {
+
+	struct NBodyState {
+		std::vector<Utilities::Vector> positions;
+		std::vector<Utilities::Vector> velocities;
+	};
+
+	struct PararealSettings {
+		unsigned int sliceCount = 0;			// Time slices, 0 sizes them from the shortest orbital period (see below)
+		unsigned int windowSlices = 0;			// Slices iterated together, 0 uses one per worker thread from MIN_PARALLEL_THREADS on
+		unsigned int threadCount = 0;			// Worker threads for the fine sweeps, 0 uses every hardware thread
+		unsigned int coarseSubsteps = 20;		// Leapfrog steps per slice for the cheap coarse propagator
+		unsigned int fineSubsteps = 100;		// Fourth order Runge-Kutta steps per slice for the accurate fine propagator
+		unsigned int maxIterations = 0;			// Parareal corrections per window, 0 allows windowSlices (the serial worst case)
+		double tolerance = 1e-9;				// State change between iterations, relative to the state's scale, that counts as converged
+	};
+
+	class PararealIntegrator {
+
+		// Parallel-in-time integration. The run is cut into time slices, a cheap coarse propagator sweeps them
+		// serially and an accurate fine propagator then refines every slice concurrently. Each iteration applies
+		//
+		//     U(n+1) = G(U(n)) + F(U_old(n)) - G(U_old(n))
+		//
+		// and the first k slices are exact after k iterations, so a small system such as the Sun and its planets
+		// can keep every core busy over century long runs where spatial parallelism has only a few dozen pairs.
+		//
+		// Slices are iterated in windows of windowSlices, each starting from the converged end of the one before. A
+		// window converging in k iterations costs about k fine slices of wall time against windowSlices serially,
+		// so the speedup is roughly windowSlices / k. k stays small only while the coarse error per slice is small:
+		// slices spanning several orbits of the fastest body never converge before the serial worst case. With
+		// sliceCount left at 0 every slice is at most 1 / SLICES_PER_ORBIT of the shortest orbital period around
+		// the heaviest body, where the Sun and eight planets converge in three iterations with the default substeps,
+		// an ideal speedup of about 1.7 on 8 threads and 2.5 on 16 once the serial coarse sweeps are counted. Fewer
+		// than MIN_PARALLEL_THREADS cannot win, so by default those runs propagate every slice fine, serially. To
+		// tune by hand, shorten the slices or add coarse substeps until getIterationsUsed() divided by
+		// getWindowsUsed() is well below windowSlices.
+
+	public:
+
+		static constexpr double SLICES_PER_ORBIT = 16.0;
+		static constexpr unsigned int MIN_PARALLEL_THREADS = 6;
+
+		PararealIntegrator(std::vector<double> gravitationalParameters, PararealSettings settings = PararealSettings());
+
+		NBodyState integrate(const NBodyState& initial, double duration);
+
+		// Iterations of the last integrate(), summed over its windows
+		inline unsigned int getIterationsUsed() const {
+			return this->iterationsUsed;
+		}
+
+		inline unsigned int getWindowsUsed() const {
+			return this->windowsUsed;
+		}
+
+		// Slices that keep each one within 1 / SLICES_PER_ORBIT of the shortest orbit, at least minimum
+		unsigned int automaticSliceCount(const NBodyState& state, double duration, unsigned int minimum) const;
+
+		// Serial reference propagators, exposed so callers can compare against the parallel result
+		void propagateCoarse(NBodyState& state, double duration) const;
+		void propagateFine(NBodyState& state, double duration) const;
+
+	private:
+
+		std::vector<double> gravitationalParameters;
+		PararealSettings settings;
+		unsigned int iterationsUsed = 0;
+		unsigned int windowsUsed = 0;
+
+		NBodyState integrateWindow(const NBodyState& initial, double sliceDuration, unsigned int sliceCount, unsigned int threadCount);
+
+		static double relativeDifference(const NBodyState& a, const NBodyState& b);
+	};
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+namespace Utilities {
+
+    // Counts calls to the global operator new. The counting replacement operators are only compiled when the build
+    // defines SOLAR_SYSTEM_COUNT_ALLOCATIONS, otherwise getCount() always returns zero. Used to check that a
+    // steady state simulation frame stays off the heap:
+    //
+    //     std::size_t before = AllocationCounter::getCount();
+    //     model.advance(timestep, fps);
+    //     assert(AllocationCounter::getCount() == before);
+    //
+    // tests/SteadyStateAllocations.cpp, run by the CMake build, does this for every integrator.
+    class AllocationCounter {
+    public:
+
+        static std::size_t getCount();
+
+        static constexpr bool isEnabled() {
+#ifdef SOLAR_SYSTEM_COUNT_ALLOCATIONS
+            return true;
+#else
+            return false;
+#endif
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef BINARYCATALOG_H
+#define BINARYCATALOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utils/MappedFile.h>
+#include <utils/CelestialBodyJSONLoader.h>
+
+namespace SolarSystem {
+    class SolarSystemModel;
+}
+
+namespace Utilities {
+
+    enum class CatalogBodyType : std::uint8_t {
+        Star = 0,
+        Planet = 1,
+        Asteroid = 2
+    };
+
+    CatalogBodyType parseCatalogBodyType(const std::string& type);
+
+    const char* toString(CatalogBodyType type);
+
+    // Binary catalog layout, version 1. Values are stored in the byte order of the writer, recorded by byteOrderMark.
+    //
+    //     CatalogHeader
+    //     CatalogColumn[columnCount]       directory, one entry per column
+    //     string table                     every name back to back, UTF-8 without terminators
+    //     columns                          one array of bodyCount elements each, every one 64 byte aligned
+    //
+    // Readers locate columns through the directory only, so later versions can append columns without breaking them.
+    struct CatalogHeader {
+        char magic[8];                      // "SSCATLG" and a terminating zero
+        std::uint32_t version;
+        std::uint32_t byteOrderMark;        // 0x01020304 as written
+        std::uint64_t bodyCount;
+        std::uint64_t stringTableOffset;
+        std::uint64_t stringTableSize;
+        std::uint64_t fileSize;
+        std::uint32_t columnCount;
+        std::uint32_t reserved;
+    };
+
+    enum class CatalogColumnId : std::uint32_t {
+        Type,                   // uint8, a CatalogBodyType
+        NameOffset,             // uint64, into the string table
+        NameLength,             // uint32
+        Mass,                   // double, kg
+        Radius,                 // double, km
+        PositionX,              // double, km
+        PositionY,
+        PositionZ,
+        VelocityX,              // double, km/s
+        VelocityY,
+        VelocityZ,
+        AngularVelocity,        // double, rad/s
+        Luminosity,             // double, W
+        SurfaceTemperature,     // double, K
+        Count
+    };
+
+    struct CatalogColumn {
+        std::uint32_t id;
+        std::uint32_t elementSize;
+        std::uint64_t offset;
+    };
+
+    class BinaryCatalogWriter {
+    public:
+
+        void reserve(std::size_t bodyCount);
+
+        void add(const CelestialBodyRecord& record);
+
+        inline std::size_t size() const {
+            return this->types.size();
+        }
+
+        // Throws when the file cannot be written
+        void write(const std::string& path) const;
+
+    private:
+
+        std::vector<std::uint8_t> types;
+        std::vector<std::uint64_t> nameOffsets;
+        std::vector<std::uint32_t> nameLengths;
+        std::string names;
+        std::vector<double> doubleColumns[static_cast<std::size_t>(CatalogColumnId::Count) - static_cast<std::size_t>(CatalogColumnId::Mass)];
+    };
+
+    class BinaryCatalog {
+
+        // Memory mapped, read-only view of a binary catalog. The columns are used in place, so opening a catalog
+        // costs one validation pass over the header and directory regardless of how many bodies it holds.
+
+    public:
+
+        static constexpr std::uint32_t VERSION = 1;
+        static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        // Throws when the file is missing, truncated or not a catalog this version can read
+        explicit BinaryCatalog(const std::string& path);
+
+        inline std::size_t size() const {
+            return this->bodyCount;
+        }
+
+        inline CatalogBodyType getType(std::size_t index) const {
+            return static_cast<CatalogBodyType>(this->types[index]);
+        }
+
+        std::string_view getName(std::size_t index) const;
+
+        // Column pointers stay valid for the lifetime of the catalog
+        inline const double* getColumn(CatalogColumnId column) const {
+            return this->doubleColumns[static_cast<std::size_t>(column) - static_cast<std::size_t>(CatalogColumnId::Mass)];
+        }
+
+        CelestialBodyRecord getRecord(std::size_t index) const;
+
+        // Adds every body to the model and returns how many were added
+        std::size_t addToModel(SolarSystem::SolarSystemModel& model) const;
+
+        // Streams the given JSON catalogs into one binary catalog
+        static std::size_t ConvertFromJSON(const std::vector<std::string>& jsonPaths, const std::string& outputPath);
+
+    private:
+
+        MappedFile file;
+        std::size_t bodyCount = 0;
+        const char* stringTable = nullptr;
+        std::size_t stringTableSize = 0;
+        const std::uint8_t* types = nullptr;
+        const std::uint64_t* nameOffsets = nullptr;
+        const std::uint32_t* nameLengths = nullptr;
+        const double* doubleColumns[static_cast<std::size_t>(CatalogColumnId::Count) - static_cast<std::size_t>(CatalogColumnId::Mass)] = {};
+    };
+}
+
+#endif
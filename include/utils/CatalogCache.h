@@ -0,0 +1,56 @@
+#ifndef CATALOGCACHE_H
+#define CATALOGCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utils/CelestialBodyJSONLoader.h>
+
+namespace Utilities {
+
+    // On-disk cache of parsed catalogs. Every entry is a binary catalog named after its source file, the FNV-1a hash
+    // of the source's absolute path and the FNV-1a hash of its contents, so an unchanged catalog is read back from one
+    // mapped file while an edited one simply misses and is parsed again, and catalogs that share a file name never
+    // share an entry. Entries are written to a temporary name and renamed into place, which keeps concurrent loads
+    // and interrupted runs from ever seeing a partial file. Safe to use from several threads.
+    class CatalogCache {
+    public:
+
+        // The directory is created on the first write
+        explicit CatalogCache(std::string cacheDirectory);
+
+        // Every record of the JSON catalog, from the cache when its contents are unchanged
+        std::vector<CelestialBodyRecord> load(const std::string& catalogPath);
+
+        // Removes every cache entry
+        void clear();
+
+        inline std::size_t getHits() const {
+            return this->hits.load();
+        }
+
+        inline std::size_t getMisses() const {
+            return this->misses.load();
+        }
+
+        inline const std::string& getDirectory() const {
+            return this->directory;
+        }
+
+        // 64 bit FNV-1a over the bytes of the file
+        static std::uint64_t HashFile(const std::string& path);
+
+    private:
+
+        std::string directory;
+        std::atomic<std::size_t> hits{ 0 };
+        std::atomic<std::size_t> misses{ 0 };
+
+        std::string entryPath(const std::string& catalogPath, std::uint64_t contentHash) const;
+        void store(const std::string& catalogPath, std::uint64_t contentHash, const std::vector<CelestialBodyRecord>& records);
+    };
+}
+
+#endif
@@ -6,18 +6,75 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <string>
+#include <functional>
 #include <utils/json.hpp>
 #include <celestial/CelestialBody.h>
 #include <celestial/Star.h>
 #include <celestial/Planet.h>
+#include <celestial/Asteroid.h>
+
+namespace SolarSystem {
+	class SolarSystemModel;
+}
 
 namespace Utilities {
 
+	class CatalogCache;
+
+	// One body as it appears in a catalog, independent of the class that will represent it
+	struct CelestialBodyRecord {
+		std::string type;
+		std::string name;
+		double mass = 0.0;						// kg, catalogs may store it as a string such as "5.972e24"
+		double radius = 0.0;					// km
+		Vector position;						// km
+		Vector velocity;						// km/s
+		double angularVelocity = 0.0;			// rad/s
+		double luminosity = 0.0;				// W, stars only
+		double surfaceTemperature = 0.0;		// K, stars only
+	};
+
 	class CelestialBodyJSONLoader {
 
+		// Catalogs are read with the SAX interface of json.hpp, so no document tree is ever built. Only the record
+		// being parsed is held in memory and each one is handed on as soon as its closing brace arrives, which keeps
+		// memory flat and load time linear in the file size for catalogs of millions of bodies. Records are read
+		// from a top level "celestialBodies" or "stars" array, every other key is skipped.
+
 	public:
 
+		using RecordCallback = std::function<void(const CelestialBodyRecord&)>;
+
+		using BodyFactory = std::function<std::unique_ptr<SolarSystem::CelestialBody>(const CelestialBodyRecord&)>;
+
+		// Calls onRecord for every body in the stream, throws on malformed JSON or unusable field values
+		static void StreamBodies(std::istream& input, const RecordCallback& onRecord, const std::string& sourceName = "catalog");
+
+		static void StreamBodies(const std::string& filepath, const RecordCallback& onRecord);
+
+		// Star, Planet and Asteroid are built in. Other types, such as moons, are added here before loading and
+		// then read from any catalog. Registering a built in type name replaces it for CreateBody.
+		static void RegisterBodyType(const std::string& type, BodyFactory factory);
+
+		static std::unique_ptr<SolarSystem::CelestialBody> CreateBody(const CelestialBodyRecord& record);
+
+		// Same as CreateBody but constructs the body in the model's body arena
+		static void AddBody(const CelestialBodyRecord& record, SolarSystem::SolarSystemModel& model);
+
 		static std::vector<std::unique_ptr<SolarSystem::CelestialBody>> LoadBodies(const std::string& resourcePath);
+
+		// Streams the bodies directly into the model's body arena and returns how many were added
+		static std::size_t LoadBodies(const std::string& resourcePath, SolarSystem::SolarSystemModel& model);
+
+		// Every .json file directly inside the directory, sorted by name so loads are reproducible
+		static std::vector<std::string> FindCatalogs(const std::string& directory);
+
+		// Parses every catalog in the directory concurrently, one file per task, and adds all bodies to the model in a
+		// single batched insert in catalog order. Zero threads uses one per hardware thread. With a cache, catalogs
+		// whose contents are unchanged since the last load are read back from it instead. Returns the bodies added.
+		static std::size_t LoadDirectory(const std::string& directory, SolarSystem::SolarSystemModel& model, unsigned int threadCount = 0,
+			CatalogCache* cache = nullptr);
 	};
 }
 
@@ -0,0 +1,87 @@
+#ifndef CHECKPOINTFILE_H
+#define CHECKPOINTFILE_H
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <celestial/ModelCheckpoint.h>
+
+namespace Utilities {
+
+    // Checkpoint layout, version 1. Values are stored in the byte order of the writer, recorded by byteOrderMark.
+    //
+    //     CheckpointHeader
+    //     body arrays          types, name lengths, the names back to back, then masses through accelerations
+    //     pair arrays          scores, couplings and encounter flags in pair index order
+    //     history slots
+    //     encounter groups     one per body
+    //
+    // Every array holds raw values, so writing and reading are a handful of large copies.
+    struct CheckpointHeader {
+        char magic[8];                      // "SSCHKPT" and a terminating zero
+        std::uint32_t version;
+        std::uint32_t byteOrderMark;        // 0x01020304 as written
+        std::uint64_t bodyCount;
+        std::uint64_t pairCount;
+        std::uint64_t historySlotCount;
+        std::uint64_t nameBytes;
+        std::uint64_t fileSize;
+        double simulationTime;
+        double multistepTimestep;
+        double encounterTimescaleRatio;
+        std::uint64_t historyHead;
+        std::uint64_t historyCount;
+        std::uint32_t integrationMethod;
+        std::uint32_t multistepOrder;
+        std::uint8_t historyIsCurrent;
+        std::uint8_t closeEncounterHandling;
+        std::uint8_t reserved[6];
+    };
+
+    class CheckpointFile {
+    public:
+
+        static constexpr std::uint32_t VERSION = 1;
+        static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        // Writes to a temporary file and renames it over path, so an interrupted write never replaces a good
+        // checkpoint with a partial one. Throws when the file cannot be written.
+        static void Write(const SolarSystem::ModelCheckpoint& checkpoint, const std::string& path);
+
+        // Throws when the file is missing, truncated or not a checkpoint this version can read
+        static SolarSystem::ModelCheckpoint Read(const std::string& path);
+    };
+
+    class CheckpointWriter {
+
+        // Writes checkpoints on a background thread. The simulation captures a checkpoint between two steps, hands
+        // it over and carries on; the copy it handed over is the only thing the writer touches.
+
+    public:
+
+        CheckpointWriter() = default;
+
+        CheckpointWriter(const CheckpointWriter&) = delete;
+
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        // Waits for a pending write, errors are dropped, call wait() to see them
+        ~CheckpointWriter();
+
+        // Check before capturing, a checkpoint handed over while busy is not written
+        bool isBusy() const;
+
+        // Starts writing and returns immediately. Returns false while the previous checkpoint is still being written
+        // and rethrows the previous write's error once it has finished.
+        bool writeAsync(SolarSystem::ModelCheckpoint checkpoint, const std::string& path);
+
+        // Waits for the pending write and rethrows its error
+        void wait();
+
+    private:
+
+        std::future<void> pending;
+    };
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <utils/Vec3.h>
+
+namespace Utilities {
+
+    class Frustum {
+
+        // The six planes of a view frustum in world space, taken from the rows of projection * view (Gribb and
+        // Hartmann). Normals point inwards and are normalized, so a plane evaluated at a point gives its signed
+        // distance and a sphere is outside as soon as one plane puts its centre more than a radius behind it.
+
+    public:
+
+        enum class Containment {
+            Outside,
+            Intersecting,
+            Inside
+        };
+
+        explicit Frustum(const glm::mat4& viewProjection);
+
+        bool intersectsSphere(const Vec3& center, double radius) const;
+
+        Containment classifySphere(const Vec3& center, double radius) const;
+
+        // Sets visible[i] to 1 for the spheres at least partly inside and 0 for the rest, Vec3x4::width() at a time
+        void cullSpheres(const Vec3* centers, const double* radii, std::size_t count, unsigned char* visible) const;
+
+    private:
+
+        std::array<Vec3, 6> normals;
+        std::array<double, 6> offsets;
+    };
+
+    class FrustumCuller {
+
+        // Picks the spheres a frustum can see out of a set that changes a little every frame. Small sets are tested
+        // directly. From HIERARCHY_THRESHOLD spheres on they are also grouped into clusters of CLUSTER_SIZE that are
+        // neighbours along a Morton curve; a cluster wholly outside or inside the frustum settles all its members
+        // with one test, so zooming in on one planet skips nearly all per-body work. The grouping is rebuilt every
+        // REGROUP_INTERVAL calls and when the count changes, and the cluster bounds are refit on every call.
+
+    public:
+
+        static constexpr std::size_t HIERARCHY_THRESHOLD = 4096;
+        static constexpr std::size_t CLUSTER_SIZE = 64;
+        static constexpr std::size_t REGROUP_INTERVAL = 120;
+
+        // Indices of the visible spheres, valid until the next call
+        const std::vector<std::uint32_t>& cull(const Frustum& frustum, const std::vector<Vec3>& centers, const std::vector<double>& radii);
+
+        // Clusters the last call tested against the frustum, zero when it tested the spheres directly
+        inline std::size_t getClustersTested() const {
+            return this->clustersTested;
+        }
+
+        // Spheres the last call tested one by one
+        inline std::size_t getSpheresTested() const {
+            return this->spheresTested;
+        }
+
+    private:
+
+        struct Cluster {
+            std::size_t first;          // Into order
+            std::size_t count;
+            Vec3 center;
+            double radius;
+        };
+
+        std::vector<std::uint32_t> visibleIndices;
+        std::vector<unsigned char> visible;
+
+        // Hierarchy, spheres in Morton order and the clusters over runs of that order
+        std::vector<std::uint32_t> order;
+        std::vector<Cluster> clusters;
+        std::vector<std::uint32_t> clusterOf;   // Cluster of every sphere
+        std::vector<Vec3> clusterLower;         // Bounding boxes, refit on every call
+        std::vector<Vec3> clusterUpper;
+        std::vector<Vec3> memberCenters;        // Members of the cluster being tested one by one
+        std::vector<double> memberRadii;
+        std::size_t callsSinceRegroup = 0;
+
+        std::size_t clustersTested = 0;
+        std::size_t spheresTested = 0;
+
+        void regroup(const std::vector<Vec3>& centers);
+        void refitClusters(const std::vector<Vec3>& centers, const std::vector<double>& radii);
+    };
+}
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef GEOMETRYMANAGER_H
 #define GEOMETRYMANAGER_H
 
+#include <cstddef>
+#include <map>
+#include <tuple>
 #include <vector>
 #include <unordered_map>
 #include <stdexcept>
@@ -8,21 +11,73 @@
 
 namespace Utilities {
 
+    // Kinds of unit sphere mesh, part of the cache key so other tessellation schemes can share the cache
+    enum class MeshType {
+        UvSphere            // Latitude and longitude bands
+    };
+
     class GeometryManager {
+
+        // Owns every mesh on the GPU. Unit spheres are cached by tessellation: acquiring one that already exists hands
+        // out the same VAO and bumps its reference count, and the VAO, VBO and EBO are deleted together when the last
+        // user releases it. Must be used from the thread that owns the GL context.
+
     public:
         struct GeometryData {
             GLuint VAO;
             GLuint indicesCount;
         };
 
+        // One step of the level of detail chain, used while the sphere's projected radius is at least minPixelRadius
+        struct SphereLod {
+            GeometryData geometry;
+            float minPixelRadius;
+        };
+
         static void initialize();
-        static GeometryData createSphereGeometry(float radius, unsigned int longitudeBands, unsigned int latitudeBands);
-        static void deleteGeometry(GLuint geometryID);
+
+        // Unit sphere with the given tessellation, every acquire must be matched by one releaseGeometry()
+        static GeometryData acquireSphereGeometry(unsigned int longitudeBands, unsigned int latitudeBands, MeshType type = MeshType::UvSphere);
+
+        // Unit spheres from finest to coarsest, each acquired once; release every level when done
+        static std::vector<SphereLod> acquireSphereLodChain();
+
+        // Level to draw a sphere with a projected radius of pixelRadius with, the coarsest one for anything smaller
+        static std::size_t selectSphereLod(const std::vector<SphereLod>& chain, float pixelRadius);
+
+        // Drops one reference, the GL objects are deleted with the last one. Throws for an unknown ID.
+        static void releaseGeometry(GLuint geometryID);
+
+        // Same as releaseGeometry but for destructors: an unknown ID is a bug that asserts in debug builds and is
+        // otherwise ignored, so it can never terminate the program from a noexcept context
+        static void releaseGeometryNoThrow(GLuint geometryID) noexcept;
+
         static GeometryData getGeometryData(unsigned int geometryID);
 
+        // Distinct meshes currently on the GPU
+        static std::size_t getGeometryCount();
+
+        // Bytes held in vertex and index buffers
+        static std::size_t getGpuMemoryBytes();
+
     private:
-        static GLuint generateSphereVAO(float radius, unsigned int longitudeBands, unsigned int latitudeBands, GLuint& indicesCount);
-        static std::unordered_map<GLuint, GeometryData> geometries;
+        using GeometryKey = std::tuple<MeshType, unsigned int, unsigned int>;
+
+        struct GeometryEntry {
+            GeometryData data;
+            GLuint VBO;
+            GLuint EBO;
+            GeometryKey key;
+            std::size_t bufferBytes;
+            std::size_t references;
+        };
+
+        static GeometryEntry generateSphere(unsigned int longitudeBands, unsigned int latitudeBands);
+        static GeometryData acquire(const GeometryKey& key);
+        static bool release(GLuint geometryID) noexcept;
+        static std::unordered_map<GLuint, GeometryEntry> geometries;    // By VAO
+        static std::map<GeometryKey, GLuint> cache;                     // VAO of every cached mesh
+        static std::size_t gpuMemoryBytes;
     };
 
 }
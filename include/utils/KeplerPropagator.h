@@ -0,0 +1,119 @@
+
+#ifndef KEPLERPROPAGATOR_H
+#define KEPLERPROPAGATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <utils/Vector.h>
+
+namespace Utilities {
+
+    // Classical Keplerian elements of a two-body orbit. Angles are in radians and distances in kilometers.
+    // Hyperbolic orbits (eccentricity > 1) carry a negative semi-major axis, matching the vis-viva energy sign.
+    struct OrbitalElements {
+        double semiMajorAxis = 0.0;             // Semi-major axis (km)
+        double eccentricity = 0.0;              // Orbital eccentricity
+        double inclination = 0.0;               // Inclination to the reference plane
+        double longitudeOfAscendingNode = 0.0;  // Longitude of the ascending node
+        double argumentOfPeriapsis = 0.0;       // Argument of periapsis
+        double meanAnomaly = 0.0;               // Mean anomaly at the epoch
+    };
+
+    enum class KeplerSolver {
+        Newton,     // Newton-Raphson, cheapest per iteration
+        Laguerre    // Laguerre-Conway, converges for every eccentricity in a handful of iterations
+    };
+
+    class KeplerPropagator {
+
+    public:
+
+        static OrbitalElements cartesianToElements(const Vector& position, const Vector& velocity, double mu);
+
+        static void elementsToCartesian(const OrbitalElements& elements, double mu, Vector& position, Vector& velocity, KeplerSolver solver = KeplerSolver::Laguerre);
+
+        // Solves M = E - e sin(E) for elliptic orbits and M = e sinh(H) - H for hyperbolic orbits
+        static double solveKeplerEquation(double meanAnomaly, double eccentricity, KeplerSolver solver = KeplerSolver::Laguerre);
+
+        // Solves the elliptic Kepler equation for every entry. The loop runs a fixed number of iterations with no
+        // data dependent branches so the compiler can vectorize it across bodies.
+        static void solveKeplerEquationBatch(const double* meanAnomaly, const double* eccentricity, double* eccentricAnomaly, std::size_t count, KeplerSolver solver = KeplerSolver::Laguerre);
+
+        // Advances a single Cartesian state by dt seconds along its osculating conic
+        static void propagateState(Vector& position, Vector& velocity, double mu, double dt, KeplerSolver solver = KeplerSolver::Laguerre);
+
+    private:
+
+        static double solveHyperbolicKeplerEquation(double meanAnomaly, double eccentricity, KeplerSolver solver);
+    };
+
+    // Structure of arrays holding many orbits around the same central mass. Orbital elements are reduced once to
+    // mean motion and a perifocal basis, after which propagation is a mean anomaly update followed by a batched
+    // Kepler solve, so thousands of test particles or comets advance in closed form without any force evaluation.
+    class KeplerOrbitBatch {
+
+    public:
+
+        explicit KeplerOrbitBatch(double mu) : mu(mu) {}
+
+        std::size_t addOrbit(const OrbitalElements& elements);
+
+        std::size_t addState(const Vector& position, const Vector& velocity);
+
+        void reserve(std::size_t count);
+
+        void clear();
+
+        // Advances every orbit by dt seconds and refreshes the Cartesian columns
+        void propagate(double dt, KeplerSolver solver = KeplerSolver::Laguerre);
+
+        void getState(std::size_t index, Vector& position, Vector& velocity) const;
+
+        OrbitalElements getElements(std::size_t index) const;
+
+        inline std::size_t size() const {
+            return this->meanAnomaly.size();
+        }
+
+        inline double getGravitationalParameter() const {
+            return this->mu;
+        }
+
+        inline const std::vector<double>& getPositionsX() const { return this->positionX; }
+        inline const std::vector<double>& getPositionsY() const { return this->positionY; }
+        inline const std::vector<double>& getPositionsZ() const { return this->positionZ; }
+        inline const std::vector<double>& getVelocitiesX() const { return this->velocityX; }
+        inline const std::vector<double>& getVelocitiesY() const { return this->velocityY; }
+        inline const std::vector<double>& getVelocitiesZ() const { return this->velocityZ; }
+
+    private:
+
+        const double mu;                            // Gravitational parameter of the central body (km^3 s^-2)
+
+        // Element columns
+        std::vector<double> semiMajorAxis;
+        std::vector<double> eccentricity;
+        std::vector<double> meanAnomaly;
+        std::vector<double> meanMotion;             // rad/s
+        std::vector<double> semiMinorFactor;        // sqrt(|1 - e^2|)
+        std::vector<double> inclination;
+        std::vector<double> longitudeOfAscendingNode;
+        std::vector<double> argumentOfPeriapsis;
+
+        // Perifocal basis: P points at periapsis, Q is P rotated 90 degrees in the orbital plane
+        std::vector<double> periapsisX, periapsisY, periapsisZ;
+        std::vector<double> perpendicularX, perpendicularY, perpendicularZ;
+
+        // Hyperbolic orbits cannot share the fixed iteration elliptic kernel and are solved separately
+        std::vector<std::size_t> hyperbolicIndices;
+
+        // Scratch and output columns
+        std::vector<double> eccentricAnomaly;
+        std::vector<double> positionX, positionY, positionZ;
+        std::vector<double> velocityX, velocityY, velocityZ;
+
+        void updateCartesianState();
+    };
+}
+
+#endif
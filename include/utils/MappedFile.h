@@ -0,0 +1,56 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Utilities {
+
+    // Read-only memory mapping of a whole file. The operating system pages the contents in on demand, so large
+    // catalogs can be used in place without being read into memory first.
+    class MappedFile {
+    public:
+
+        MappedFile() = default;
+
+        // Throws when the file cannot be opened or mapped
+        explicit MappedFile(const std::string& path);
+
+        MappedFile(const MappedFile&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept;
+
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        ~MappedFile();
+
+        inline const unsigned char* data() const {
+            return this->view;
+        }
+
+        inline std::size_t size() const {
+            return this->length;
+        }
+
+        inline bool isOpen() const {
+            return this->opened;
+        }
+
+        void close();
+
+    private:
+
+        const unsigned char* view = nullptr;
+        std::size_t length = 0;
+        bool opened = false;
+
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+}
+
+#endif
@@ -2,6 +2,7 @@
 #ifndef MATHUTILS_H
 #define MATHUTILS_H
 
+#include <vector>
 #include <utils/UtilitiesNamespace.h>
 #include <celestial/CelestialBody.h>
 
@@ -27,8 +28,21 @@ namespace Utilities {
 			return (2 * PI) / angularVelocity;
 		}
 
+		static constexpr double calculateGravitationalParameter(double mass) {
+			return GRAVITATIONAL_CONSTANT_KM * mass;
+		}
+
 		static Vector calculateGravitationalForceBetweenMasses(const SolarSystem::CelestialBody& bodyOne, const SolarSystem::CelestialBody& bodyTwo);
 
+		// Mass free part of the pairwise interaction, (positionTwo - positionOne) / distance^3. Multiplying it by the
+		// gravitational parameter of body two gives the acceleration of body one, and by minus that of body one gives
+		// the acceleration of body two.
+		static Vector calculateGravitationalCoupling(const Vector& positionOne, const Vector& positionTwo);
+
+		// Direct summation of the accelerations every body induces on every other, for integrators that work on
+		// plain state arrays instead of CelestialBody objects
+		static void calculateAccelerations(const std::vector<Vector>& positions, const std::vector<double>& gravitationalParameters, std::vector<Vector>& accelerations);
+
 	};
 }
 
@@ -0,0 +1,186 @@
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Utilities {
+
+    // Bump allocator over a chain of large blocks. Individual allocations are never freed, the whole arena is
+    // rewound with reset(). When a cycle needed more than one block, reset() replaces them with a single block
+    // of the combined size, so a workload that repeats every frame stops allocating after its first two frames.
+    class MonotonicArena {
+    public:
+
+        explicit MonotonicArena(std::size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+        MonotonicArena(const MonotonicArena&) = delete;
+
+        MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+        ~MonotonicArena();
+
+        void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+        // Rewinds to empty, every pointer handed out so far becomes invalid
+        void reset();
+
+        // Makes sure the next `bytes` of allocations fit without asking the system for memory
+        void reserve(std::size_t bytes);
+
+        inline std::size_t getBytesUsed() const {
+            return this->bytesUsed;
+        }
+
+        inline std::size_t getCapacity() const {
+            return this->capacity;
+        }
+
+    private:
+
+        struct Block {
+            char* data;
+            std::size_t size;
+        };
+
+        std::size_t blockSize;
+        std::vector<Block> blocks;
+        std::size_t currentBlock = 0;
+        std::size_t offset = 0;             // Into blocks[currentBlock]
+        std::size_t bytesUsed = 0;
+        std::size_t capacity = 0;
+
+        void addBlock(std::size_t minimumSize);
+        void releaseBlocks();
+    };
+
+    // Fixed size recycling on top of a MonotonicArena. Freed memory goes onto an intrusive free list for its
+    // size class and is handed out again before the arena grows, which suits many objects of a few distinct sizes
+    // that come and go, such as celestial bodies or hash map nodes.
+    class MemoryPool {
+    public:
+
+        explicit MemoryPool(std::size_t blockSize = 1024 * 1024) : arena(blockSize) {}
+
+        void* allocate(std::size_t bytes);
+
+        void deallocate(void* memory, std::size_t bytes);
+
+        inline void reserve(std::size_t bytes) {
+            this->arena.reserve(bytes);
+        }
+
+        inline std::size_t getCapacity() const {
+            return this->arena.getCapacity();
+        }
+
+    private:
+
+        struct FreeNode {
+            FreeNode* next;
+        };
+
+        struct SizeClass {
+            std::size_t size;
+            FreeNode* head;
+        };
+
+        MonotonicArena arena;
+        std::vector<SizeClass> sizeClasses;     // Only a handful of distinct sizes are ever pooled
+
+        static std::size_t roundUp(std::size_t bytes);
+        SizeClass& sizeClassFor(std::size_t roundedBytes);
+    };
+
+    // Standard allocator drawing from a MonotonicArena, for per-frame containers that die with the frame
+    template <typename T>
+    class ArenaAllocator {
+    public:
+
+        using value_type = T;
+
+        explicit ArenaAllocator(MonotonicArena& arena) noexcept : arena(&arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.getArena()) {}
+
+        T* allocate(std::size_t count) {
+            return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T*, std::size_t) noexcept {
+            // Released all at once when the arena is reset
+        }
+
+        inline MonotonicArena* getArena() const noexcept {
+            return this->arena;
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept {
+            return this->arena == other.getArena();
+        }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+            return this->arena != other.getArena();
+        }
+
+    private:
+
+        MonotonicArena* arena;
+    };
+
+    // Standard allocator drawing single objects from a MemoryPool. Array requests, such as hash table bucket
+    // arrays, are rare and go to the global heap.
+    template <typename T>
+    class PoolAllocator {
+    public:
+
+        using value_type = T;
+
+        explicit PoolAllocator(MemoryPool& pool) noexcept : pool(&pool) {}
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U>& other) noexcept : pool(other.getPool()) {}
+
+        T* allocate(std::size_t count) {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Pool allocations are only aligned to max_align_t.");
+            if (count == 1) {
+                return static_cast<T*>(pool->allocate(sizeof(T)));
+            }
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+
+        void deallocate(T* memory, std::size_t count) noexcept {
+            if (count == 1) {
+                pool->deallocate(memory, sizeof(T));
+            }
+            else {
+                ::operator delete(memory);
+            }
+        }
+
+        inline MemoryPool* getPool() const noexcept {
+            return this->pool;
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U>& other) const noexcept {
+            return this->pool == other.getPool();
+        }
+
+        template <typename U>
+        bool operator!=(const PoolAllocator<U>& other) const noexcept {
+            return this->pool != other.getPool();
+        }
+
+    private:
+
+        MemoryPool* pool;
+    };
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ORBITALCATALOGIMPORTER_H
+#define ORBITALCATALOGIMPORTER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utils/Vector.h>
+#include <utils/CelestialBodyJSONLoader.h>
+
+namespace SolarSystem {
+    class SolarSystemModel;
+}
+
+namespace Utilities {
+
+    enum class OrbitalCatalogFormat {
+        MPCORB,     // Minor Planet Center MPCORB.DAT, fixed columns after a dashed header separator
+        JPL         // JPL asteroid or comet element dump, columns taken from the dashed line under the column titles
+    };
+
+    struct OrbitalImportSettings {
+        double centralGravitationalParameter = 1.32712440018e11;   // km^3 s^-2, the Sun
+        Vector centralPosition;                                     // Added to every imported state, km
+        Vector centralVelocity;                                     // km/s
+        double targetEpoch = 0.0;                                   // Julian date every orbit is advanced to, 0 keeps each at its own epoch
+        double albedo = 0.14;                                       // Geometric albedo used to size bodies from H
+        double density = 2000.0;                                    // kg/m^3, for masses estimated from the size
+        unsigned int threadCount = 0;                               // Zero uses one per hardware thread
+    };
+
+    class OrbitalCatalogImporter {
+
+        // Imports heliocentric ecliptic orbital elements from MPC and JPL text catalogs as Asteroid records. The file is
+        // memory mapped and split at line boundaries into one chunk per thread, every chunk parses its lines and
+        // converts the elements to a Cartesian state with KeplerPropagator, and the chunks are joined in file order.
+        // Lines that are blank or too short to hold elements are skipped, malformed numbers throw with the line number.
+        // Sizes come from the absolute magnitude H, D = 1329 km / sqrt(albedo) * 10^(-H / 5), masses from the density.
+        // JPL comet dumps give the perihelion distance q and time Tp instead of a and M and carry no H, so elliptic
+        // comets come in as massless test particles and parabolic or hyperbolic ones are skipped.
+
+    public:
+
+        static std::vector<CelestialBodyRecord> Import(const std::string& path, OrbitalCatalogFormat format,
+            const OrbitalImportSettings& settings = OrbitalImportSettings());
+
+        // Writes every object to a binary catalog and returns how many were written
+        static std::size_t ImportToCatalog(const std::string& path, OrbitalCatalogFormat format, const std::string& outputPath,
+            const OrbitalImportSettings& settings = OrbitalImportSettings());
+
+        // Adds every object to the model. Every body is paired with every other, so keep full catalogs to a binary catalog
+        // and only add the subsets the simulation integrates.
+        static std::size_t ImportToModel(const std::string& path, OrbitalCatalogFormat format, SolarSystem::SolarSystemModel& model,
+            const OrbitalImportSettings& settings = OrbitalImportSettings());
+
+        // Julian date at 0h of an MPC packed epoch such as "K24AH" (2024 October 17)
+        static double UnpackEpoch(std::string_view packed);
+    };
+}
+
+#endif
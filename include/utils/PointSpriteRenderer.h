@@ -0,0 +1,127 @@
+#ifndef POINTSPRITERENDERER_H
+#define POINTSPRITERENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace Utilities {
+
+    // One vertex of the point sprite stream, read by the vertex shader at locations 0 (position), 1 (radius) and
+    // 2 (colour, RGBA8 normalized)
+    struct PointSprite {
+        float x, y, z;
+        float radius;
+        std::uint32_t color;
+    };
+
+    class PointSpriteRenderer {
+
+        // Draws bodies too small to be worth a mesh, such as asteroid belts and debris clouds, straight from a buffer
+        // of positions, radii and colours with no per-body matrices. Sprites wider than SPLAT_DIAMETER pixels are
+        // one GL_POINTS vertex each, sized by the vertex shader and shaded as a ray-cast sphere by the fragment
+        // shader. The rest cover a single pixel and are by far the most numerous; rasterizing them one primitive
+        // at a time costs about half a microsecond each under llvmpipe, so from SPLAT_THRESHOLD sprites on they are
+        // projected on the CPU instead, the nearest one per pixel is kept, and the result is written with one full
+        // screen pass that also writes its depth. The cost then follows the screen size rather than the number of
+        // bodies. Below the threshold that fixed cost outweighs rasterizing every sprite as a point.
+
+    public:
+
+        // Points are capped at this diameter, anything larger should be a mesh
+        static constexpr float MAX_POINT_SIZE = 16.0f;
+
+        // Bodies projecting to a smaller radius in pixels are drawn as sprites rather than meshes
+        static constexpr float MESH_PIXEL_RADIUS = 4.0f;
+
+        // Sprites projecting to at most this many pixels across are resolved on the CPU
+        static constexpr float SPLAT_DIAMETER = 1.0f;
+
+        // Fewer sprites than this are all drawn as points
+        static constexpr std::size_t SPLAT_THRESHOLD = 1 << 14;
+
+        PointSpriteRenderer() = default;
+
+        PointSpriteRenderer(const PointSpriteRenderer&) = delete;
+
+        PointSpriteRenderer& operator=(const PointSpriteRenderer&) = delete;
+
+        ~PointSpriteRenderer();
+
+        // Needs a current GL context, compiles the renderer's own programs
+        void initialize();
+
+        // Releases the GL objects the renderer holds, while the context is still current
+        void shutdown();
+
+        inline bool isInitialized() const {
+            return this->spriteBuffer != 0;
+        }
+
+        // Sprites handed to the last draw()
+        inline std::size_t getSpriteCount() const {
+            return this->spriteCount;
+        }
+
+        // Sprites the last draw() drew as points, the others were resolved on the CPU or out of view
+        inline std::size_t getPointCount() const {
+            return this->pointCount;
+        }
+
+        // Pixels the last draw() wrote from sprites resolved on the CPU
+        inline std::size_t getSplatPixelCount() const {
+            return this->splatPixelCount;
+        }
+
+        // Opaque RGBA8 with red in the lowest byte, the first in memory on the little endian machines this targets
+        static std::uint32_t packColor(const glm::vec3& color);
+
+        // Queues a sprite for the next draw()
+        inline void add(const glm::vec3& position, float radius, const glm::vec3& color) {
+            sprites.push_back(PointSprite{ position.x, position.y, position.z, radius, packColor(color) });
+        }
+
+        // Draws and clears the queue into the current viewport, the projection must be a perspective one
+        void draw(const glm::mat4& view, const glm::mat4& projection);
+
+        // Draws count sprites from the caller's buffer, leaving the queue alone
+        void draw(const PointSprite* buffer, std::size_t count, const glm::mat4& view, const glm::mat4& projection);
+
+    private:
+
+        // Points
+        GLuint shaderProgram = 0;
+        GLint viewLocation = -1;
+        GLint projectionLocation = -1;
+        GLint pixelScaleLocation = -1;
+        GLint maxPointSizeLocation = -1;
+        GLuint vertexArray = 0;
+        GLuint spriteBuffer = 0;
+        std::size_t spriteBufferCapacity = 0;       // In sprites
+        std::vector<PointSprite> sprites;           // Kept between frames so the queue keeps its capacity
+        std::vector<PointSprite> points;            // Sprites of the last draw() wide enough to rasterize
+
+        // Sprites resolved on the CPU, one texel per viewport pixel
+        GLuint splatProgram = 0;
+        GLint viewportOriginLocation = -1;
+        GLuint splatVertexArray = 0;
+        GLuint splatColorTexture = 0;
+        GLuint splatDepthTexture = 0;
+        GLsizei splatWidth = 0;
+        GLsizei splatHeight = 0;
+        std::vector<std::uint32_t> splatColors;     // Zero where no sprite landed
+        std::vector<float> splatDepths;             // Window depth of the nearest sprite
+
+        std::size_t spriteCount = 0;
+        std::size_t pointCount = 0;
+        std::size_t splatPixelCount = 0;
+
+        void splat(const PointSprite* buffer, std::size_t count, const glm::mat4& viewProjection, float pixelsPerUnitAtUnitDepth, GLsizei width, GLsizei height);
+        void drawSplats(const GLint* viewport);
+        void drawPoints(const PointSprite* buffer, std::size_t count, const glm::mat4& view, const glm::mat4& projection, float pixelsPerUnitAtUnitDepth);
+    };
+}
+
+#endif
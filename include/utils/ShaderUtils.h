@@ -25,20 +25,102 @@ namespace ShaderUtils {
     const std::string vertexShaderSource = R"glsl(
        #version 330 core
         layout (location = 0) in vec3 aPos;
-        layout (location = 1) in vec3 aColor; // Add layout for vertex color
+        layout (location = 1) in vec3 aColor; // Per instance color
+        layout (location = 2) in mat4 aModel; // Per instance model matrix, takes locations 2 to 5
 
         out vec3 vertexColor; // Pass color to the fragment shader
 
-        uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
 
         void main() {
-            gl_Position = projection * view * model * vec4(aPos, 1.0);
+            gl_Position = projection * view * aModel * vec4(aPos, 1.0);
             vertexColor = aColor; // Pass the vertex color through to the fragment shader
         }
     )glsl";
 
+
+
+    // Small bodies as one point each, sized from their projected radius and shaded as a ray-cast sphere impostor
+    const std::string pointSpriteVertexShaderSource = R"glsl(
+        #version 330 core
+        layout (location = 0) in vec3 aPosition;
+        layout (location = 1) in float aRadius;
+        layout (location = 2) in vec4 aColor; // Normalized from RGBA8
+
+        out vec3 spriteColor;
+        out float spriteBrightness;
+        flat out float spriteImpostor;
+
+        uniform mat4 view;
+        uniform mat4 projection;
+        uniform float pixelsPerUnitAtUnitDepth; // Projected size of one unit at unit depth
+        uniform float maxPointSize;
+
+        void main() {
+            vec4 viewPosition = view * vec4(aPosition, 1.0);
+            gl_Position = projection * viewPosition;
+
+            // Bodies under a pixel keep one pixel and dim with their area, down to a floor that keeps lone ones visible
+            float diameter = 2.0 * aRadius * pixelsPerUnitAtUnitDepth / max(-viewPosition.z, 1e-6);
+            gl_PointSize = clamp(diameter, 1.0, maxPointSize);
+            spriteBrightness = clamp(diameter * diameter, 0.25, 1.0);
+            spriteImpostor = diameter > 2.0 ? 1.0 : 0.0;
+            spriteColor = aColor.rgb;
+        }
+    )glsl";
+
+    const std::string pointSpriteFragmentShaderSource = R"glsl(
+        #version 330 core
+        in vec3 spriteColor;
+        in float spriteBrightness;
+        flat in float spriteImpostor;
+
+        out vec4 FragColor;
+
+        void main() {
+            float shade = 1.0;
+            if (spriteImpostor > 0.5) {
+                // The sphere's normal where the view ray through this fragment hits it, discarding rays that miss
+                vec2 offset = gl_PointCoord * 2.0 - 1.0;
+                float distanceSquared = dot(offset, offset);
+                if (distanceSquared > 1.0) {
+                    discard;
+                }
+                shade = 0.35 + 0.65 * sqrt(1.0 - distanceSquared);
+            }
+            FragColor = vec4(spriteColor * (shade * spriteBrightness), 1.0);
+        }
+    )glsl";
+
+    // Full screen triangle writing the sub-pixel sprites resolved on the CPU, with their depth so meshes still hide them
+    const std::string spriteSplatVertexShaderSource = R"glsl(
+        #version 330 core
+        void main() {
+            vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+            gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+        }
+    )glsl";
+
+    const std::string spriteSplatFragmentShaderSource = R"glsl(
+        #version 330 core
+        out vec4 FragColor;
+
+        uniform sampler2D splatColor;
+        uniform sampler2D splatDepth;
+        uniform ivec2 viewportOrigin;
+
+        void main() {
+            ivec2 texel = ivec2(gl_FragCoord.xy) - viewportOrigin;
+            vec4 color = texelFetch(splatColor, texel, 0);
+            if (color.a == 0.0) {
+                discard; // No sprite landed on this pixel
+            }
+            gl_FragDepth = texelFetch(splatDepth, texel, 0).r;
+            FragColor = vec4(color.rgb, 1.0);
+        }
+    )glsl";
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef SPHERERENDERER_H
+#define SPHERERENDERER_H
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <utils/GeometryManager.h>
+
+namespace Utilities {
+
+    // Per-instance attributes, read by the vertex shader at locations 1 (colour) and 2 to 5 (model matrix columns)
+    struct SphereInstance {
+        glm::mat4 model;
+        glm::vec3 color;
+    };
+
+    class SphereRenderer {
+
+        // Draws spheres with instancing. Spheres are queued against the unit sphere mesh they use, and draw() uploads
+        // each queue into one shared instance buffer and issues a single glDrawElementsInstanced for it, so the
+        // number of draw calls follows the number of distinct meshes rather than the number of bodies. Spheres
+        // queued by projected size go through GeometryManager's level of detail chain, which the renderer holds.
+
+    public:
+
+        SphereRenderer() = default;
+
+        SphereRenderer(const SphereRenderer&) = delete;
+
+        SphereRenderer& operator=(const SphereRenderer&) = delete;
+
+        ~SphereRenderer();
+
+        // Needs a current GL context, the program must use the instanced layout of ShaderUtils::vertexShaderSource
+        void initialize(GLuint shaderProgram);
+
+        // Releases the GL objects the renderer holds, while the context is still current
+        void shutdown();
+
+        inline bool isInitialized() const {
+            return this->instanceBuffer != 0;
+        }
+
+        // Draw calls issued by the last draw()
+        inline std::size_t getDrawCalls() const {
+            return this->drawCalls;
+        }
+
+        // Instances drawn by the last draw()
+        inline std::size_t getInstanceCount() const {
+            return this->instanceCount;
+        }
+
+        // Triangles drawn by the last draw()
+        inline std::size_t getTriangleCount() const {
+            return this->triangleCount;
+        }
+
+        // Queues a sphere for the next draw(), the mesh must be a unit sphere so the model matrix carries the radius
+        void add(const GeometryManager::GeometryData& geometry, const glm::mat4& model, const glm::vec3& color);
+
+        // Queues a sphere on the level of detail mesh for its projected radius
+        void addLevelOfDetail(const glm::mat4& model, const glm::vec3& color, float pixelRadius);
+
+        // Draws and clears every queue
+        void draw(const glm::mat4& view, const glm::mat4& projection);
+
+    private:
+
+        struct Batch {
+            GeometryManager::GeometryData geometry;
+            std::vector<SphereInstance> instances;
+        };
+
+        GLuint shaderProgram = 0;
+        GLint viewLocation = -1;
+        GLint projectionLocation = -1;
+        GLuint instanceBuffer = 0;
+        std::size_t instanceBufferCapacity = 0;     // In instances
+        std::vector<Batch> batches;                 // One per mesh, kept between frames so the queues keep their capacity
+        std::vector<GeometryManager::SphereLod> sphereLods;
+        std::size_t drawCalls = 0;
+        std::size_t instanceCount = 0;
+        std::size_t triangleCount = 0;
+
+        void bindInstanceAttributes(GLuint VAO);
+    };
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Utilities {
+
+    // Bounded lock-free queue for exactly one producer thread and one consumer thread. Neither side ever blocks or
+    // allocates after construction, tryPush fails when the queue is full and tryPop when it is empty. The head and
+    // tail counters live on separate cache lines so the two threads do not contend on every operation.
+    template <typename T>
+    class SpscQueue {
+    public:
+
+        // Capacity is rounded up to a power of two
+        explicit SpscQueue(std::size_t capacity) : slots(roundUpToPowerOfTwo(capacity)), mask(slots.size() - 1) {}
+
+        SpscQueue(const SpscQueue&) = delete;
+
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        // Producer only
+        bool tryPush(T&& value) {
+            const std::size_t tail = this->tail.load(std::memory_order_relaxed);
+            if (tail - this->head.load(std::memory_order_acquire) == this->slots.size()) {
+                return false;
+            }
+            this->slots[tail & this->mask] = std::move(value);
+            this->tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool tryPop(T& value) {
+            const std::size_t head = this->head.load(std::memory_order_relaxed);
+            if (head == this->tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = std::move(this->slots[head & this->mask]);
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Only a hint while the other thread is active
+        inline bool isEmpty() const {
+            return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire);
+        }
+
+        inline std::size_t capacity() const {
+            return this->slots.size();
+        }
+
+    private:
+
+        static constexpr std::size_t CACHE_LINE = 64;
+
+        static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+            std::size_t power = 1;
+            while (power < value) {
+                power <<= 1;
+            }
+            return power;
+        }
+
+        std::vector<T> slots;
+        const std::size_t mask;
+        alignas(CACHE_LINE) std::atomic<std::size_t> head{ 0 };
+        alignas(CACHE_LINE) std::atomic<std::size_t> tail{ 0 };
+    };
+}
+
+#endif
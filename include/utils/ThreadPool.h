@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace Utilities {
+
+    // Fixed set of worker threads fed from one task queue. Meant for coarse work such as parsing a file per task,
+    // the queue is guarded by a single mutex. Exceptions thrown by a task are rethrown from its future.
+    class ThreadPool {
+    public:
+
+        // Zero starts one worker per hardware thread
+        explicit ThreadPool(unsigned int threadCount = 0);
+
+        ThreadPool(const ThreadPool&) = delete;
+
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Finishes every queued task before joining the workers
+        ~ThreadPool();
+
+        template <typename F>
+        std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& task) {
+            using Result = std::invoke_result_t<std::decay_t<F>>;
+
+            // packaged_task is move-only while std::function needs a copyable target, so it is shared
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> result = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(this->queueMutex);
+                this->tasks.emplace([packaged] { (*packaged)(); });
+            }
+            this->taskAvailable.notify_one();
+            return result;
+        }
+
+        inline unsigned int size() const {
+            return static_cast<unsigned int>(this->workers.size());
+        }
+
+    private:
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex queueMutex;
+        std::condition_variable taskAvailable;
+        bool stopping = false;
+
+        void workerLoop();
+    };
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef TRAJECTORYARCHIVE_H
+#define TRAJECTORYARCHIVE_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <utils/MappedFile.h>
+#include <utils/TrajectoryFormat.h>
+#include <utils/Vector.h>
+
+namespace Utilities {
+
+    struct TrajectorySample {
+        Vector position;
+        Vector velocity;
+    };
+
+    // Cubic Hermite interpolation between two recorded states, firstTime < time < secondTime. Returns first when the
+    // two times do not increase.
+    TrajectorySample interpolateHermite(double firstTime, const TrajectorySample& first, double secondTime, const TrajectorySample& second, double time);
+
+    class TrajectoryArchive {
+
+        // Memory mapped, read-only view of a trajectory file written by TrajectoryRecorder. Opening reads the chunk
+        // index from the footer, or rebuilds it by walking the blocks when the recording was cut short, and never
+        // touches the frame data. A query binary searches the index for the chunk, then the chunk's frame times,
+        // and interpolates between the two bracketing frames with a cubic Hermite spline through the stored
+        // positions and velocities. Uncompressed chunks are read in place; compressed ones are decoded once into a
+        // small cache, so queries that stay near each other in time only pay for decoding when they cross chunks.
+        // The cache makes queries non-const, use one archive per thread.
+
+    public:
+
+        // Throws when the file is missing or not a trajectory this version can read
+        explicit TrajectoryArchive(const std::string& path);
+
+        inline std::size_t getChunkCount() const {
+            return this->chunks.size();
+        }
+
+        inline std::uint64_t getFrameCount() const {
+            return this->chunks.empty() ? 0 : this->chunks.back().firstFrame + this->chunks.back().frameCount;
+        }
+
+        inline double getStartTime() const {
+            return this->chunks.empty() ? 0.0 : this->chunks.front().firstTime;
+        }
+
+        inline double getEndTime() const {
+            return this->chunks.empty() ? 0.0 : this->chunks.back().lastTime;
+        }
+
+        // True when the index came from the footer rather than from walking the blocks
+        inline bool hasStoredIndex() const {
+            return this->storedIndex;
+        }
+
+        // Names of the bodies recorded at the given time, empty outside the recording
+        const std::vector<std::string>& getBodyNames(double time) const;
+
+        // Chunk level access for readers that manage their own buffers, such as a prefetching player. Unlike
+        // sample() these are const and safe to call from several threads at once.
+        inline const TrajectoryIndexEntry& getChunk(std::size_t chunk) const {
+            return this->chunks[chunk];
+        }
+
+        // Chunks with the same body table number hold the same bodies at the same indices
+        inline std::uint32_t getChunkBodyTable(std::size_t chunk) const {
+            return this->chunkTables[chunk];
+        }
+
+        inline const std::vector<std::string>& getChunkBodyNames(std::size_t chunk) const {
+            return this->tables[this->chunkTables[chunk]].names;
+        }
+
+        // Index of the named body in the chunk's body table
+        std::optional<std::uint32_t> findBody(std::size_t chunk, const std::string& name) const;
+
+        // Chunk holding the given time, or the one before the gap it falls in. Times outside the recording clamp
+        // to the first or last chunk. The archive must not be empty.
+        std::size_t findChunk(double time) const;
+
+        // Copies or decodes one chunk, values are laid out as TrajectoryCodec::valueIndex describes
+        void readChunk(std::size_t chunk, std::vector<unsigned char>& scratch, std::vector<double>& times, std::vector<double>& values) const;
+
+        // State of the named body at any time inside the recording. Returns false when the time is outside the
+        // recording or the body was not recorded on both sides of it. Throws on corrupt chunk data.
+        bool sample(const std::string& name, double time, TrajectorySample& result);
+
+    private:
+
+        static constexpr std::size_t DECODED_CHUNK_CACHE = 4;
+
+        struct BodyTable {
+            std::vector<std::string> names;
+            std::unordered_map<std::string, std::uint32_t> indices;
+        };
+
+        // Frame data of one chunk, pointing into the mapping or the decoded cache
+        struct ChunkView {
+            const double* times = nullptr;
+            const double* values = nullptr;
+            std::size_t frameCount = 0;
+            std::size_t bodyCount = 0;
+        };
+
+        struct DecodedChunk {
+            std::size_t chunk = SIZE_MAX;
+            std::uint64_t lastUse = 0;
+            std::vector<double> times;
+            std::vector<double> values;
+        };
+
+        MappedFile file;
+        bool storedIndex = false;
+        std::vector<TrajectoryIndexEntry> chunks;
+        std::vector<std::uint32_t> chunkTables;         // Body table of every chunk
+        std::vector<BodyTable> tables;
+
+        std::array<DecodedChunk, DECODED_CHUNK_CACHE> decoded;
+        std::uint64_t useCounter = 0;
+        std::vector<unsigned char> decodeScratch;
+
+        bool readStoredIndex();
+        void scanBlocks();
+        void loadBodyTables();
+        const TrajectoryBlockHeader& blockAt(std::uint64_t offset, TrajectoryBlockType type) const;
+        ChunkView view(std::size_t chunk);
+    };
+}
+
+#endif
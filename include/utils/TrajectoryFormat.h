@@ -0,0 +1,122 @@
+#ifndef TRAJECTORYFORMAT_H
+#define TRAJECTORYFORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Utilities {
+
+    // Trajectory files are a header followed by a stream of blocks, each a TrajectoryBlockHeader and its payload.
+    //
+    //     BodyTable    names of the bodies in store order, applies to every chunk after it until the next table
+    //     Chunk        a TrajectoryChunkHeader followed by up to framesPerChunk consecutive frames, encoded
+    //     Index        one TrajectoryIndexEntry per chunk, written last when the recording is closed
+    //
+    // Blocks start at 8 byte aligned offsets, so uncompressed chunk data can be used in place from a mapping. A
+    // closed recording ends with a TrajectoryFileFooter pointing at its Index block; a recording that was cut short
+    // has neither and readers rebuild the index by walking the blocks.
+    //
+    // Chunk data is the frame times followed by one column per component, position x, y, z then velocity x, y, z,
+    // each holding every body's series over the chunk's frames back to back. Encoding XORs every value with the
+    // previous frame of the same series, which leaves mostly zero high bytes for smooth motion, regroups the bytes
+    // by significance so those zeros form long runs, and then compresses. Values are stored in the byte order of the
+    // writer, recorded by byteOrderMark.
+
+    enum class TrajectoryCompression : std::uint32_t {
+        None = 0,
+        ZeroRun = 1,            // Built in, run length coding of zero bytes, always available
+        Zstd = 2                // Needs a build with SOLAR_SYSTEM_WITH_ZSTD defined and zstd linked
+    };
+
+    enum class TrajectoryBlockType : std::uint32_t {
+        BodyTable = 1,
+        Chunk = 2,
+        Index = 3
+    };
+
+    enum class TrajectoryColumn : std::uint32_t {
+        PositionX,
+        PositionY,
+        PositionZ,
+        VelocityX,
+        VelocityY,
+        VelocityZ,
+        Count
+    };
+
+    struct TrajectoryFileHeader {
+        char magic[8];                      // "SSTRAJ" padded with zeros
+        std::uint32_t version;
+        std::uint32_t byteOrderMark;        // 0x01020304 as written
+    };
+
+    struct TrajectoryBlockHeader {
+        std::uint32_t type;                 // TrajectoryBlockType
+        std::uint32_t compression;          // TrajectoryCompression of the encoded part of the payload
+        std::uint64_t storedSize;           // Payload bytes following this header
+        std::uint64_t rawSize;              // Bytes of the encoded part once decoded
+    };
+
+    struct TrajectoryChunkHeader {
+        double firstTime;                   // Simulation time of the first and last frame, seconds
+        double lastTime;
+        std::uint64_t firstFrame;           // Index of the first frame in the whole recording
+        std::uint32_t frameCount;
+        std::uint32_t bodyCount;
+    };
+
+    struct TrajectoryIndexEntry {
+        double firstTime;
+        double lastTime;
+        std::uint64_t firstFrame;
+        std::uint32_t frameCount;
+        std::uint32_t bodyCount;
+        std::uint64_t chunkOffset;          // File offset of the chunk's block header
+        std::uint64_t bodyTableOffset;      // File offset of the block header of the body table in effect
+    };
+
+    struct TrajectoryFileFooter {
+        std::uint64_t indexOffset;          // File offset of the Index block header
+        std::uint64_t chunkCount;
+        char magic[8];                      // "SSTRJEND" without a terminating zero
+    };
+
+    class TrajectoryCodec {
+    public:
+
+        static constexpr char MAGIC[8] = { 'S', 'S', 'T', 'R', 'A', 'J', '\0', '\0' };
+        static constexpr char FOOTER_MAGIC[8] = { 'S', 'S', 'T', 'R', 'J', 'E', 'N', 'D' };
+        static constexpr std::size_t BLOCK_ALIGNMENT = 8;
+        static constexpr std::uint32_t VERSION = 1;
+        static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+        static constexpr std::size_t COLUMN_COUNT = static_cast<std::size_t>(TrajectoryColumn::Count);
+
+        // Index of a value in a chunk's column data
+        static inline std::size_t valueIndex(TrajectoryColumn column, std::size_t body, std::size_t frame, std::size_t bodyCount, std::size_t frameCount) {
+            return (static_cast<std::size_t>(column) * bodyCount + body) * frameCount + frame;
+        }
+
+        // Offset of the block that follows a payload ending at offset
+        static inline std::uint64_t alignBlock(std::uint64_t offset) {
+            return (offset + BLOCK_ALIGNMENT - 1) & ~static_cast<std::uint64_t>(BLOCK_ALIGNMENT - 1);
+        }
+
+        static bool isAvailable(TrajectoryCompression compression);
+
+        // Encodes frameCount times and COLUMN_COUNT * bodyCount * frameCount values into encoded, returns the raw size
+        static std::size_t encodeChunk(const TrajectoryChunkHeader& header, const double* times, const double* values,
+            TrajectoryCompression compression, std::vector<unsigned char>& scratch, std::vector<unsigned char>& encoded);
+
+        // Inverse of encodeChunk, throws on corrupt data or an unavailable compression
+        static void decodeChunk(const TrajectoryChunkHeader& header, const unsigned char* encoded, std::size_t encodedSize, std::size_t rawSize,
+            TrajectoryCompression compression, std::vector<unsigned char>& scratch, double* times, double* values);
+
+        static void encodeBodyTable(const std::vector<std::string>& names, std::vector<unsigned char>& encoded);
+
+        static std::vector<std::string> decodeBodyTable(const unsigned char* encoded, std::size_t encodedSize);
+    };
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef TRAJECTORYPLAYER_H
+#define TRAJECTORYPLAYER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utils/TrajectoryArchive.h>
+
+namespace Utilities {
+
+    class TrajectoryPlayer {
+
+        // Plays a recorded trajectory back instead of integrating it. A playback clock advances by wall time scaled
+        // by the speed, which may be negative to play backwards, and sample() gives every recorded body its Hermite
+        // interpolated state at that time, with no model behind them. A background thread keeps the chunks just
+        // ahead of the clock, in the direction of play, decoded, so the render loop only ever interpolates. Seeking
+        // far away costs one synchronous decode. Every method except the constructor and destructor is meant for a
+        // single thread, normally the render loop.
+
+    public:
+
+        // Throws when the file cannot be opened as a trajectory or holds no frames
+        explicit TrajectoryPlayer(const std::string& path, std::size_t prefetchChunks = 4);
+
+        TrajectoryPlayer(const TrajectoryPlayer&) = delete;
+
+        TrajectoryPlayer& operator=(const TrajectoryPlayer&) = delete;
+
+        ~TrajectoryPlayer();
+
+        inline double getTime() const {
+            return this->time;
+        }
+
+        inline double getStartTime() const {
+            return this->archive.getStartTime();
+        }
+
+        inline double getEndTime() const {
+            return this->archive.getEndTime();
+        }
+
+        // Simulation seconds played per wall clock second, negative plays backwards
+        inline double getSpeed() const {
+            return this->speed;
+        }
+
+        inline void setSpeed(double simulationSecondsPerSecond) {
+            this->speed = simulationSecondsPerSecond;
+        }
+
+        inline bool isPaused() const {
+            return this->paused;
+        }
+
+        inline void setPaused(bool pause) {
+            this->paused = pause;
+        }
+
+        // Chunks the render loop had to decode itself because the prefetcher had not reached them
+        inline std::uint64_t getPrefetchMisses() const {
+            return this->prefetchMisses;
+        }
+
+        // Jumps to a time, clamped to the recording
+        void seek(double newTime);
+
+        // Moves the clock on by wallSeconds at the current speed, pausing at either end of the recording
+        void advance(double wallSeconds);
+
+        // Fills samples with the state of every recorded body at the current time and returns their names in the
+        // same order. A body that stops being recorded holds its last recorded state until the next chunk begins.
+        // The names are the archive's body table, the same table always comes back at the same address. Throws the
+        // error that stopped the prefetcher, if one did.
+        const std::vector<std::string>& sample(std::vector<TrajectorySample>& samples);
+
+    private:
+
+        struct LoadedChunk {
+            std::size_t chunk = 0;
+            std::vector<double> times;
+            std::vector<double> values;
+        };
+
+        TrajectoryArchive archive;
+        const std::size_t prefetchChunks;
+        double time = 0.0;
+        double speed = 1.0;
+        bool paused = false;
+        std::uint64_t prefetchMisses = 0;
+
+        // Shared with the prefetcher, guarded by mutex
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<std::shared_ptr<const LoadedChunk>> loaded;
+        std::size_t wantedChunk = 0;
+        bool wantForward = true;
+        bool stopping = false;
+        std::exception_ptr prefetchError;           // Set when a decode failed, the prefetcher stops on it
+        std::thread prefetcher;
+
+        std::vector<unsigned char> decodeScratch;
+
+        // Index in the next chunk of every body of a chunk whose successor has a different body table
+        std::size_t remappedChunk = SIZE_MAX;
+        std::vector<std::uint32_t> remap;
+
+        void prefetchLoop();
+        void evictFarChunks();
+        std::shared_ptr<const LoadedChunk> chunkFor(std::size_t chunk);
+        const std::vector<std::uint32_t>& remapToNextChunk(std::size_t chunk);
+    };
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include <atomic>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utils/SpscQueue.h>
+#include <utils/TrajectoryFormat.h>
+
+namespace SolarSystem {
+    class SolarSystemModel;
+}
+
+namespace Utilities {
+
+    struct TrajectoryRecorderSettings {
+        unsigned int interval = 1;                                          // Record every interval-th captured step
+        std::size_t framesPerChunk = 64;
+        std::size_t bufferedFrames = 16;                                    // Snapshots that can wait for the writer
+        TrajectoryCompression compression = TrajectoryCompression::ZeroRun;
+        bool dropWhenFull = true;                                           // Otherwise capture waits for the writer
+    };
+
+    class TrajectoryRecorder {
+
+        // Records body positions and velocities to a trajectory file. capture() copies the state into a preallocated
+        // snapshot and hands it to a background writer through a lock-free queue, and the writer groups snapshots
+        // into chunks, encodes and writes them. The simulation thread never touches the file, never allocates once
+        // the buffers have grown to the body count, and by default drops a frame rather than wait when the writer
+        // has fallen a whole buffer behind. Only one thread may call capture().
+
+    public:
+
+        // Throws when the file cannot be created or the compression is not available in this build
+        TrajectoryRecorder(const std::string& path, const TrajectoryRecorderSettings& settings = TrajectoryRecorderSettings());
+
+        TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+
+        TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+        ~TrajectoryRecorder();
+
+        // Call once per simulation step with the simulation time in seconds. Returns true when a frame was queued.
+        // A time no later than the last queued frame's is not recorded, playback interpolates between frames.
+        bool capture(const SolarSystem::SolarSystemModel& model, double simulationTime);
+
+        // Writes every queued frame and the chunk index and closes the file. Rethrows a write error raised on the
+        // writer thread.
+        void close();
+
+        inline std::uint64_t getFramesRecorded() const {
+            return this->framesRecorded.load();
+        }
+
+        inline std::uint64_t getFramesDropped() const {
+            return this->framesDropped.load();
+        }
+
+        inline std::uint64_t getBytesWritten() const {
+            return this->bytesWritten.load();
+        }
+
+    private:
+
+        struct Snapshot {
+            double time = 0.0;
+            std::size_t bodyCount = 0;
+            std::vector<double> columns;                // COLUMN_COUNT columns of bodyCount values
+            bool bodiesChanged = false;
+            std::vector<std::string> names;             // Only filled when bodiesChanged
+        };
+
+        TrajectoryRecorderSettings settings;
+        std::ofstream output;
+
+        std::vector<Snapshot> snapshots;
+        SpscQueue<Snapshot*> filled;                    // Simulation thread to writer
+        SpscQueue<Snapshot*> recycled;                  // Writer back to the simulation thread
+
+        std::thread writer;
+        std::atomic<bool> stopping{ false };
+        std::exception_ptr writerError;
+        bool closed = false;
+
+        // Simulation thread state
+        std::uint64_t stepsSeen = 0;
+        double lastQueuedTime = -std::numeric_limits<double>::infinity();
+        bool bodyTableQueued = false;
+        std::vector<std::uint64_t> recordedHandles;     // Slot and generation of every body in the last frame
+
+        // Writer thread state
+        std::uint64_t nextFrame = 0;
+        TrajectoryChunkHeader chunkHeader{};
+        std::vector<double> chunkTimes;
+        std::vector<double> chunkFrames;               // Frame after frame as captured
+        std::vector<double> chunkValues;               // Regrouped into per-body series for encoding
+        std::vector<unsigned char> encodeScratch;
+        std::vector<unsigned char> encoded;
+        std::uint64_t bodyTableOffset = 0;
+        std::vector<TrajectoryIndexEntry> index;
+
+        std::atomic<std::uint64_t> framesRecorded{ 0 };
+        std::atomic<std::uint64_t> framesDropped{ 0 };
+        std::atomic<std::uint64_t> bytesWritten{ 0 };
+
+        void writerLoop();
+        void appendFrame(const Snapshot& snapshot);
+        void flushChunk();
+        void writeIndex();
+
+        // Returns the file offset of the block
+        std::uint64_t writeBlock(TrajectoryBlockType type, TrajectoryCompression compression, const void* prefix, std::size_t prefixSize,
+            const std::vector<unsigned char>& payload, std::size_t rawSize);
+    };
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TRAJECTORYRENDERER_H
+#define TRAJECTORYRENDERER_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <utils/CelestialBodyJSONLoader.h>
+#include <utils/PointSpriteRenderer.h>
+#include <utils/SphereRenderer.h>
+#include <utils/TrajectoryPlayer.h>
+
+namespace Utilities {
+
+    class TrajectoryRenderer {
+
+        // Draws what a TrajectoryPlayer samples, straight from the recording's body table, with no model and no
+        // pair table behind it. Bodies are looked up by name among the appearances given, and any the catalogs do
+        // not know are drawn as small bodies, so a recording of an imported catalog plays back in full. Bodies
+        // covering PointSpriteRenderer::MESH_PIXEL_RADIUS pixels or more go through the sphere level of detail
+        // chain, the rest are written into one buffer kept between frames and handed to the sprite renderer as is.
+
+    public:
+
+        TrajectoryRenderer() = default;
+
+        TrajectoryRenderer(const TrajectoryRenderer&) = delete;
+
+        TrajectoryRenderer& operator=(const TrajectoryRenderer&) = delete;
+
+        // Needs a current GL context, the program must use the instanced layout of ShaderUtils::vertexShaderSource
+        void initialize(GLuint shaderProgram);
+
+        // Releases the GL objects the renderer holds, while the context is still current
+        void shutdown();
+
+        // Draws the body called name at this radius and colour, replacing any appearance it had
+        void setAppearance(const std::string& name, float radius, const glm::vec3& color);
+
+        // Takes the radius of every record and the colour of the body it describes, returns how many were added
+        std::size_t addAppearances(const std::vector<CelestialBodyRecord>& records);
+
+        // Bodies the last draw() drew as meshes
+        inline std::size_t getMeshCount() const {
+            return this->meshCount;
+        }
+
+        // Bodies the last draw() handed to the sprite renderer
+        inline std::size_t getSpriteCount() const {
+            return this->sprites.size();
+        }
+
+        // Samples the player at its current time and draws every recorded body into the current viewport
+        void draw(TrajectoryPlayer& player, const glm::mat4& view, const glm::mat4& projection);
+
+    private:
+
+        struct Appearance {
+            float radius = 0.0f;
+            glm::vec3 color;
+        };
+
+        std::unordered_map<std::string, Appearance> appearances;
+
+        // Appearances by recording index, rebuilt when the body table or the appearances change
+        const std::vector<std::string>* mappedNames = nullptr;
+        bool appearancesChanged = false;
+        std::vector<Appearance> mappedAppearances;
+
+        std::vector<TrajectorySample> samples;
+        std::vector<PointSprite> sprites;           // In view space, kept between frames so it keeps its capacity
+        std::size_t meshCount = 0;
+        SphereRenderer sphereRenderer;
+        PointSpriteRenderer pointSpriteRenderer;
+
+        void mapAppearances(const std::vector<std::string>& names);
+    };
+}
+
+#endif
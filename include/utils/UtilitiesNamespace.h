@@ -1,6 +1,9 @@
 #ifndef UTILITIESNAMESPACE_H
 #define UTILITIESNAMESPACE_H
 
+#include <string>
+#include <cassert>
+
 namespace Utilities {
 
     // Mathematical constants
@@ -13,6 +16,7 @@ namespace Utilities {
 
     // Resource Locations
     const std::string CELESTIAL_BODY_LOCATION = "../resources/Celestial Bodies/";
+    const std::string CATALOG_CACHE_LOCATION = "../resources/Catalog Cache/"; // Generated, ignored by git
 
     // generic utils functions
     template<typename T>
@@ -0,0 +1,313 @@
+#ifndef VEC3_H
+#define VEC3_H
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utils/Vector.h>
+
+namespace Utilities {
+
+    // Header-only vector math for hot kernels. Everything here is constexpr where the language allows, noexcept and
+    // branch free, so calls inline across translation units and loops over Lanes vectorize. Nothing checks for zero
+    // lengths or divisors, use the *Checked functions at the bottom (or Utilities::Vector) outside the hot paths.
+    //
+    //     Vec3T<T>          three packed components, a drop-in for Vector in kernels
+    //     Vec3PaddedT<T>    the same with a fourth padding lane, aligned so one vector is one 4-wide register
+    //     Vec3xN<T, N>      N vectors in structure-of-arrays form, Vec3x4 and Vec3x8 for AVX2 and AVX-512 widths
+    //
+    // All three share one API: component members x, y and z, arithmetic operators and the free functions dot, cross,
+    // lengthSquared, length and normalize. For the batch types the "scalar" of that API is Lanes<T, N>.
+
+    template <typename T, std::size_t N>
+    struct alignas(N * sizeof(T)) Lanes {
+        T v[N] = {};
+
+        constexpr Lanes() noexcept = default;
+
+        constexpr Lanes(T value) noexcept {
+            for (std::size_t i = 0; i < N; ++i) v[i] = value;
+        }
+
+        constexpr T& operator[](std::size_t i) noexcept { return v[i]; }
+        constexpr const T& operator[](std::size_t i) const noexcept { return v[i]; }
+
+        static constexpr std::size_t size() noexcept { return N; }
+    };
+
+#define UTILITIES_LANES_OPERATOR(op)                                                                    \
+    template <typename T, std::size_t N>                                                                \
+    constexpr Lanes<T, N> operator op(const Lanes<T, N>& a, const Lanes<T, N>& b) noexcept {            \
+        Lanes<T, N> r;                                                                                  \
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = a.v[i] op b.v[i];                                  \
+        return r;                                                                                       \
+    }                                                                                                   \
+    template <typename T, std::size_t N>                                                                \
+    constexpr Lanes<T, N> operator op(const Lanes<T, N>& a, T b) noexcept {                             \
+        Lanes<T, N> r;                                                                                  \
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = a.v[i] op b;                                       \
+        return r;                                                                                       \
+    }                                                                                                   \
+    template <typename T, std::size_t N>                                                                \
+    constexpr Lanes<T, N> operator op(T a, const Lanes<T, N>& b) noexcept {                             \
+        Lanes<T, N> r;                                                                                  \
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = a op b.v[i];                                       \
+        return r;                                                                                       \
+    }                                                                                                   \
+    template <typename T, std::size_t N>                                                                \
+    constexpr Lanes<T, N>& operator op##=(Lanes<T, N>& a, const Lanes<T, N>& b) noexcept {              \
+        for (std::size_t i = 0; i < N; ++i) a.v[i] op##= b.v[i];                                        \
+        return a;                                                                                       \
+    }
+
+    UTILITIES_LANES_OPERATOR(+)
+    UTILITIES_LANES_OPERATOR(-)
+    UTILITIES_LANES_OPERATOR(*)
+    UTILITIES_LANES_OPERATOR(/)
+
+#undef UTILITIES_LANES_OPERATOR
+
+    template <typename T, std::size_t N>
+    constexpr Lanes<T, N> operator-(const Lanes<T, N>& a) noexcept {
+        Lanes<T, N> r;
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = -a.v[i];
+        return r;
+    }
+
+    // Per-lane select, lanes where mask is nonzero take a, the others b
+    template <typename T, std::size_t N>
+    constexpr Lanes<T, N> select(const Lanes<T, N>& mask, const Lanes<T, N>& a, const Lanes<T, N>& b) noexcept {
+        Lanes<T, N> r;
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = mask.v[i] != T(0) ? a.v[i] : b.v[i];
+        return r;
+    }
+
+    template <typename T, std::size_t N>
+    constexpr Lanes<T, N> min(const Lanes<T, N>& a, const Lanes<T, N>& b) noexcept {
+        Lanes<T, N> r;
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i];
+        return r;
+    }
+
+    template <typename T, std::size_t N>
+    constexpr T horizontalMin(const Lanes<T, N>& a) noexcept {
+        T minimum = a.v[0];
+        for (std::size_t i = 1; i < N; ++i) minimum = a.v[i] < minimum ? a.v[i] : minimum;
+        return minimum;
+    }
+
+    // Loads and stores N consecutive values, the pointer need not be aligned
+    template <std::size_t N, typename T>
+    inline Lanes<T, N> loadLanes(const T* source) noexcept {
+        Lanes<T, N> r;
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = source[i];
+        return r;
+    }
+
+    template <typename T, std::size_t N>
+    inline void storeLanes(T* destination, const Lanes<T, N>& a) noexcept {
+        for (std::size_t i = 0; i < N; ++i) destination[i] = a.v[i];
+    }
+
+    template <typename T, std::size_t N>
+    inline Lanes<T, N> sqrt(const Lanes<T, N>& a) noexcept {
+        Lanes<T, N> r;
+        for (std::size_t i = 0; i < N; ++i) r.v[i] = std::sqrt(a.v[i]);
+        return r;
+    }
+
+    template <typename T, std::size_t N>
+    constexpr T horizontalSum(const Lanes<T, N>& a) noexcept {
+        T sum = T(0);
+        for (std::size_t i = 0; i < N; ++i) sum += a.v[i];
+        return sum;
+    }
+
+    template <typename T>
+    struct Vec3T {
+        using Scalar = T;
+
+        T x = T(0), y = T(0), z = T(0);
+
+        constexpr Vec3T() noexcept = default;
+        constexpr Vec3T(T x, T y, T z) noexcept : x(x), y(y), z(z) {}
+
+        Vec3T(const Vector& vector) noexcept : x(T(vector.getX())), y(T(vector.getY())), z(T(vector.getZ())) {}
+
+        Vector toVector() const {
+            return Vector(x, y, z);
+        }
+    };
+
+    template <typename T>
+    struct alignas(4 * sizeof(T)) Vec3PaddedT {
+        using Scalar = T;
+
+        T x = T(0), y = T(0), z = T(0);
+        T w = T(0);                         // Padding lane, always zero so horizontal sums over four lanes stay exact
+
+        constexpr Vec3PaddedT() noexcept = default;
+        constexpr Vec3PaddedT(T x, T y, T z) noexcept : x(x), y(y), z(z) {}
+
+        Vec3PaddedT(const Vector& vector) noexcept : x(T(vector.getX())), y(T(vector.getY())), z(T(vector.getZ())) {}
+
+        Vector toVector() const {
+            return Vector(x, y, z);
+        }
+    };
+
+    template <typename T, std::size_t N>
+    struct Vec3xN {
+        using Scalar = Lanes<T, N>;
+
+        Lanes<T, N> x, y, z;
+
+        constexpr Vec3xN() noexcept = default;
+        constexpr Vec3xN(const Lanes<T, N>& x, const Lanes<T, N>& y, const Lanes<T, N>& z) noexcept : x(x), y(y), z(z) {}
+
+        // Every lane holds the same vector
+        constexpr explicit Vec3xN(const Vec3T<T>& broadcast) noexcept : x(broadcast.x), y(broadcast.y), z(broadcast.z) {}
+
+        static constexpr std::size_t width() noexcept { return N; }
+
+        constexpr Vec3T<T> get(std::size_t lane) const noexcept {
+            return Vec3T<T>(x.v[lane], y.v[lane], z.v[lane]);
+        }
+
+        constexpr void set(std::size_t lane, const Vec3T<T>& value) noexcept {
+            x.v[lane] = value.x;
+            y.v[lane] = value.y;
+            z.v[lane] = value.z;
+        }
+
+        // Gathers up to N consecutive vectors of any type with x, y and z (or getX, getY and getZ), zero filling
+        template <typename Source>
+        static Vec3xN load(const Source* source, std::size_t count = N) noexcept {
+            Vec3xN batch;
+            for (std::size_t lane = 0; lane < N && lane < count; ++lane) {
+                batch.set(lane, Vec3T<T>(source[lane]));
+            }
+            return batch;
+        }
+    };
+
+    using Vec3 = Vec3T<double>;
+    using Vec3f = Vec3T<float>;
+    using Vec3Padded = Vec3PaddedT<double>;
+    using Vec3Paddedf = Vec3PaddedT<float>;
+    using Vec3x4 = Vec3xN<double, 4>;
+    using Vec3x8 = Vec3xN<double, 8>;
+    using Vec3fx8 = Vec3xN<float, 8>;
+
+    template <typename V> struct IsVec3 : std::false_type {};
+    template <typename T> struct IsVec3<Vec3T<T>> : std::true_type {};
+    template <typename T> struct IsVec3<Vec3PaddedT<T>> : std::true_type {};
+    template <typename T, std::size_t N> struct IsVec3<Vec3xN<T, N>> : std::true_type {};
+
+    template <typename V>
+    using EnableIfVec3 = std::enable_if_t<IsVec3<V>::value, int>;
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr V operator+(const V& a, const V& b) noexcept {
+        V r; r.x = a.x + b.x; r.y = a.y + b.y; r.z = a.z + b.z;
+        return r;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr V operator-(const V& a, const V& b) noexcept {
+        V r; r.x = a.x - b.x; r.y = a.y - b.y; r.z = a.z - b.z;
+        return r;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr V operator-(const V& a) noexcept {
+        V r; r.x = -a.x; r.y = -a.y; r.z = -a.z;
+        return r;
+    }
+
+    template <typename V, typename S, EnableIfVec3<V> = 0, std::enable_if_t<std::is_convertible<S, typename V::Scalar>::value, int> = 0>
+    constexpr V operator*(const V& a, const S& s) noexcept {
+        const typename V::Scalar scale(s);
+        V r; r.x = a.x * scale; r.y = a.y * scale; r.z = a.z * scale;
+        return r;
+    }
+
+    template <typename V, typename S, EnableIfVec3<V> = 0, std::enable_if_t<std::is_convertible<S, typename V::Scalar>::value, int> = 0>
+    constexpr V operator*(const S& s, const V& a) noexcept {
+        return a * s;
+    }
+
+    // Unchecked, dividing by zero gives infinities exactly like the scalar expression would
+    template <typename V, typename S, EnableIfVec3<V> = 0, std::enable_if_t<std::is_convertible<S, typename V::Scalar>::value, int> = 0>
+    constexpr V operator/(const V& a, const S& s) noexcept {
+        const typename V::Scalar divisor(s);
+        V r; r.x = a.x / divisor; r.y = a.y / divisor; r.z = a.z / divisor;
+        return r;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr V& operator+=(V& a, const V& b) noexcept {
+        a.x += b.x; a.y += b.y; a.z += b.z;
+        return a;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr V& operator-=(V& a, const V& b) noexcept {
+        a.x -= b.x; a.y -= b.y; a.z -= b.z;
+        return a;
+    }
+
+    template <typename V, typename S, EnableIfVec3<V> = 0, std::enable_if_t<std::is_convertible<S, typename V::Scalar>::value, int> = 0>
+    constexpr V& operator*=(V& a, const S& s) noexcept {
+        a = a * s;
+        return a;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr typename V::Scalar dot(const V& a, const V& b) noexcept {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr V cross(const V& a, const V& b) noexcept {
+        V r;
+        r.x = a.y * b.z - a.z * b.y;
+        r.y = a.z * b.x - a.x * b.z;
+        r.z = a.x * b.y - a.y * b.x;
+        return r;
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    constexpr typename V::Scalar lengthSquared(const V& a) noexcept {
+        return dot(a, a);
+    }
+
+    template <typename V, EnableIfVec3<V> = 0>
+    inline typename V::Scalar length(const V& a) noexcept {
+        using std::sqrt;
+        return sqrt(lengthSquared(a));
+    }
+
+    // Unchecked, a zero vector normalizes to NaNs
+    template <typename V, EnableIfVec3<V> = 0>
+    inline V normalize(const V& a) noexcept {
+        return a * (typename V::Scalar(1) / length(a));
+    }
+
+    // Checked variants for code off the hot paths, they report the same errors as Utilities::Vector
+    template <typename T>
+    Vec3T<T> normalizeChecked(const Vec3T<T>& a) {
+        const T magnitude = length(a);
+        if (magnitude == T(0)) throw std::runtime_error("Attempt to normalize a zero vector.");
+        return a / magnitude;
+    }
+
+    template <typename T>
+    Vec3T<T> divideChecked(const Vec3T<T>& a, T divisor) {
+        if (divisor == T(0)) throw std::runtime_error("Division by zero.");
+        return a / divisor;
+    }
+}
+
+#endif
@@ -42,9 +42,19 @@ namespace Utilities {
             return Vector(scalar * vector.x, scalar * vector.y, scalar * vector.z);
         }
 
-        Vector& operator+=(const Vector& rhs);
+        Vector& operator+=(const Vector& rhs) {
+            x += rhs.x;
+            y += rhs.y;
+            z += rhs.z;
+            return *this;
+        }
 
-        Vector& operator-=(const Vector& rhs);
+        Vector& operator-=(const Vector& rhs) {
+            x -= rhs.x;
+            y -= rhs.y;
+            z -= rhs.z;
+            return *this;
+        }
 
         double dot(const Vector& rhs) const {
             return x * rhs.x + y * rhs.y + z * rhs.z;
@@ -60,11 +70,27 @@ namespace Utilities {
             return std::sqrt(x * x + y * y + z * z);
         }
 
-        Vector cross(const Vector& rhs) const;
+        Vector cross(const Vector& rhs) const {
+            return Vector(
+                y * rhs.z - z * rhs.y,
+                z * rhs.x - x * rhs.z,
+                x * rhs.y - y * rhs.x
+            );
+        }
 
-        double distanceTo(const Vector& other) const;
+        double distanceTo(const Vector& other) const {
+            return std::sqrt(
+                (x - other.x) * (x - other.x) +
+                (y - other.y) * (y - other.y) +
+                (z - other.z) * (z - other.z)
+            );
+        }
 
-        void translate(double dx, double dy, double dz);
+        void translate(double dx, double dy, double dz) {
+            x += dx;
+            y += dy;
+            z += dz;
+        }
 
         double getX() const { return x; }
         double getY() const { return y; }
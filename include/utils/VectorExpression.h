@@ -0,0 +1,198 @@
+#ifndef VECTOREXPRESSION_H
+#define VECTOREXPRESSION_H
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <utils/Vector.h>
+#include <utils/Vec3.h>
+
+namespace Utilities {
+
+    // Expression templates over Utilities::Vector. Wrapping operands in lazy() builds a tree of sums, differences
+    // and scalings that is only evaluated when assigned, one component triple at a time, so
+    //
+    //     assign(position, lazy(position) + lazy(velocity) * dt + lazy(acceleration) * (0.5 * dt * dt));
+    //
+    // compiles to a handful of fused multiply-adds with no intermediate Vector objects. Operands may also be whole
+    // std::vector<Vector> arrays, in which case the expression is evaluated element by element in a single loop and
+    // plain vectors broadcast across it. Reading the target inside the expression is fine, every element is fully
+    // evaluated before it is stored.
+
+    // Array operands of one expression must have the same length, vectors broadcast and count as zero
+    inline void checkLengths(std::size_t left, std::size_t right) {
+        if (left != right && left != 0 && right != 0) {
+            throw std::runtime_error("Vector expression combines arrays of different lengths.");
+        }
+    }
+
+    template <typename E>
+    struct VectorExpression {
+        inline const E& self() const noexcept {
+            return static_cast<const E&>(*this);
+        }
+    };
+
+    class VectorTerm : public VectorExpression<VectorTerm> {
+    public:
+        explicit VectorTerm(const Vector& vector) noexcept : vector(vector) {}
+
+        inline Vec3 at(std::size_t) const noexcept {
+            return Vec3(vector.getX(), vector.getY(), vector.getZ());
+        }
+
+        // Zero means the operand broadcasts over any array length
+        inline std::size_t size() const noexcept {
+            return 0;
+        }
+
+    private:
+        const Vector& vector;
+    };
+
+    class VectorArrayTerm : public VectorExpression<VectorArrayTerm> {
+    public:
+        explicit VectorArrayTerm(const std::vector<Vector>& vectors) noexcept : vectors(vectors) {}
+
+        inline Vec3 at(std::size_t index) const noexcept {
+            const Vector& vector = vectors[index];
+            return Vec3(vector.getX(), vector.getY(), vector.getZ());
+        }
+
+        inline std::size_t size() const noexcept {
+            return vectors.size();
+        }
+
+    private:
+        const std::vector<Vector>& vectors;
+    };
+
+    template <typename L, typename R>
+    class VectorSum : public VectorExpression<VectorSum<L, R>> {
+    public:
+        VectorSum(const L& left, const R& right) : left(left), right(right) {
+            checkLengths(left.size(), right.size());
+        }
+
+        inline Vec3 at(std::size_t index) const noexcept {
+            return left.at(index) + right.at(index);
+        }
+
+        inline std::size_t size() const noexcept {
+            return std::max(left.size(), right.size());
+        }
+
+    private:
+        L left;
+        R right;
+    };
+
+    template <typename L, typename R>
+    class VectorDifference : public VectorExpression<VectorDifference<L, R>> {
+    public:
+        VectorDifference(const L& left, const R& right) : left(left), right(right) {
+            checkLengths(left.size(), right.size());
+        }
+
+        inline Vec3 at(std::size_t index) const noexcept {
+            return left.at(index) - right.at(index);
+        }
+
+        inline std::size_t size() const noexcept {
+            return std::max(left.size(), right.size());
+        }
+
+    private:
+        L left;
+        R right;
+    };
+
+    template <typename E>
+    class ScaledVector : public VectorExpression<ScaledVector<E>> {
+    public:
+        ScaledVector(const E& expression, double scale) noexcept : expression(expression), scale(scale) {}
+
+        inline Vec3 at(std::size_t index) const noexcept {
+            return expression.at(index) * scale;
+        }
+
+        inline std::size_t size() const noexcept {
+            return expression.size();
+        }
+
+    private:
+        E expression;
+        double scale;
+    };
+
+    inline VectorTerm lazy(const Vector& vector) noexcept {
+        return VectorTerm(vector);
+    }
+
+    inline VectorArrayTerm lazy(const std::vector<Vector>& vectors) noexcept {
+        return VectorArrayTerm(vectors);
+    }
+
+    template <typename L, typename R>
+    inline VectorSum<L, R> operator+(const VectorExpression<L>& left, const VectorExpression<R>& right) {
+        return VectorSum<L, R>(left.self(), right.self());
+    }
+
+    template <typename L, typename R>
+    inline VectorDifference<L, R> operator-(const VectorExpression<L>& left, const VectorExpression<R>& right) {
+        return VectorDifference<L, R>(left.self(), right.self());
+    }
+
+    template <typename E>
+    inline ScaledVector<E> operator*(const VectorExpression<E>& expression, double scale) noexcept {
+        return ScaledVector<E>(expression.self(), scale);
+    }
+
+    template <typename E>
+    inline ScaledVector<E> operator*(double scale, const VectorExpression<E>& expression) noexcept {
+        return ScaledVector<E>(expression.self(), scale);
+    }
+
+    template <typename E>
+    inline Vector evaluate(const VectorExpression<E>& expression) noexcept {
+        const Vec3 value = expression.self().at(0);
+        return Vector(value.x, value.y, value.z);
+    }
+
+    template <typename E>
+    inline void assign(Vector& target, const VectorExpression<E>& expression) noexcept {
+        const Vec3 value = expression.self().at(0);
+        target.setX(value.x);
+        target.setY(value.y);
+        target.setZ(value.z);
+    }
+
+    // Evaluates an array expression into target, resizing it to the length of the array operands
+    template <typename E>
+    inline void assign(std::vector<Vector>& target, const VectorExpression<E>& expression) {
+        const E& fused = expression.self();
+        const std::size_t count = fused.size();
+        target.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            const Vec3 value = fused.at(i);
+            target[i] = Vector(value.x, value.y, value.z);
+        }
+    }
+
+    // target[i] += expression[i], throws unless target already has the length of the array operands
+    template <typename E>
+    inline void accumulate(std::vector<Vector>& target, const VectorExpression<E>& expression) {
+        const E& fused = expression.self();
+        const std::size_t count = target.size();
+        if (fused.size() != count && fused.size() != 0) {
+            throw std::runtime_error("Vector expression does not match the length of its target.");
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const Vec3 value = fused.at(i);
+            target[i] += Vector(value.x, value.y, value.z);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,268 @@
+
+// Headless multi-process entry point, launched under mpiexec. CMakeLists.txt builds it with SOLAR_SYSTEM_WITH_MPI
+// defined; the Visual Studio project keeps it out of the windowed executable.
+#ifdef SOLAR_SYSTEM_WITH_MPI
+
+#include <mpi.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <celestial/SolarSystemModel.h>
+#include <physics/DistributedSimulation.h>
+#include <utils/CelestialBodyJSONLoader.h>
+#include <utils/CheckpointFile.h>
+#include <utils/OrbitalCatalogImporter.h>
+#include <utils/UtilitiesNamespace.h>
+
+namespace {
+
+    // Largest relative position error --verify accepts, direct summation only differs in the order of the sums
+    constexpr double VERIFY_TOLERANCE = 1e-9;
+
+    // Test bodies for --asteroids, a main belt of Ceres-sized masses around the heaviest body
+    constexpr double TEST_BODY_MASS = 1.0e21;   // kg
+    constexpr double TEST_BELT_INNER = 2.2;     // AU
+    constexpr double TEST_BELT_OUTER = 3.3;     // AU
+    constexpr double TEST_BELT_INCLINATION = 0.1;
+
+    void appendTestBelt(std::vector<SolarSystem::DistributedBody>& bodies, std::size_t count) {
+        if (bodies.empty()) {
+            throw std::runtime_error("--asteroids needs a body to orbit.");
+        }
+        const SolarSystem::DistributedBody central = *std::max_element(bodies.begin(), bodies.end(),
+            [](const SolarSystem::DistributedBody& a, const SolarSystem::DistributedBody& b) {
+                return a.gravitationalParameter < b.gravitationalParameter;
+            });
+
+        // Fixed seed, so every run and every rank count integrates the same belt
+        std::mt19937_64 generator(0x5eed);
+        std::uniform_real_distribution<double> semiMajorAxis(TEST_BELT_INNER * Utilities::KILOMETERS_PER_ASTRONOMICAL_UNIT,
+            TEST_BELT_OUTER * Utilities::KILOMETERS_PER_ASTRONOMICAL_UNIT);
+        std::uniform_real_distribution<double> angle(0.0, 2.0 * Utilities::PI);
+        std::uniform_real_distribution<double> inclination(-TEST_BELT_INCLINATION, TEST_BELT_INCLINATION);
+
+        std::uint64_t id = bodies.size();
+        for (std::size_t i = 0; i < count; ++i) {
+            const double radius = semiMajorAxis(generator);
+            const double phase = angle(generator);
+            const double tilt = inclination(generator);
+            const double speed = std::sqrt(central.gravitationalParameter / radius);
+
+            SolarSystem::DistributedBody body;
+            body.id = id++;
+            body.gravitationalParameter = Utilities::GRAVITATIONAL_CONSTANT_KM * TEST_BODY_MASS;
+            body.position[0] = central.position[0] + radius * std::cos(phase);
+            body.position[1] = central.position[1] + radius * std::sin(phase) * std::cos(tilt);
+            body.position[2] = central.position[2] + radius * std::sin(phase) * std::sin(tilt);
+            body.velocity[0] = central.velocity[0] - speed * std::sin(phase);
+            body.velocity[1] = central.velocity[1] + speed * std::cos(phase) * std::cos(tilt);
+            body.velocity[2] = central.velocity[2] + speed * std::cos(phase) * std::sin(tilt);
+            bodies.push_back(body);
+        }
+    }
+
+    void appendCatalog(std::vector<SolarSystem::DistributedBody>& bodies, const std::string& path, Utilities::OrbitalCatalogFormat format) {
+        std::uint64_t id = bodies.size();
+        for (const Utilities::CelestialBodyRecord& record : Utilities::OrbitalCatalogImporter::Import(path, format)) {
+            SolarSystem::DistributedBody body;
+            body.id = id++;
+            body.gravitationalParameter = Utilities::GRAVITATIONAL_CONSTANT_KM * record.mass;
+            body.position[0] = record.position.getX();
+            body.position[1] = record.position.getY();
+            body.position[2] = record.position.getZ();
+            body.velocity[0] = record.velocity.getX();
+            body.velocity[1] = record.velocity.getY();
+            body.velocity[2] = record.velocity.getZ();
+            bodies.push_back(body);
+        }
+    }
+
+    // Serial kick-drift-kick with direct summation, what a distributed run at opening angle 0 reproduces
+    void integrateReference(std::vector<SolarSystem::DistributedBody>& bodies, double timestep, long steps) {
+        std::vector<double> accelerations(3 * bodies.size());
+        auto computeAccelerations = [&]() {
+            std::fill(accelerations.begin(), accelerations.end(), 0.0);
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                for (std::size_t j = 0; j < bodies.size(); ++j) {
+                    if (i == j) {
+                        continue;
+                    }
+                    double offset[3];
+                    double distanceSquared = 0.0;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        offset[axis] = bodies[j].position[axis] - bodies[i].position[axis];
+                        distanceSquared += offset[axis] * offset[axis];
+                    }
+                    if (distanceSquared == 0) {
+                        throw std::runtime_error("Attempt to calculate gravitational force between overlapping celestial bodies.");
+                    }
+                    const double factor = bodies[j].gravitationalParameter / (distanceSquared * std::sqrt(distanceSquared));
+                    for (int axis = 0; axis < 3; ++axis) {
+                        accelerations[3 * i + axis] += factor * offset[axis];
+                    }
+                }
+            }
+        };
+
+        computeAccelerations();
+        for (long step = 0; step < steps; ++step) {
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    bodies[i].velocity[axis] += 0.5 * timestep * accelerations[3 * i + axis];
+                    bodies[i].position[axis] += timestep * bodies[i].velocity[axis];
+                }
+            }
+            computeAccelerations();
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    bodies[i].velocity[axis] += 0.5 * timestep * accelerations[3 * i + axis];
+                }
+            }
+        }
+    }
+
+    // Largest position difference relative to the reference body's distance from the origin
+    double largestDeviation(const std::vector<SolarSystem::DistributedBody>& bodies, const std::vector<SolarSystem::DistributedBody>& reference) {
+        if (bodies.size() != reference.size()) {
+            return HUGE_VAL;
+        }
+        double largest = 0.0;
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            double difference = 0.0, magnitude = 0.0;
+            for (int axis = 0; axis < 3; ++axis) {
+                difference += (bodies[i].position[axis] - reference[i].position[axis]) * (bodies[i].position[axis] - reference[i].position[axis]);
+                magnitude += reference[i].position[axis] * reference[i].position[axis];
+            }
+            largest = std::max(largest, std::sqrt(difference) / std::max(1.0, std::sqrt(magnitude)));
+        }
+        return largest;
+    }
+}
+
+int main(int argc, char** argv) {
+    // --steps <n> steps of --timestep <seconds>, the bodies come from the catalog directory or --restore <file>
+    // --catalog <file> adds an MPCORB (or with --catalog-format jpl, a JPL) element export, --asteroids <n> a test belt
+    // --opening-angle <x> and --rebalance-interval <n> tune the Barnes-Hut tree and the load balancing
+    // --verify repeats the run with serial direct summation on rank 0 and fails unless both agree, use opening angle 0
+    MPI_Init(&argc, &argv);
+    int rank = 0, rankCount = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &rankCount);
+
+    long steps = 1000;
+    double timestep = 3600.0;
+    std::string restorePath;
+    std::string catalogPath;
+    Utilities::OrbitalCatalogFormat catalogFormat = Utilities::OrbitalCatalogFormat::MPCORB;
+    std::size_t asteroidCount = 0;
+    bool verify = false;
+    SolarSystem::DistributedSettings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--steps" && i + 1 < argc) {
+            steps = std::max(0L, std::strtol(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--timestep" && i + 1 < argc) {
+            timestep = std::strtod(argv[++i], nullptr);
+        }
+        else if (argument == "--restore" && i + 1 < argc) {
+            restorePath = argv[++i];
+        }
+        else if (argument == "--catalog" && i + 1 < argc) {
+            catalogPath = argv[++i];
+        }
+        else if (argument == "--catalog-format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            catalogFormat = format == "jpl" ? Utilities::OrbitalCatalogFormat::JPL : Utilities::OrbitalCatalogFormat::MPCORB;
+        }
+        else if (argument == "--asteroids" && i + 1 < argc) {
+            asteroidCount = static_cast<std::size_t>(std::max(0L, std::strtol(argv[++i], nullptr, 10)));
+        }
+        else if (argument == "--opening-angle" && i + 1 < argc) {
+            settings.openingAngle = std::strtod(argv[++i], nullptr);
+        }
+        else if (argument == "--rebalance-interval" && i + 1 < argc) {
+            settings.rebalanceInterval = static_cast<unsigned int>(std::max(0L, std::strtol(argv[++i], nullptr, 10)));
+        }
+        else if (argument == "--verify") {
+            verify = true;
+        }
+        else {
+            if (rank == 0) {
+                std::cerr << "Unknown argument: " << argument << std::endl;
+            }
+            MPI_Finalize();
+            return -1;
+        }
+    }
+
+    int exitCode = 0;
+    try {
+        // Only rank 0 reads the input, distributeBodies() hands every rank its share
+        SolarSystem::SolarSystemModel solarSystem;
+        std::vector<SolarSystem::DistributedBody> bodies;
+        if (rank == 0) {
+            if (!restorePath.empty()) {
+                solarSystem.restoreCheckpoint(Utilities::CheckpointFile::Read(restorePath));
+            }
+            else {
+                Utilities::CelestialBodyJSONLoader::LoadDirectory(Utilities::CELESTIAL_BODY_LOCATION, solarSystem);
+            }
+            bodies = SolarSystem::DistributedSimulation::collectBodies(solarSystem);
+            if (!catalogPath.empty()) {
+                appendCatalog(bodies, catalogPath, catalogFormat);
+            }
+            appendTestBelt(bodies, asteroidCount);
+        }
+
+        SolarSystem::DistributedSimulation simulation(MPI_COMM_WORLD, settings);
+        simulation.distributeBodies(bodies);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        const double start = MPI_Wtime();
+        for (long step = 0; step < steps; ++step) {
+            simulation.step(timestep);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        const double wallTime = MPI_Wtime() - start;
+
+        std::vector<SolarSystem::DistributedBody> result = simulation.gatherBodies();
+        if (rank == 0) {
+            std::cout << "Advanced " << result.size() << " bodies on " << rankCount << " ranks by " << steps << " steps of " << timestep
+                << " s in " << wallTime << " s with " << simulation.getRebalanceCount() << " rebalances" << std::endl;
+
+            // Bodies past the model's own came from the catalog or the test belt and have nowhere to go back to
+            const std::size_t modelBodies = solarSystem.getCelestialBodies().size();
+            SolarSystem::DistributedSimulation::applyBodies(std::vector<SolarSystem::DistributedBody>(result.begin(),
+                result.begin() + std::min(modelBodies, result.size())), solarSystem);
+            for (const auto& body : solarSystem.getCelestialBodies()) {
+                const Utilities::Vector position = body->getCurrentPosition();
+                std::cout << body->getCelestialBodyName() << ": " << position.getX() << ", " << position.getY() << ", " << position.getZ() << " km" << std::endl;
+            }
+
+            if (verify) {
+                integrateReference(bodies, timestep, steps);
+                const double deviation = largestDeviation(result, bodies);
+                std::cout << "Largest relative deviation from direct summation: " << deviation << std::endl;
+                if (!(deviation <= VERIFY_TOLERANCE)) {
+                    std::cerr << "Distributed run does not match direct summation" << std::endl;
+                    exitCode = 1;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        // The other ranks are waiting in a collective call that will never complete
+        std::cerr << "Rank " << rank << ": " << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Finalize();
+    return exitCode;
+}
+
+#endif
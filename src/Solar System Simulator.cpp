@@ -2,8 +2,13 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string>
 #include <celestial/CelestialBody.h>
 #include <celestial/SolarSystemModel.h>
 #include <celestial/Star.h>
@@ -12,7 +17,15 @@
 #include <utils/ShaderUtils.h>
 #include <utils/GeometryManager.h>
 #include <utils/CelestialBodyJSONLoader.h>
+#include <utils/CatalogCache.h>
 #include <utils/Camera.h>
+#include <utils/TrajectoryRecorder.h>
+#include <utils/CheckpointFile.h>
+#include <utils/TrajectoryPlayer.h>
+#include <utils/TrajectoryRenderer.h>
+
+// Without --replay-speed a recording plays from start to end in this many wall clock seconds
+static constexpr double DEFAULT_REPLAY_SECONDS = 60.0;
 
 static void error_callback(int error, const char* description) {
     std::cerr << "Error: " << description << std::endl;
@@ -28,7 +41,101 @@ static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 }
 
 
-int main(void) {
+int main(int argc, char** argv) {
+    // --record <file> writes the trajectories to file, --record-interval <n> keeps every n-th step
+    // --checkpoint <file> saves the simulation every --checkpoint-interval <n> steps and on exit, --restore <file> resumes one
+    // --replay <file> plays a recording back at --replay-speed <x> simulation seconds per second without running the physics,
+    // by default fast enough to get through it in DEFAULT_REPLAY_SECONDS
+    // --integrator kinematic|abm picks the integration method, --integrator-order <n> the number of Adams-Bashforth-Moulton steps, 10 by default
+    // --close-encounters integrates pairs closer than --encounter-ratio <x> global steps of dynamical time on their own
+    // --parareal <seconds> first advances that far with parallel-in-time integration on --parareal-threads <n> threads
+    std::string recordPath;
+    Utilities::TrajectoryRecorderSettings recorderSettings;
+    std::string checkpointPath;
+    std::string restorePath;
+    long checkpointInterval = 10000;
+    std::string replayPath;
+    std::optional<double> replaySpeed;
+    std::optional<SolarSystem::IntegrationMethod> integrationMethod;
+    std::optional<unsigned int> integratorOrder;
+    bool closeEncounters = false;
+    double encounterRatio = 16.0;
+    double pararealDuration = 0.0;
+    SolarSystem::PararealSettings pararealSettings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (argument == "--record-interval" && i + 1 < argc) {
+            recorderSettings.interval = static_cast<unsigned int>(std::max(1L, std::strtol(argv[++i], nullptr, 10)));
+        }
+        else if (argument == "--checkpoint" && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        }
+        else if (argument == "--checkpoint-interval" && i + 1 < argc) {
+            checkpointInterval = std::max(1L, std::strtol(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--restore" && i + 1 < argc) {
+            restorePath = argv[++i];
+        }
+        else if (argument == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (argument == "--replay-speed" && i + 1 < argc) {
+            replaySpeed = std::strtod(argv[++i], nullptr);
+        }
+        else if (argument == "--integrator" && i + 1 < argc) {
+            const std::string method = argv[++i];
+            if (method == "kinematic") {
+                integrationMethod = SolarSystem::IntegrationMethod::Kinematic;
+            }
+            else if (method == "abm") {
+                integrationMethod = SolarSystem::IntegrationMethod::AdamsBashforthMoulton;
+            }
+            else {
+                std::cerr << "Unknown integrator: " << method << " (expected kinematic or abm)" << std::endl;
+                return -1;
+            }
+        }
+        else if (argument == "--integrator-order" && i + 1 < argc) {
+            const long order = std::strtol(argv[++i], nullptr, 10);
+            if (order < static_cast<long>(SolarSystem::AdamsBashforthMoulton::MIN_ORDER) || order > static_cast<long>(SolarSystem::AdamsBashforthMoulton::MAX_ORDER)) {
+                std::cerr << "--integrator-order must be between " << SolarSystem::AdamsBashforthMoulton::MIN_ORDER << " and " << SolarSystem::AdamsBashforthMoulton::MAX_ORDER << std::endl;
+                return -1;
+            }
+            integratorOrder = static_cast<unsigned int>(order);
+        }
+        else if (argument == "--close-encounters") {
+            closeEncounters = true;
+        }
+        else if (argument == "--encounter-ratio" && i + 1 < argc) {
+            encounterRatio = std::strtod(argv[++i], nullptr);
+            if (!(encounterRatio > 0.0)) {
+                std::cerr << "--encounter-ratio must be positive" << std::endl;
+                return -1;
+            }
+        }
+        else if (argument == "--parareal" && i + 1 < argc) {
+            pararealDuration = std::strtod(argv[++i], nullptr);
+        }
+        else if (argument == "--parareal-threads" && i + 1 < argc) {
+            pararealSettings.threadCount = static_cast<unsigned int>(std::max(1L, std::strtol(argv[++i], nullptr, 10)));
+        }
+        else {
+            std::cerr << "Unknown argument: " << argument << std::endl;
+            return -1;
+        }
+    }
+    if (integratorOrder && integrationMethod != SolarSystem::IntegrationMethod::AdamsBashforthMoulton) {
+        std::cerr << "--integrator-order needs --integrator abm" << std::endl;
+        return -1;
+    }
+    if (!replayPath.empty() && (!recordPath.empty() || !checkpointPath.empty() || !restorePath.empty() || pararealDuration != 0.0)) {
+        std::cerr << "--replay cannot be combined with --record, --checkpoint, --restore or --parareal" << std::endl;
+        return -1;
+    }
+
     glfwSetErrorCallback(error_callback);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); 
@@ -36,6 +143,7 @@ int main(void) {
 
 
     GLFWwindow* window;
+    int exitCode = 0;
 
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
@@ -80,17 +188,67 @@ int main(void) {
         SolarSystem::SolarSystemModel solarSystem;
         solarSystem.setShaderProgram(shaderProgram);
 
+        // What was being done when an exception arrives, so each kind of failure is reported as what it is
+        const char* failure = "Error loading celestial bodies";
         try {
 
-            auto celestialBodies = Utilities::CelestialBodyJSONLoader::LoadBodies(Utilities::CELESTIAL_BODY_LOCATION);
-
-            for (auto& body : celestialBodies) {
-                solarSystem.addCelestialBody(std::move(body));
+            double simulationTime = 0.0;
+            if (!restorePath.empty()) {
+                failure = "Error restoring checkpoint";
+                const SolarSystem::ModelCheckpoint checkpoint = Utilities::CheckpointFile::Read(restorePath);
+                solarSystem.restoreCheckpoint(checkpoint);
+                simulationTime = checkpoint.simulationTime;
+            }
+            else if (replayPath.empty()) {
+                Utilities::CatalogCache catalogCache(Utilities::CATALOG_CACHE_LOCATION);
+                Utilities::CelestialBodyJSONLoader::LoadDirectory(Utilities::CELESTIAL_BODY_LOCATION, solarSystem, 0, &catalogCache);
+            }
+            // Given explicitly, the method overrides the one a restored checkpoint was saved with
+            if (integrationMethod) {
+                solarSystem.setIntegrationMethod(*integrationMethod, integratorOrder.value_or(10));
             }
+            if (closeEncounters) {
+                solarSystem.setCloseEncounterHandling(true, encounterRatio);
+            }
+            failure = "Error running the simulation";
+            if (pararealDuration != 0.0) {
+                const double start = glfwGetTime();
+                const unsigned int iterations = solarSystem.integrateParallelInTime(pararealDuration, pararealSettings);
+                simulationTime += pararealDuration;
+                std::cout << "Parareal advanced " << pararealDuration << " s in " << glfwGetTime() - start << " s with " << iterations << " iterations" << std::endl;
+            }
+
+            solarSystem.initializeGraphics(geomManager);
+            std::cout << "Sphere meshes: " << geomManager.getGeometryCount() << " using " << geomManager.getGpuMemoryBytes() / 1024 << " KiB of GPU memory" << std::endl;
 
-            for (auto& body : solarSystem.getCelestialBodies()) {
-                body->initializeGraphics(geomManager);
+            std::unique_ptr<Utilities::TrajectoryRecorder> recorder;
+            if (!recordPath.empty()) {
+                failure = "Error recording trajectories";
+                recorder = std::make_unique<Utilities::TrajectoryRecorder>(recordPath, recorderSettings);
             }
+            // Replay draws the recording's own bodies and only borrows the catalogs for their size and colour, so
+            // bodies the catalogs lack still play back and no model is built
+            std::unique_ptr<Utilities::TrajectoryPlayer> player;
+            Utilities::TrajectoryRenderer trajectoryRenderer;
+            if (!replayPath.empty()) {
+                failure = "Error reading recording";
+                player = std::make_unique<Utilities::TrajectoryPlayer>(replayPath);
+                player->setSpeed(replaySpeed.value_or((player->getEndTime() - player->getStartTime()) / DEFAULT_REPLAY_SECONDS));
+                trajectoryRenderer.initialize(shaderProgram);
+                failure = "Error loading celestial bodies";
+                Utilities::CatalogCache catalogCache(Utilities::CATALOG_CACHE_LOCATION);
+                for (const std::string& catalog : Utilities::CelestialBodyJSONLoader::FindCatalogs(Utilities::CELESTIAL_BODY_LOCATION)) {
+                    trajectoryRenderer.addAppearances(catalogCache.load(catalog));
+                }
+                std::cout << "Replaying " << replayPath << " from " << player->getStartTime() << " s to " << player->getEndTime() << " s at " << player->getSpeed() << " s per second" << std::endl;
+            }
+            double lastFrameTime = glfwGetTime();
+            bool spaceWasDown = false;
+            bool reverseWasDown = false;
+
+            const float timestep = 0.0000001f;
+            Utilities::CheckpointWriter checkpointWriter;
+            long stepsSinceCheckpoint = 0;
 
             Utilities::Camera camera(
                 1000.0f, // Position the camera 100 km from the origin, which is far enough to see both bodies
@@ -132,21 +290,74 @@ int main(void) {
                 // Update view matrix
                 glm::mat4 view = camera.GetViewMatrix();
 
-                // Render your solar system
-                solarSystem.calculateForceVectorsBasedOnTimestep(0.0000001f, 30.0f);
-                solarSystem.calculateTotalForces();
-                solarSystem.updateCelestialBodyPositionsAndVelocities(0.0000001f);
-                solarSystem.render(view, projection); // Pass the view and projection matrices to the render function
+                const double frameTime = glfwGetTime();
+                const double frameSeconds = frameTime - lastFrameTime;
+                lastFrameTime = frameTime;
+
+                if (player) {
+                    failure = "Error reading recording";
+                    // Space pauses and R reverses. Held down, [ and ] halve or double the speed every second and
+                    // comma and period scrub through a twentieth of the recording per second. Home returns to the start.
+                    const bool spaceDown = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+                    if (spaceDown && !spaceWasDown) player->setPaused(!player->isPaused());
+                    spaceWasDown = spaceDown;
+                    const bool reverseDown = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+                    if (reverseDown && !reverseWasDown) player->setSpeed(-player->getSpeed());
+                    reverseWasDown = reverseDown;
+                    const double seekStep = (player->getEndTime() - player->getStartTime()) * 0.05;
+                    if (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS) player->setSpeed(player->getSpeed() * std::pow(0.5, frameSeconds));
+                    if (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS) player->setSpeed(player->getSpeed() * std::pow(2.0, frameSeconds));
+                    if (glfwGetKey(window, GLFW_KEY_COMMA) == GLFW_PRESS) player->seek(player->getTime() - seekStep * frameSeconds);
+                    if (glfwGetKey(window, GLFW_KEY_PERIOD) == GLFW_PRESS) player->seek(player->getTime() + seekStep * frameSeconds);
+                    if (glfwGetKey(window, GLFW_KEY_HOME) == GLFW_PRESS) player->seek(player->getStartTime());
+
+                    player->advance(frameSeconds);
+                    trajectoryRenderer.draw(*player, view, projection);
+                }
+                else {
+                    // Render your solar system
+                    failure = "Error running the simulation";
+                    solarSystem.advance(timestep, 30.0f);
+                    simulationTime += timestep;
+                    if (recorder) {
+                        failure = "Error recording trajectories";
+                        recorder->capture(solarSystem, simulationTime);
+                    }
+                    // A checkpoint still being written delays the next one rather than the simulation
+                    if (!checkpointPath.empty() && ++stepsSinceCheckpoint >= checkpointInterval && !checkpointWriter.isBusy()) {
+                        SolarSystem::ModelCheckpoint checkpoint = solarSystem.captureCheckpoint();
+                        checkpoint.simulationTime = simulationTime;
+                        failure = "Error writing checkpoint";
+                        checkpointWriter.writeAsync(std::move(checkpoint), checkpointPath);
+                        stepsSinceCheckpoint = 0;
+                    }
+                    solarSystem.render(view, projection); // Pass the view and projection matrices to the render function
+                }
 
                 glfwSwapBuffers(window);
                 glfwPollEvents();
             }
+
+            if (!checkpointPath.empty()) {
+                failure = "Error writing checkpoint";
+                checkpointWriter.wait();
+                SolarSystem::ModelCheckpoint checkpoint = solarSystem.captureCheckpoint();
+                checkpoint.simulationTime = simulationTime;
+                Utilities::CheckpointFile::Write(checkpoint, checkpointPath);
+            }
+
+            if (recorder) {
+                failure = "Error recording trajectories";
+                recorder->close();
+                std::cout << "Recorded " << recorder->getFramesRecorded() << " frames (" << recorder->getFramesDropped() << " dropped) to " << recordPath << std::endl;
+            }
         }
         catch (const std::exception& e) {
-            std::cerr << "Error loading celestial bodies: " << e.what() << std::endl;
+            std::cerr << failure << ": " << e.what() << std::endl;
+            exitCode = -1;
         }
     }
 
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
\ No newline at end of file
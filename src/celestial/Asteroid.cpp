@@ -0,0 +1,4 @@
+
+#include <celestial/Asteroid.h>
+
+using namespace SolarSystem;
@@ -0,0 +1,22 @@
+
+#include <celestial/BodyArena.h>
+
+using namespace SolarSystem;
+
+void BodyDeleter::operator()(CelestialBody* body) const {
+    if (arena != nullptr) {
+        arena->destroy(body, size);
+    }
+    else {
+        delete body;
+    }
+}
+
+void BodyArena::destroy(CelestialBody* body, std::size_t size) {
+    if (body == nullptr) {
+        return;
+    }
+    body->~CelestialBody();
+    pool.deallocate(body, size);
+    --liveCount;
+}
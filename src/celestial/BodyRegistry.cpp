@@ -0,0 +1,108 @@
+
+#include <celestial/BodyRegistry.h>
+#include <stdexcept>
+
+using namespace SolarSystem;
+
+BodyHandle BodyRegistry::add(BodyPointer body) {
+    if (!body) {
+        throw std::runtime_error("Attempt to register a null celestial body.");
+    }
+
+    const std::string name = body->getCelestialBodyName();
+    if (nameIndex.find(name) != nameIndex.end()) {
+        throw std::runtime_error("A celestial body named " + name + " already exists.");
+    }
+
+    std::uint32_t slotIndex;
+    if (firstFreeSlot != BodyHandle::INVALID_SLOT) {
+        slotIndex = firstFreeSlot;
+        firstFreeSlot = slots[slotIndex].nextFree;
+    }
+    else {
+        if (slots.size() >= BodyHandle::INVALID_SLOT) {
+            throw std::runtime_error("Body registry is full.");
+        }
+        slotIndex = static_cast<std::uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+
+    Slot& slot = slots[slotIndex];
+    slot.denseIndex = static_cast<std::uint32_t>(bodies.size());
+    slot.nextFree = BodyHandle::INVALID_SLOT;
+
+    bodies.push_back(std::move(body));
+    denseSlots.push_back(slotIndex);
+
+    BodyHandle handle{ slotIndex, slot.generation };
+    nameIndex.emplace(name, handle);
+    return handle;
+}
+
+BodyRegistry::Removal BodyRegistry::remove(BodyHandle handle) {
+    if (!contains(handle)) {
+        throw std::runtime_error("Attempt to remove a celestial body through a stale handle.");
+    }
+
+    Slot& slot = slots[handle.slot];
+    const std::size_t removedIndex = slot.denseIndex;
+    const std::size_t lastIndex = bodies.size() - 1;
+
+    Removal removal{ removedIndex, lastIndex, std::move(bodies[removedIndex]) };
+    nameIndex.erase(removal.body->getCelestialBodyName());
+
+    // Swap and pop keeps the dense array packed, only the last body changes index
+    if (removedIndex != lastIndex) {
+        bodies[removedIndex] = std::move(bodies[lastIndex]);
+        denseSlots[removedIndex] = denseSlots[lastIndex];
+        slots[denseSlots[removedIndex]].denseIndex = static_cast<std::uint32_t>(removedIndex);
+    }
+    else {
+        removal.movedFromIndex = removedIndex;
+    }
+    bodies.pop_back();
+    denseSlots.pop_back();
+
+    ++slot.generation;
+    slot.denseIndex = BodyHandle::INVALID_SLOT;
+    slot.nextFree = firstFreeSlot;
+    firstFreeSlot = handle.slot;
+
+    return removal;
+}
+
+void BodyRegistry::reserve(std::size_t capacity) {
+    bodies.reserve(capacity);
+    denseSlots.reserve(capacity);
+    slots.reserve(capacity);
+    nameIndex.reserve(capacity);
+    if (capacity > nameIndex.size()) {
+        // Node size is not exposed by the map, the entry plus a next pointer and cached hash is a close upper bound
+        nameNodePool.reserve((capacity - nameIndex.size()) * (sizeof(NameIndex::value_type) + 2 * sizeof(void*) + alignof(std::max_align_t)));
+    }
+}
+
+bool BodyRegistry::contains(BodyHandle handle) const {
+    return handle.slot < slots.size()
+        && slots[handle.slot].generation == handle.generation
+        && slots[handle.slot].denseIndex != BodyHandle::INVALID_SLOT;
+}
+
+CelestialBody* BodyRegistry::get(BodyHandle handle) const {
+    return contains(handle) ? bodies[slots[handle.slot].denseIndex].get() : nullptr;
+}
+
+std::optional<std::size_t> BodyRegistry::indexOf(BodyHandle handle) const {
+    if (!contains(handle)) {
+        return std::nullopt;
+    }
+    return slots[handle.slot].denseIndex;
+}
+
+std::optional<BodyHandle> BodyRegistry::find(const std::string& name) const {
+    auto it = nameIndex.find(name);
+    if (it == nameIndex.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
@@ -0,0 +1,95 @@
+
+#include <celestial/BodyStore.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace SolarSystem;
+
+void AccelerationHistory::setDepth(std::size_t newDepth) {
+    this->depth = newDepth;
+    this->slots.reserve(std::max(this->reservedBodies, this->bodyCount) * newDepth);
+    this->slots.assign(this->bodyCount * newDepth, Utilities::Vector(0, 0, 0));
+    this->head = 0;
+    this->count = 0;
+}
+
+void AccelerationHistory::reserve(std::size_t capacity) {
+    this->reservedBodies = std::max(this->reservedBodies, capacity);
+    this->slots.reserve(this->reservedBodies * this->depth);
+}
+
+void AccelerationHistory::addBody() {
+    this->slots.resize(this->slots.size() + this->depth, Utilities::Vector(0, 0, 0));
+    ++this->bodyCount;
+    // The new body has no past, so the whole history has to be rebuilt
+    reset();
+}
+
+void AccelerationHistory::removeBody(std::size_t bodyIndex) {
+    if (bodyIndex >= this->bodyCount) {
+        throw std::out_of_range("Acceleration history body index out of range.");
+    }
+
+    // Mirrors the registry, the last body's block moves into the hole
+    const std::size_t lastBody = this->bodyCount - 1;
+    if (bodyIndex != lastBody) {
+        std::copy_n(this->slots.begin() + lastBody * this->depth, this->depth, this->slots.begin() + bodyIndex * this->depth);
+    }
+    this->slots.resize(lastBody * this->depth);
+    --this->bodyCount;
+    // The remaining entries were computed with the removed mass present
+    reset();
+}
+
+void AccelerationHistory::push(const std::vector<Utilities::Vector>& accelerations) {
+    if (this->depth == 0) {
+        return;
+    }
+    if (accelerations.size() != this->bodyCount) {
+        throw std::runtime_error("Acceleration history received the wrong number of bodies.");
+    }
+
+    this->head = (this->count == 0) ? 0 : (this->head + 1) % this->depth;
+    for (std::size_t body = 0; body < this->bodyCount; ++body) {
+        this->slots[body * this->depth + this->head] = accelerations[body];
+    }
+
+    if (this->count < this->depth) {
+        ++this->count;
+    }
+}
+
+void AccelerationHistory::restore(std::size_t newHead, std::size_t newCount, const std::vector<Utilities::Vector>& newSlots) {
+    if (newSlots.size() != this->bodyCount * this->depth || newCount > this->depth || (this->depth > 0 && newHead >= this->depth)) {
+        throw std::runtime_error("Acceleration history does not match the restored state.");
+    }
+    this->slots = newSlots;
+    this->head = newHead;
+    this->count = newCount;
+}
+
+void BodyStore::addBody(double gravitationalParameter) {
+    ++this->bodyCount;
+    this->gravitationalParameters.push_back(gravitationalParameter);
+    this->accelerations.emplace_back(0, 0, 0);
+    this->accelerationHistory.addBody();
+}
+
+void BodyStore::reserve(std::size_t capacity) {
+    this->gravitationalParameters.reserve(capacity);
+    this->accelerations.reserve(capacity);
+    this->accelerationHistory.reserve(capacity);
+}
+
+void BodyStore::removeBody(std::size_t bodyIndex) {
+    if (bodyIndex >= this->bodyCount) {
+        throw std::out_of_range("Body store index out of range.");
+    }
+
+    --this->bodyCount;
+    this->gravitationalParameters[bodyIndex] = this->gravitationalParameters.back();
+    this->gravitationalParameters.pop_back();
+    this->accelerations[bodyIndex] = this->accelerations.back();
+    this->accelerations.pop_back();
+    this->accelerationHistory.removeBody(bodyIndex);
+}
@@ -4,22 +4,26 @@
 
 using namespace SolarSystem;
 
+CelestialBody::~CelestialBody() {
+#ifndef SOLAR_SYSTEM_HEADLESS
+    if (hasGraphics()) {
+        Utilities::GeometryManager::releaseGeometryNoThrow(this->geometryID);
+    }
+#endif
+}
+
+#ifndef SOLAR_SYSTEM_HEADLESS
 void CelestialBody::initializeGraphics(Utilities::GeometryManager& geomManager) {
-    Utilities::GeometryManager::GeometryData geomData = geomManager.createSphereGeometry(radius, longitudeSegments, latitudeSegments);
+    if (hasGraphics()) {
+        return;
+    }
+    Utilities::GeometryManager::GeometryData geomData = geomManager.acquireSphereGeometry(longitudeSegments, latitudeSegments);
     this->geometryID = geomData.VAO;
     this->numIndices = geomData.indicesCount;
 }
+#endif
 
-void CelestialBody::draw(GLuint shaderProgram) {
-    Utilities::GeometryManager::GeometryData geomData = Utilities::GeometryManager::getGeometryData(this->geometryID);
-
+glm::mat4 CelestialBody::getModelMatrix() const {
     glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(currentPosition.getX(), currentPosition.getY(), currentPosition.getZ()));
-    std::printf("Position: (%d, %d, %d)\n", currentPosition.getX(), currentPosition.getY(), currentPosition.getZ());
-    model = glm::scale(model, glm::vec3(radius, radius, radius));
-
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-    glBindVertexArray(geomData.VAO);
-    glDrawElements(GL_TRIANGLES, geomData.indicesCount, GL_UNSIGNED_INT, 0);
+    return glm::scale(model, glm::vec3(radius, radius, radius));
 }
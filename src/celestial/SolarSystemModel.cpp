@@ -1,42 +1,247 @@
 #include "SolarSystemModel.h"
+#include <celestial/Star.h>
+#include <celestial/Planet.h>
+#include <celestial/Asteroid.h>
+#ifndef SOLAR_SYSTEM_HEADLESS
 #include <utils/ShaderUtils.h>
+#endif
+#include <utils/VectorExpression.h>
+#include <unordered_set>
+#include <cmath>
+#include <limits>
+#include <numeric>
 
 using namespace SolarSystem;
 
-void SolarSystemModel::addCelestialBody(std::unique_ptr<CelestialBody> celestialBody) {
-    for (const auto& existingBody : celestialBodies) {
-        std::pair<const CelestialBody*, const CelestialBody*> newPair(existingBody.get(), celestialBody.get());
+namespace {
 
-        forceCalculationMap[newPair] = std::make_pair(0, Utilities::Vector(0, 0, 0));
+    // The Runge-Kutta startup steps are subdivided so their error stays below that of the high order multistep method
+    constexpr unsigned int RUNGE_KUTTA_STARTUP_SUBSTEPS = 8;
+
+    // Below this many new pairs, starting threads costs more than filling the rows
+    constexpr std::size_t PARALLEL_PAIR_BUILD_THRESHOLD = 1 << 16;
+
+    // The pair table costs about 72 bytes a pair, some 600 MB at this many bodies. Larger systems drop it and take
+    // their forces from the direct kernel every step, so their memory stays linear in the body count.
+    constexpr std::size_t PAIR_TABLE_BODY_LIMIT = 4096;}
+
+BodyHandle SolarSystemModel::addCelestialBody(std::unique_ptr<CelestialBody> celestialBody) {
+    // A default BodyDeleter deletes through the heap, matching how the body was created
+    return registerCelestialBody(BodyPointer(celestialBody.release()));
+}
+
+std::vector<BodyHandle> SolarSystemModel::addCelestialBodies(std::vector<std::unique_ptr<CelestialBody>> celestialBodies) {
+    // Validate up front so a bad batch leaves the system untouched
+    std::unordered_set<std::string> batchNames;
+    batchNames.reserve(celestialBodies.size());
+    for (const auto& celestialBody : celestialBodies) {
+        if (!celestialBody) {
+            throw std::runtime_error("Attempt to add a null celestial body.");
+        }
+        const std::string& name = celestialBody->getCelestialBodyName();
+        if (bodyRegistry.find(name) || !batchNames.insert(name).second) {
+            throw std::runtime_error("A celestial body named " + name + " already exists.");
+        }
     }
-    this->celestialBodies.push_back(std::move(celestialBody));
+
+    const std::size_t firstNewBody = bodyRegistry.size();
+    reserveBodyState(firstNewBody + celestialBodies.size());
+
+    std::vector<BodyHandle> handles;
+    handles.reserve(celestialBodies.size());
+    for (auto& celestialBody : celestialBodies) {
+        const double gravitationalParameter = Utilities::MathUtils::calculateGravitationalParameter(celestialBody->getMass());
+        handles.push_back(bodyRegistry.add(BodyPointer(celestialBody.release())));
+        bodyStore.addBody(gravitationalParameter);
+    }
+
+    buildPairRows(firstNewBody);
+    historyIsCurrent = false;
+    clearCloseEncounters();
+    return handles;
 }
 
-void SolarSystemModel::removeCelestialBody(const std::string& name) {
-    auto it = std::find_if(celestialBodies.begin(), celestialBodies.end(),
-        [&name](const std::unique_ptr<CelestialBody>& body) {
-            return body->getCelestialBodyName() == name;
-        });
+BodyHandle SolarSystemModel::registerCelestialBody(BodyPointer celestialBody) {
+    if (!celestialBody) {
+        throw std::runtime_error("Attempt to add a null celestial body.");
+    }
+
+    const std::size_t newIndex = bodyRegistry.size();
+    const double gravitationalParameter = Utilities::MathUtils::calculateGravitationalParameter(celestialBody->getMass());
 
-    if (it != celestialBodies.end()) {
-        celestialBodies.erase(it);
+    // Registering first rejects duplicate names before any pair state exists for the body
+    BodyHandle handle = bodyRegistry.add(std::move(celestialBody));
+    this->bodyStore.addBody(gravitationalParameter);
+
+    buildPairRows(newIndex);
+    this->historyIsCurrent = false;
+    clearCloseEncounters();
+    return handle;
+}
+
+void SolarSystemModel::buildPairRows(std::size_t firstNewBody) {
+    if (!usesPairTable()) {
+        std::vector<PairEntry>().swap(pairInteractions);
+        return;
+    }
+
+    const auto& celestialBodies = bodyRegistry.getBodies();
+    const std::size_t bodyCount = celestialBodies.size();
+    if (firstNewBody >= bodyCount) {
+        return;
+    }
+
+    const std::size_t firstNewPair = pairIndex(0, firstNewBody);
+    const std::size_t pairCount = pairIndex(0, bodyCount);
+    pairInteractions.resize(pairCount);
+
+    // Rows never overlap, so any split of them can be filled concurrently
+    auto fillRows = [this, &celestialBodies](std::size_t firstRow, std::size_t endRow) {
+        for (std::size_t second = firstRow; second < endRow; ++second) {
+            PairEntry* row = pairInteractions.data() + pairIndex(0, second);
+            const CelestialBody* secondBody = celestialBodies[second].get();
+            for (std::size_t first = 0; first < second; ++first) {
+                row[first] = PairEntry(PairKey(celestialBodies[first].get(), secondBody), PairInteraction{ 0, Utilities::Vector(0, 0, 0), first, second });
+            }
+        }
+    };
+
+    const std::size_t newPairs = pairCount - firstNewPair;
+    const unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (newPairs < PARALLEL_PAIR_BUILD_THRESHOLD || threadCount == 1) {
+        fillRows(firstNewBody, bodyCount);
+        return;
+    }
+
+    // Rows grow with the body index, so split on pair counts rather than row counts to balance the threads
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    std::size_t firstRow = firstNewBody;
+    for (unsigned int t = 0; t < threadCount && firstRow < bodyCount; ++t) {
+        const std::size_t pairLimit = firstNewPair + newPairs / threadCount * (t + 1);
+        std::size_t endRow = firstRow;
+        while (endRow < bodyCount && (t + 1 == threadCount || pairIndex(0, endRow + 1) <= pairLimit)) {
+            ++endRow;
+        }
+        endRow = std::max(endRow, firstRow + 1);
+        threads.emplace_back(fillRows, firstRow, endRow);
+        firstRow = endRow;
+    }
+    for (auto& thread : threads) {
+        thread.join();
     }
 }
 
-std::pair<int, Utilities::Vector> SolarSystemModel::getForceBetweenBodies(const CelestialBody* body1, const CelestialBody* body2) const {
-    std::pair<const SolarSystem::CelestialBody*, const SolarSystem::CelestialBody*> key = { body1, body2 };
+void SolarSystemModel::reserveBodyState(std::size_t bodyCount) {
+    bodyRegistry.reserve(bodyCount);
+    bodyStore.reserve(bodyCount);
+    encounterGroupOf.reserve(bodyCount);
+    if (bodyCount <= PAIR_TABLE_BODY_LIMIT) {
+        pairInteractions.reserve(bodyCount > 1 ? pairIndex(0, bodyCount) : 0);
+    }
+}
 
-    auto it = forceCalculationMap.find(key);
+bool SolarSystemModel::usesPairTable() const {
+    return bodyRegistry.size() <= PAIR_TABLE_BODY_LIMIT;
+}
 
-    if (it != forceCalculationMap.end()) {
-        return it->second;
+bool SolarSystemModel::removeCelestialBody(const std::string& name) {
+    std::optional<BodyHandle> handle = bodyRegistry.find(name);
+    return handle.has_value() && removeCelestialBody(*handle);
+}
+
+bool SolarSystemModel::removeCelestialBody(BodyHandle handle) {
+    std::optional<std::size_t> index = bodyRegistry.indexOf(handle);
+    if (!index) {
+        return false;
+    }
+
+    const std::size_t removedIndex = *index;
+    const std::size_t lastIndex = bodyRegistry.size() - 1;
+    const auto& celestialBodies = bodyRegistry.getBodies();
+    const CelestialBody* movedBody = celestialBodies[lastIndex].get();
+    const bool hadPairTable = usesPairTable();
+
+    // The last body takes over the removed body's index, so its row is copied over the removed body's pairs and
+    // the last row dropped. Pairs whose order flips have their coupling, which points from first to second, negated.
+    if (hadPairTable && removedIndex != lastIndex) {
+        for (std::size_t other = 0; other < lastIndex; ++other) {
+            if (other == removedIndex) {
+                continue;
+            }
+            const std::size_t first = std::min(other, removedIndex);
+            const std::size_t second = std::max(other, removedIndex);
+            PairEntry& target = pairInteractions[pairIndex(first, second)];
+
+            target.second = pairInteractions[pairIndex(other, lastIndex)].second;
+            target.second.firstIndex = first;
+            target.second.secondIndex = second;
+            if (other > removedIndex) {
+                target.second.coupling = target.second.coupling * -1.0;
+                target.first = PairKey(movedBody, celestialBodies[other].get());
+            }
+            else {
+                target.first = PairKey(celestialBodies[other].get(), movedBody);
+            }
+        }
+    }
+    if (hadPairTable) {
+        pairInteractions.resize(lastIndex > 0 ? pairIndex(0, lastIndex) : 0);
+    }
+
+    bodyStore.removeBody(removedIndex);
+    bodyRegistry.remove(handle);
+    if (!hadPairTable) {
+        // Back at the limit the table returns, with every pair due for recomputation
+        buildPairRows(0);
+    }
+    historyIsCurrent = false;
+    clearCloseEncounters();
+    return true;
+}
+
+std::optional<std::size_t> SolarSystemModel::indexOfBody(const CelestialBody* celestialBody) const {
+    if (celestialBody == nullptr) {
+        return std::nullopt;
+    }
+    std::optional<BodyHandle> handle = bodyRegistry.find(celestialBody->getCelestialBodyName());
+    if (!handle || bodyRegistry.get(*handle) != celestialBody) {
+        return std::nullopt;
+    }
+    return bodyRegistry.indexOf(*handle);
+}
+
+std::pair<int, Utilities::Vector> SolarSystemModel::getForceBetweenBodies(const CelestialBody* body1, const CelestialBody* body2) const {
+    std::optional<std::size_t> index1 = indexOfBody(body1);
+    std::optional<std::size_t> index2 = indexOfBody(body2);
+
+    if (index1 && index2 && *index1 != *index2) {
+        const std::size_t first = std::min(*index1, *index2);
+        const std::size_t second = std::max(*index1, *index2);
+        int score = 0;
+        Utilities::Vector coupling;
+        if (usesPairTable()) {
+            const PairInteraction& interaction = pairInteractions[pairIndex(first, second)].second;
+            score = interaction.score;
+            coupling = interaction.coupling;
+        }
+        else {
+            const auto& celestialBodies = bodyRegistry.getBodies();
+            coupling = Utilities::MathUtils::calculateGravitationalCoupling(celestialBodies[first]->getCurrentPosition(), celestialBodies[second]->getCurrentPosition());
+        }
+        // F = G m1 m2 / r^2 == mu1 * (mu2 / G) * coupling, which stays well inside double range for any pair of bodies
+        double forceScale = bodyStore.getGravitationalParameter(first) * (bodyStore.getGravitationalParameter(second) / Utilities::GRAVITATIONAL_CONSTANT_KM);
+        if (*index1 > *index2) {
+            forceScale = -forceScale;
+        }
+        return std::make_pair(score, coupling * forceScale);
     }
 
     return std::make_pair(-1, 0.0);
 }
 
-int SolarSystemModel::determineNewScore(const Utilities::Vector& force, float timestep) {
-    double forceMagnitude = force.magnitude();
+int SolarSystemModel::determineNewScore(const PairInteraction& interaction, float timestep) {
+    double forceMagnitude = bodyStore.getGravitationalParameter(interaction.firstIndex) * (bodyStore.getGravitationalParameter(interaction.secondIndex) / Utilities::GRAVITATIONAL_CONSTANT_KM) * interaction.coupling.magnitude();
     // Logarithm of force magnitude to compress the range
     double logForceMagnitude = std::log10(forceMagnitude + 1.0);
 
@@ -78,44 +283,46 @@ int SolarSystemModel::adjustScoreBasedOnTimestep(int currentScore, float timeste
 
 void SolarSystemModel::processForceCalculationForPair(
     const std::pair<const CelestialBody*, const CelestialBody*>& pair,
-    int& score,
-    Utilities::Vector& force,
+    PairInteraction& interaction,
     float timestep,
     float fps) {
 
-    if (score <= 0) {
-        force = Utilities::MathUtils::calculateGravitationalForceBetweenMasses(*pair.first, *pair.second);
-        score = determineNewScore(force, timestep);
+    // The close encounter subsystem owns this pair, evaluating it here would force the global step to collapse
+    if (interaction.inEncounter) {
+        return;
+    }
+
+    if (interaction.score <= 0) {
+        interaction.coupling = Utilities::MathUtils::calculateGravitationalCoupling(pair.first->getCurrentPosition(), pair.second->getCurrentPosition());
+        interaction.score = determineNewScore(interaction, timestep);
         std::printf("Calculating Force\n");
     }
     else {
-        score -= adjustScoreBasedOnTimestep(score, timestep, fps); 
+        interaction.score -= adjustScoreBasedOnTimestep(interaction.score, timestep, fps); 
     }
 }
 
 void SolarSystemModel::calculateForceVectorsBasedOnTimestep(float timestep, float fps) {
-    for (auto& entry : forceCalculationMap) {
-        auto& pair = entry.first;
-        auto& scoreAndForce = entry.second;
-        processForceCalculationForPair(pair, scoreAndForce.first, scoreAndForce.second, timestep, fps);
+    for (auto& entry : pairInteractions) {
+        processForceCalculationForPair(entry.first, entry.second, timestep, fps);
     }
 }
 
 
 void SolarSystemModel::calculateForceVectorsBasedOnTimestepParrallelized(float timestep, float fps) {
     unsigned int numThreads = std::thread::hardware_concurrency();
-    auto totalEntries = forceCalculationMap.size();
+    auto totalEntries = pairInteractions.size();
     auto entriesPerThread = static_cast<size_t>(std::ceil(totalEntries / static_cast<double>(numThreads)));
 
     std::vector<std::thread> threads;
-    auto it = forceCalculationMap.begin();
+    auto it = pairInteractions.begin();
 
-    for (unsigned int i = 0; i < numThreads && it != forceCalculationMap.end(); ++i) {
+    for (unsigned int i = 0; i < numThreads && it != pairInteractions.end(); ++i) {
         threads.emplace_back([&, i, this, timestep] {
             auto start = std::next(it, i * entriesPerThread);
-            auto end = (static_cast<unsigned long long>(i) + 1) * entriesPerThread > totalEntries ? forceCalculationMap.end() : std::next(start, entriesPerThread);
-            for (auto &it = start; it != end && it != forceCalculationMap.end(); ++it) {
-                processForceCalculationForPair(it->first, it->second.first, it->second.second, timestep, fps);
+            auto end = (static_cast<unsigned long long>(i) + 1) * entriesPerThread > totalEntries ? pairInteractions.end() : std::next(start, entriesPerThread);
+            for (auto &it = start; it != end && it != pairInteractions.end(); ++it) {
+                processForceCalculationForPair(it->first, it->second, timestep, fps);
             }
             });
     }
@@ -129,59 +336,701 @@ void SolarSystemModel::calculateForceVectorsBasedOnTimestepParrallelized(float t
 
 
 void SolarSystemModel::calculateTotalForces() {
-    netForces.clear();
-    for (const auto& bodyPtr : celestialBodies) {
-        netForces[bodyPtr.get()] = Utilities::Vector(0, 0, 0);
+    std::vector<Utilities::Vector>& accelerations = bodyStore.getAccelerations();
+    const std::vector<double>& gravitationalParameters = bodyStore.getGravitationalParameters();
+
+    if (!usesPairTable()) {
+        calculateDirectAccelerations();
+        return;
     }
 
-    for (const auto& entry : forceCalculationMap) {
-        const auto& bodyPair = entry.first;
-        const auto& forceInfo = entry.second;
-        const auto& forceVector = forceInfo.second;
+    std::fill(accelerations.begin(), accelerations.end(), Utilities::Vector(0, 0, 0));
 
-        netForces[bodyPair.first] += forceVector;
-        netForces[bodyPair.second] -= forceVector;
+    for (const auto& entry : pairInteractions) {
+        const PairInteraction& interaction = entry.second;
+
+        accelerations[interaction.firstIndex] += interaction.coupling * gravitationalParameters[interaction.secondIndex];
+        accelerations[interaction.secondIndex] -= interaction.coupling * gravitationalParameters[interaction.firstIndex];
     }
 }
 
 
+void SolarSystemModel::calculateDirectAccelerations() {
+    const auto& celestialBodies = bodyRegistry.getBodies();
+    const std::vector<double>& gravitationalParameters = bodyStore.getGravitationalParameters();
+    std::vector<Utilities::Vector>& accelerations = bodyStore.getAccelerations();
+
+    directPositions.resize(celestialBodies.size());
+    for (std::size_t i = 0; i < celestialBodies.size(); ++i) {
+        directPositions[i] = celestialBodies[i]->getCurrentPosition();
+    }
+    Utilities::MathUtils::calculateAccelerations(directPositions, gravitationalParameters, accelerations);
+
+    // The kernel sums every pair, the ones inside an encounter group belong to the subsystem and are taken back out
+    for (const auto& group : encounterGroups) {
+        for (std::size_t a = 0; a < group.members.size(); ++a) {
+            for (std::size_t b = a + 1; b < group.members.size(); ++b) {
+                const std::size_t first = group.members[a];
+                const std::size_t second = group.members[b];
+                Utilities::Vector coupling = Utilities::MathUtils::calculateGravitationalCoupling(directPositions[first], directPositions[second]);
+                accelerations[first] -= coupling * gravitationalParameters[second];
+                accelerations[second] += coupling * gravitationalParameters[first];
+            }
+        }
+    }
+}
+
 void SolarSystemModel::updateCelestialBodyPositionsAndVelocities(float timestep) {
-    for (auto& body : celestialBodies) {
-        Utilities::Vector currentAcceleration = netForces[body.get()] / body->getMass();
+    using Utilities::lazy;
+    const std::vector<Utilities::Vector>& accelerations = bodyStore.getAccelerations();
+    const double halfTimestepSquared = 0.5 * timestep * timestep;
+
+    for (std::size_t i = 0; i < bodyRegistry.size(); ++i) {
+        CelestialBody& body = *bodyRegistry.getBodies()[i];
+        const Utilities::Vector& currentAcceleration = accelerations[i];
+
+        // Both updates are fused per component, the position reads the velocity before it is advanced
+        body.setPosition(Utilities::evaluate(lazy(body.getCurrentPosition()) + lazy(body.getVelocity()) * timestep + lazy(currentAcceleration) * halfTimestepSquared));
+        body.setVelocity(Utilities::evaluate(lazy(body.getVelocity()) + lazy(currentAcceleration) * timestep));
+    }
+}
+
+void SolarSystemModel::calculateForceVectorsExact() {
+    for (auto& entry : pairInteractions) {
+        if (entry.second.inEncounter) {
+            continue;
+        }
+        entry.second.coupling = Utilities::MathUtils::calculateGravitationalCoupling(entry.first.first->getCurrentPosition(), entry.first.second->getCurrentPosition());
+    }
+}
+
+void SolarSystemModel::setIntegrationMethod(IntegrationMethod method, unsigned int order) {
+    if (method == IntegrationMethod::AdamsBashforthMoulton) {
+        multistepCoefficients = AdamsBashforthMoulton(order);
+        bodyStore.getAccelerationHistory().setDepth(order);
+    }
+    else {
+        bodyStore.getAccelerationHistory().setDepth(0);
+    }
+
+    integrationMethod = method;
+    historyIsCurrent = false;
+}
+
+void SolarSystemModel::advance(float timestep, float fps) {
+    frameArena.reset();
+
+    if (closeEncounterHandling) {
+        // Multistep history is only valid while every body keeps the same set of interactions
+        if (updateCloseEncounters(timestep)) {
+            bodyStore.getAccelerationHistory().reset();
+            historyIsCurrent = false;
+        }
+        beginCloseEncounterStep();
+    }
+
+    switch (integrationMethod) {
+    case IntegrationMethod::AdamsBashforthMoulton:
+        advanceAdamsBashforthMoulton(timestep);
+        break;
+    case IntegrationMethod::Kinematic:
+    default:
+        calculateForceVectorsBasedOnTimestep(timestep, fps);
+        calculateTotalForces();
+        updateCelestialBodyPositionsAndVelocities(timestep);
+        break;
+    }
+
+    if (closeEncounterHandling) {
+        finishCloseEncounterStep(timestep);
+    }
+}
+
+unsigned int SolarSystemModel::integrateParallelInTime(double duration, const PararealSettings& settings) {
+    NBodyState state;
+    state.positions.reserve(bodyRegistry.size());
+    state.velocities.reserve(bodyRegistry.size());
+    for (const auto& body : bodyRegistry.getBodies()) {
+        state.positions.push_back(body->getCurrentPosition());
+        state.velocities.push_back(body->getVelocity());
+    }
+
+    PararealIntegrator integrator(bodyStore.getGravitationalParameters(), settings);
+    NBodyState result = integrator.integrate(state, duration);
+
+    for (std::size_t i = 0; i < bodyRegistry.size(); ++i) {
+        bodyRegistry.getBodies()[i]->setPosition(result.positions[i]);
+        bodyRegistry.getBodies()[i]->setVelocity(result.velocities[i]);
+    }
+
+    // Nothing in the stored history matches the new state
+    bodyStore.getAccelerationHistory().reset();
+    historyIsCurrent = false;
+    for (auto& entry : pairInteractions) {
+        entry.second.score = 0;
+    }
+
+    return integrator.getIterationsUsed();
+}
+
+void SolarSystemModel::setCloseEncounterHandling(bool enabled, double timescaleRatio) {
+    closeEncounterHandling = enabled;
+    encounterTimescaleRatio = timescaleRatio;
+    clearCloseEncounters();
+}
+
+std::vector<std::vector<std::size_t>> SolarSystemModel::getCloseEncounterGroups() const {
+    std::vector<std::vector<std::size_t>> groups;
+    groups.reserve(encounterGroups.size());
+    for (const auto& group : encounterGroups) {
+        groups.push_back(group.members);
+    }
+    return groups;
+}
+
+ModelCheckpoint SolarSystemModel::captureCheckpoint() const {
+    const auto& celestialBodies = bodyRegistry.getBodies();
+    const std::size_t bodyCount = celestialBodies.size();
+    ModelCheckpoint checkpoint;
+
+    checkpoint.bodyTypes.reserve(bodyCount);
+    checkpoint.names.reserve(bodyCount);
+    checkpoint.masses.reserve(bodyCount);
+    checkpoint.radii.reserve(bodyCount);
+    checkpoint.angularVelocities.reserve(bodyCount);
+    checkpoint.luminosities.reserve(bodyCount);
+    checkpoint.surfaceTemperatures.reserve(bodyCount);
+    checkpoint.positions.reserve(bodyCount);
+    checkpoint.velocities.reserve(bodyCount);
+
+    for (const auto& body : celestialBodies) {
+        double luminosity = 0.0;
+        double surfaceTemperature = 0.0;
+        // Most derived type first, restoring has to construct exactly the same class
+        if (const Star* star = dynamic_cast<const Star*>(body.get())) {
+            checkpoint.bodyTypes.push_back(CheckpointBodyType::Star);
+            luminosity = star->getLuminosity();
+            surfaceTemperature = star->getTemperature();
+        }
+        else if (dynamic_cast<const Asteroid*>(body.get()) != nullptr) {
+            checkpoint.bodyTypes.push_back(CheckpointBodyType::Asteroid);
+        }
+        else if (dynamic_cast<const Planet*>(body.get()) != nullptr) {
+            checkpoint.bodyTypes.push_back(CheckpointBodyType::Planet);
+        }
+        else {
+            throw std::runtime_error("Cannot checkpoint " + body->getCelestialBodyName() + ", only stars, planets and asteroids can be restored.");
+        }
+
+        checkpoint.names.push_back(body->getCelestialBodyName());
+        checkpoint.masses.push_back(body->getMass());
+        checkpoint.radii.push_back(body->getRadius());
+        checkpoint.angularVelocities.push_back(body->getAngularVelocity());
+        checkpoint.luminosities.push_back(luminosity);
+        checkpoint.surfaceTemperatures.push_back(surfaceTemperature);
+        checkpoint.positions.push_back(body->getCurrentPosition());
+        checkpoint.velocities.push_back(body->getVelocity());
+    }
+    checkpoint.accelerations = bodyStore.getAccelerations();
+
+    const std::size_t pairCount = pairInteractions.size();
+    checkpoint.pairScores.resize(pairCount);
+    checkpoint.pairCouplings.resize(pairCount);
+    checkpoint.pairInEncounter.resize(pairCount);
+    for (std::size_t pair = 0; pair < pairCount; ++pair) {
+        const PairInteraction& interaction = pairInteractions[pair].second;
+        checkpoint.pairScores[pair] = interaction.score;
+        checkpoint.pairCouplings[pair] = interaction.coupling;
+        checkpoint.pairInEncounter[pair] = interaction.inEncounter ? 1 : 0;
+    }
+
+    const AccelerationHistory& history = bodyStore.getAccelerationHistory();
+    checkpoint.integrationMethod = integrationMethod;
+    checkpoint.multistepOrder = multistepCoefficients.getOrder();
+    checkpoint.multistepTimestep = multistepTimestep;
+    checkpoint.historyIsCurrent = historyIsCurrent;
+    checkpoint.historyHead = history.getHead();
+    checkpoint.historyCount = history.getCount();
+    checkpoint.historySlots = history.getSlots();
+
+    checkpoint.closeEncounterHandling = closeEncounterHandling;
+    checkpoint.encounterTimescaleRatio = encounterTimescaleRatio;
+    checkpoint.encounterGroupOf.reserve(bodyCount);
+    for (std::size_t group : encounterGroupOf) {
+        checkpoint.encounterGroupOf.push_back(group == NO_ENCOUNTER_GROUP ? UINT64_MAX : static_cast<std::uint64_t>(group));
+    }
+
+    return checkpoint;
+}
+
+void SolarSystemModel::restoreCheckpoint(const ModelCheckpoint& checkpoint) {
+    if (bodyRegistry.size() != 0) {
+        throw std::runtime_error("A checkpoint can only be restored into an empty model.");
+    }
+
+    const std::size_t bodyCount = checkpoint.bodyCount();
+    const std::size_t pairCount = bodyCount > 1 && bodyCount <= PAIR_TABLE_BODY_LIMIT ? pairIndex(0, bodyCount) : 0;
+    const std::size_t historyDepth = checkpoint.integrationMethod == IntegrationMethod::AdamsBashforthMoulton ? checkpoint.multistepOrder : 0;
+    if (checkpoint.bodyTypes.size() != bodyCount || checkpoint.masses.size() != bodyCount || checkpoint.radii.size() != bodyCount
+        || checkpoint.angularVelocities.size() != bodyCount || checkpoint.luminosities.size() != bodyCount
+        || checkpoint.surfaceTemperatures.size() != bodyCount || checkpoint.positions.size() != bodyCount
+        || checkpoint.velocities.size() != bodyCount || checkpoint.accelerations.size() != bodyCount
+        || checkpoint.encounterGroupOf.size() != bodyCount || checkpoint.pairScores.size() != pairCount
+        || checkpoint.pairCouplings.size() != pairCount || checkpoint.pairInEncounter.size() != pairCount
+        || checkpoint.historySlots.size() != bodyCount * historyDepth) {
+        throw std::runtime_error("Checkpoint arrays do not match its body count.");
+    }
+
+    // Bodies go back in store order, so every pair and per-body entry lands at the index it was saved from
+    reserveCelestialBodies<Star>(bodyCount);
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        switch (checkpoint.bodyTypes[i]) {
+        case CheckpointBodyType::Star:
+            emplaceCelestialBody<Star>(checkpoint.masses[i], checkpoint.velocities[i], checkpoint.radii[i], checkpoint.names[i],
+                checkpoint.positions[i], checkpoint.angularVelocities[i], checkpoint.luminosities[i], checkpoint.surfaceTemperatures[i]);
+            break;
+        case CheckpointBodyType::Planet:
+            emplaceCelestialBody<Planet>(checkpoint.masses[i], checkpoint.velocities[i], checkpoint.radii[i], checkpoint.names[i],
+                checkpoint.positions[i], checkpoint.angularVelocities[i]);
+            break;
+        case CheckpointBodyType::Asteroid:
+            emplaceCelestialBody<Asteroid>(checkpoint.masses[i], checkpoint.velocities[i], checkpoint.radii[i], checkpoint.names[i],
+                checkpoint.positions[i], checkpoint.angularVelocities[i]);
+            break;
+        default:
+            throw std::runtime_error("Checkpoint holds an unknown body type for " + checkpoint.names[i] + ".");
+        }
+    }
 
-        Utilities::Vector newPosition = body->getCurrentPosition() + body->getVelocity() * timestep + 0.5 * currentAcceleration * (timestep * timestep);
+    for (std::size_t pair = 0; pair < pairCount; ++pair) {
+        PairInteraction& interaction = pairInteractions[pair].second;
+        interaction.score = checkpoint.pairScores[pair];
+        interaction.coupling = checkpoint.pairCouplings[pair];
+        interaction.inEncounter = checkpoint.pairInEncounter[pair] != 0;
+    }
+    bodyStore.getAccelerations() = checkpoint.accelerations;
 
-        Utilities::Vector newVelocity = body->getVelocity() + currentAcceleration * timestep;
+    // Kinematic runs keep the multistep order they were last configured with, it applies when they switch back
+    multistepCoefficients = AdamsBashforthMoulton(checkpoint.multistepOrder);
+    setIntegrationMethod(checkpoint.integrationMethod, checkpoint.multistepOrder);
+    bodyStore.getAccelerationHistory().restore(static_cast<std::size_t>(checkpoint.historyHead), static_cast<std::size_t>(checkpoint.historyCount), checkpoint.historySlots);
+    multistepTimestep = checkpoint.multistepTimestep;
+    historyIsCurrent = checkpoint.historyIsCurrent;
 
-        body->setPosition(newPosition);
-        body->setVelocity(newVelocity);
+    closeEncounterHandling = checkpoint.closeEncounterHandling;
+    encounterTimescaleRatio = checkpoint.encounterTimescaleRatio;
+    encounterGroupOf.assign(bodyCount, NO_ENCOUNTER_GROUP);
+    std::size_t groupCount = 0;
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        const std::uint64_t group = checkpoint.encounterGroupOf[i];
+        if (group == UINT64_MAX) {
+            continue;
+        }
+        if (group >= bodyCount) {
+            throw std::runtime_error("Checkpoint holds an invalid close encounter group.");
+        }
+        encounterGroupOf[i] = static_cast<std::size_t>(group);
+        groupCount = std::max(groupCount, encounterGroupOf[i] + 1);
+    }
+    encounterGroups.assign(groupCount, EncounterGroup());
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        if (encounterGroupOf[i] != NO_ENCOUNTER_GROUP) {
+            encounterGroups[encounterGroupOf[i]].members.push_back(i);
+        }
     }
 }
 
+void SolarSystemModel::clearCloseEncounters() {
+    // Pairs are only ever flagged while some group exists, skipping the scan keeps one by one insertion linear per body
+    if (!encounterGroups.empty()) {
+        for (auto& entry : pairInteractions) {
+            if (entry.second.inEncounter) {
+                entry.second.inEncounter = false;
+                entry.second.score = 0;
+            }
+        }
+    }
+    encounterGroups.clear();
+    encounterGroupOf.assign(bodyRegistry.size(), NO_ENCOUNTER_GROUP);
+}
+
+bool SolarSystemModel::updateCloseEncounters(double timestep) {
+    const std::size_t bodyCount = bodyRegistry.size();
+    const std::vector<double>& gravitationalParameters = bodyStore.getGravitationalParameters();
+
+    encounterParent.resize(bodyCount);
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        encounterParent[i] = i;
+    }
+    auto findRoot = [this](std::size_t index) {
+        while (encounterParent[index] != index) {
+            encounterParent[index] = encounterParent[encounterParent[index]];
+            index = encounterParent[index];
+        }
+        return index;
+    };
+
+    // Pairs enter an encounter below the threshold and only leave at twice that, so they do not flicker in and out
+    const double enterTime = encounterTimescaleRatio * timestep;
+    const double exitTime = 2.0 * enterTime;
+
+    auto linkIfClose = [&](std::size_t first, std::size_t second, const Utilities::Vector& separation, bool inEncounter) {
+        double distanceSquared = separation.dot(separation);
+        double dynamicalTimeSquared = distanceSquared * std::sqrt(distanceSquared) / (gravitationalParameters[first] + gravitationalParameters[second]);
+        double limit = inEncounter ? exitTime : enterTime;
+
+        if (dynamicalTimeSquared < limit * limit) {
+            std::size_t rootOne = findRoot(first);
+            std::size_t rootTwo = findRoot(second);
+            if (rootOne != rootTwo) {
+                encounterParent[rootOne] = rootTwo;
+            }
+        }
+    };
+
+    if (usesPairTable()) {
+        for (const auto& entry : pairInteractions) {
+            const PairInteraction& interaction = entry.second;
+            linkIfClose(interaction.firstIndex, interaction.secondIndex,
+                entry.first.second->getCurrentPosition() - entry.first.first->getCurrentPosition(), interaction.inEncounter);
+        }
+    }
+    else {
+        // Without a table a pair is in an encounter exactly when both bodies share a group
+        const auto& celestialBodies = bodyRegistry.getBodies();
+        for (std::size_t second = 1; second < bodyCount; ++second) {
+            const Utilities::Vector& secondPosition = celestialBodies[second]->getCurrentPosition();
+            for (std::size_t first = 0; first < second; ++first) {
+                bool inEncounter = encounterGroupOf[first] != NO_ENCOUNTER_GROUP && encounterGroupOf[first] == encounterGroupOf[second];
+                linkIfClose(first, second, secondPosition - celestialBodies[first]->getCurrentPosition(), inEncounter);
+            }
+        }
+    }
+
+    // Every union-find tree with more than one body becomes a group
+    FrameVector<std::size_t> groupOfRoot(bodyCount, NO_ENCOUNTER_GROUP, FrameVector<std::size_t>::allocator_type(frameArena));
+    std::vector<std::size_t>& newGroupOf = nextEncounterGroupOf;
+    newGroupOf.assign(bodyCount, NO_ENCOUNTER_GROUP);
+    std::size_t groupCount = 0;
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        std::size_t root = findRoot(i);
+        if (root != i && groupOfRoot[root] == NO_ENCOUNTER_GROUP) {
+            groupOfRoot[root] = groupCount++;
+        }
+    }
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        newGroupOf[i] = groupOfRoot[findRoot(i)];
+    }
+
+    bool changed = newGroupOf != encounterGroupOf;
+    encounterGroupOf.swap(newGroupOf);
+
+    encounterGroups.resize(groupCount);
+    for (auto& group : encounterGroups) {
+        group.members.clear();
+    }
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        if (encounterGroupOf[i] != NO_ENCOUNTER_GROUP) {
+            encounterGroups[encounterGroupOf[i]].members.push_back(i);
+        }
+    }
+
+    // Every pair inside a group moves to the subsystem, including members that are only linked through a third body
+    for (auto& entry : pairInteractions) {
+        PairInteraction& interaction = entry.second;
+        std::size_t group = encounterGroupOf[interaction.firstIndex];
+        bool inEncounter = group != NO_ENCOUNTER_GROUP && group == encounterGroupOf[interaction.secondIndex];
+
+        if (inEncounter && !interaction.inEncounter) {
+            interaction.coupling = Utilities::Vector(0, 0, 0);
+        }
+        else if (!inEncounter && interaction.inEncounter) {
+            interaction.score = 0;
+        }
+        interaction.inEncounter = inEncounter;
+    }
+
+    return changed;
+}
+
+void SolarSystemModel::calculateExternalAccelerations(std::size_t groupIndex, const Utilities::Vector* memberPositions, std::size_t memberCount, std::vector<Utilities::Vector>& accelerations) const {
+    const std::vector<double>& gravitationalParameters = bodyStore.getGravitationalParameters();
+
+    accelerations.assign(memberCount, Utilities::Vector(0, 0, 0));
+    for (std::size_t m = 0; m < memberCount; ++m) {
+        for (std::size_t other = 0; other < bodyRegistry.size(); ++other) {
+            if (encounterGroupOf[other] == groupIndex) {
+                continue;
+            }
+            accelerations[m] += Utilities::MathUtils::calculateGravitationalCoupling(memberPositions[m], bodyRegistry.getBodies()[other]->getCurrentPosition()) * gravitationalParameters[other];
+        }
+    }
+}
+
+void SolarSystemModel::beginCloseEncounterStep() {
+    const std::vector<double>& gravitationalParameters = bodyStore.getGravitationalParameters();
+
+    for (std::size_t groupIndex = 0; groupIndex < encounterGroups.size(); ++groupIndex) {
+        EncounterGroup& group = encounterGroups[groupIndex];
+        const std::size_t memberCount = group.members.size();
+
+        group.positions.resize(memberCount);
+        group.velocities.resize(memberCount);
+        group.gravitationalParameters.resize(memberCount);
+
+        for (std::size_t m = 0; m < memberCount; ++m) {
+            const std::size_t bodyIndex = group.members[m];
+            group.positions[m] = bodyRegistry.getBodies()[bodyIndex]->getCurrentPosition();
+            group.velocities[m] = bodyRegistry.getBodies()[bodyIndex]->getVelocity();
+            group.gravitationalParameters[m] = gravitationalParameters[bodyIndex];
+        }
+
+        calculateExternalAccelerations(groupIndex, group.positions.data(), memberCount, group.externalAccelerationsAtStart);
+    }
+}
+
+void SolarSystemModel::finishCloseEncounterStep(double timestep) {
+    FrameVector<Utilities::Vector> endPositions{ FrameVector<Utilities::Vector>::allocator_type(frameArena) };
+
+    for (std::size_t groupIndex = 0; groupIndex < encounterGroups.size(); ++groupIndex) {
+        EncounterGroup& group = encounterGroups[groupIndex];
+
+        // The global integrator moved the members under external forces only, which is close enough to their true
+        // end positions to sample the smooth external field there
+        endPositions.resize(group.members.size());
+        for (std::size_t m = 0; m < group.members.size(); ++m) {
+            endPositions[m] = bodyRegistry.getBodies()[group.members[m]]->getCurrentPosition();
+        }
+        calculateExternalAccelerations(groupIndex, endPositions.data(), endPositions.size(), group.externalAccelerationsAtEnd);
+
+        encounterIntegrator.integrate(group.positions, group.velocities, group.gravitationalParameters,
+            group.externalAccelerationsAtStart, group.externalAccelerationsAtEnd, timestep);
+
+        for (std::size_t m = 0; m < group.members.size(); ++m) {
+            CelestialBody& body = *bodyRegistry.getBodies()[group.members[m]];
+            body.setPosition(group.positions[m]);
+            body.setVelocity(group.velocities[m]);
+        }
+    }
+}
+
+void SolarSystemModel::evaluateAccelerations(std::vector<Utilities::Vector>& accelerations) {
+    calculateForceVectorsExact();
+    calculateTotalForces();
+
+    accelerations = bodyStore.getAccelerations();
+}
+
+/// <summary>
+/// 
+/// One step of the k-step Adams-Bashforth-Moulton method in PEC mode. The predictor
+/// extrapolates from the stored accelerations, the forces are evaluated once at the
+/// predicted positions and the corrector reuses that evaluation, which then becomes
+/// the newest history entry. Until k equally spaced entries exist the step is taken
+/// with Runge-Kutta instead.
+/// 
+/// </summary>
+
+void SolarSystemModel::advanceAdamsBashforthMoulton(double timestep) {
+    using Utilities::lazy;
+    AccelerationHistory& history = bodyStore.getAccelerationHistory();
+    const std::size_t bodyCount = bodyRegistry.size();
+    const std::size_t order = multistepCoefficients.getOrder();
+
+    // The history only holds equally spaced steps, a new step size starts it over
+    if (timestep != multistepTimestep) {
+        history.reset();
+        multistepTimestep = timestep;
+        historyIsCurrent = false;
+    }
+
+    if (!historyIsCurrent) {
+        evaluateAccelerations(stageAccelerations);
+        history.push(stageAccelerations);
+        historyIsCurrent = true;
+    }
+
+    if (history.getCount() < order) {
+        advanceRungeKuttaStartup(timestep);
+        historyIsCurrent = false;
+        return;
+    }
+
+    // Only positions are predicted, the forces at the predicted point do not depend on the velocities
+    const auto& predictorPosition = multistepCoefficients.getPredictorPositionWeights();
+    const auto& correctorVelocity = multistepCoefficients.getCorrectorVelocityWeights();
+    const auto& correctorPosition = multistepCoefficients.getCorrectorPositionWeights();
+
+    stepStartPositions.resize(bodyCount);
+    stepStartVelocities.resize(bodyCount);
+
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        CelestialBody& body = *bodyRegistry.getBodies()[i];
+        stepStartPositions[i] = body.getCurrentPosition();
+        stepStartVelocities[i] = body.getVelocity();
+
+        Utilities::Vector positionSum(0, 0, 0);
+        for (std::size_t j = 0; j < order; ++j) {
+            Utilities::assign(positionSum, lazy(positionSum) + lazy(history.get(i, j)) * predictorPosition[j]);
+        }
+
+        body.setPosition(Utilities::evaluate(lazy(stepStartPositions[i]) + lazy(stepStartVelocities[i]) * timestep + lazy(positionSum) * (timestep * timestep)));
+    }
+
+    evaluateAccelerations(stageAccelerations);
+
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        CelestialBody& body = *bodyRegistry.getBodies()[i];
+
+        Utilities::Vector velocitySum = Utilities::evaluate(lazy(stageAccelerations[i]) * correctorVelocity[0]);
+        Utilities::Vector positionSum = Utilities::evaluate(lazy(stageAccelerations[i]) * correctorPosition[0]);
+        for (std::size_t j = 1; j < order; ++j) {
+            const Utilities::Vector& acceleration = history.get(i, j - 1);
+            Utilities::assign(velocitySum, lazy(velocitySum) + lazy(acceleration) * correctorVelocity[j]);
+            Utilities::assign(positionSum, lazy(positionSum) + lazy(acceleration) * correctorPosition[j]);
+        }
+
+        body.setPosition(Utilities::evaluate(lazy(stepStartPositions[i]) + lazy(stepStartVelocities[i]) * timestep + lazy(positionSum) * (timestep * timestep)));
+        body.setVelocity(Utilities::evaluate(lazy(stepStartVelocities[i]) + lazy(velocitySum) * timestep));
+    }
+
+    history.push(stageAccelerations);
+}
+
+void SolarSystemModel::advanceRungeKuttaStartup(double timestep) {
+    using Utilities::lazy;
+    const std::size_t bodyCount = bodyRegistry.size();
+    const double h = timestep / RUNGE_KUTTA_STARTUP_SUBSTEPS;
+    const AccelerationHistory& history = bodyStore.getAccelerationHistory();
+
+    stepStartPositions.resize(bodyCount);
+    stepStartVelocities.resize(bodyCount);
+    stageVelocities.resize(bodyCount);
+    velocityIncrements.resize(bodyCount);
+    positionIncrements.resize(bodyCount);
+
+    for (unsigned int substep = 0; substep < RUNGE_KUTTA_STARTUP_SUBSTEPS; ++substep) {
+        // The acceleration at the start of the step is already the newest history entry
+        if (substep == 0) {
+            stageAccelerations.resize(bodyCount);
+            for (std::size_t i = 0; i < bodyCount; ++i) {
+                stageAccelerations[i] = history.get(i, 0);
+            }
+        }
+        else {
+            evaluateAccelerations(stageAccelerations);
+        }
+
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            stepStartPositions[i] = bodyRegistry.getBodies()[i]->getCurrentPosition();
+            stepStartVelocities[i] = bodyRegistry.getBodies()[i]->getVelocity();
+        }
+        positionIncrements = stepStartVelocities;
+        velocityIncrements = stageAccelerations;
+
+        // Classic fourth order stages, each weighted 1/6, 2/6, 2/6, 1/6
+        const double stageOffsets[3] = { 0.5 * h, 0.5 * h, h };
+        const double stageWeights[3] = { 2.0, 2.0, 1.0 };
+
+        for (int stage = 0; stage < 3; ++stage) {
+            // The stage positions use the previous stage's velocities, so they are placed before those are replaced
+            for (std::size_t i = 0; i < bodyCount; ++i) {
+                const Utilities::Vector& previousVelocity = (stage == 0) ? stepStartVelocities[i] : stageVelocities[i];
+                bodyRegistry.getBodies()[i]->setPosition(Utilities::evaluate(lazy(stepStartPositions[i]) + lazy(previousVelocity) * stageOffsets[stage]));
+            }
+            Utilities::assign(stageVelocities, lazy(stepStartVelocities) + lazy(stageAccelerations) * stageOffsets[stage]);
+
+            evaluateAccelerations(stageAccelerations);
+
+            Utilities::accumulate(positionIncrements, lazy(stageVelocities) * stageWeights[stage]);
+            Utilities::accumulate(velocityIncrements, lazy(stageAccelerations) * stageWeights[stage]);
+        }
+
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            bodyRegistry.getBodies()[i]->setPosition(Utilities::evaluate(lazy(stepStartPositions[i]) + lazy(positionIncrements[i]) * (h / 6.0)));
+            bodyRegistry.getBodies()[i]->setVelocity(Utilities::evaluate(lazy(stepStartVelocities[i]) + lazy(velocityIncrements[i]) * (h / 6.0)));
+        }
+    }
+}
+
+#ifndef SOLAR_SYSTEM_HEADLESS
 void SolarSystemModel::initializeRendering(Utilities::GeometryManager& geomManager) {
     // Compile shaders and create shader program
     shaderProgram = ShaderUtils::createShaderProgram(ShaderUtils::vertexShaderSource, ShaderUtils::fragmentShaderSource);
 
-    // Initialize graphics for each celestial body
-    for (auto& body : celestialBodies) {
+    initializeGraphics(geomManager);
+}
+
+void SolarSystemModel::initializeGraphics(Utilities::GeometryManager& geomManager) {
+    if (!sphereRenderer.isInitialized()) {
+        sphereRenderer.initialize(shaderProgram);
+    }
+    pointSpriteRenderer.initialize();
+
+    // The geometry cache hands bodies with the same tessellation the same mesh
+    for (auto& body : bodyRegistry.getBodies()) {
         body->initializeGraphics(geomManager);
     }
 }
 
 void SolarSystemModel::render(const glm::mat4& view, const glm::mat4& projection) {
-    glUseProgram(shaderProgram);
+    const auto& bodies = bodyRegistry.getBodies();
 
-    // Set view and projection matrices in the shader
-    unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-    unsigned int projLoc = glGetUniformLocation(shaderProgram, "projection");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    // Only bodies whose bounding sphere reaches into the view frustum are queued, and so uploaded and drawn
+    const std::vector<std::uint32_t>* drawnBodies = &allBodyIndices;
+    if (frustumCulling) {
+        cullingCenters.resize(bodies.size());
+        cullingRadii.resize(bodies.size());
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            cullingCenters[i] = Utilities::Vec3(bodies[i]->getCurrentPosition());
+            cullingRadii[i] = bodies[i]->getRadius();
+        }
+        drawnBodies = &frustumCuller.cull(Utilities::Frustum(projection * view), cullingCenters, cullingRadii);
+    }
+    else if (allBodyIndices.size() != bodies.size()) {
+        allBodyIndices.resize(bodies.size());
+        std::iota(allBodyIndices.begin(), allBodyIndices.end(), 0u);
+    }
 
-    // Draw each celestial body
-    for (auto& body : celestialBodies) {
-        body->draw(shaderProgram);
+    // Queue each celestial body against its mesh, then draw every mesh once
+    if (!levelOfDetail) {
+        for (std::uint32_t index : *drawnBodies) {
+            const CelestialBody* body = bodies[index].get();
+            if (body->hasGraphics()) {
+                sphereRenderer.add(body->getGeometry(), body->getModelMatrix(), body->getColor());
+            }
+        }
+        sphereRenderer.draw(view, projection);
+        pointSpriteRenderer.draw(view, projection);     // Nothing queued, only resets the counts
+        return;
     }
-}
 
+    // A sphere of radius r at view depth d covers r / d * projection[1][1] of the half viewport height
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const float pixelsPerUnitAtUnitDepth = projection[1][1] * 0.5f * static_cast<float>(viewport[3]);
 
+    for (std::uint32_t index : *drawnBodies) {
+        const CelestialBody* body = bodies[index].get();
+        if (!body->hasGraphics()) {
+            continue;
+        }
+        const Utilities::Vector& position = body->getCurrentPosition();
+        const glm::vec4 viewPosition = view * glm::vec4(static_cast<float>(position.getX()), static_cast<float>(position.getY()), static_cast<float>(position.getZ()), 1.0f);
+        const float radius = static_cast<float>(body->getRadius());
+        const float depth = std::abs(viewPosition.z);
 
+        // The camera inside or touching the sphere gets the finest mesh
+        const float pixelRadius = depth > radius ? radius / depth * pixelsPerUnitAtUnitDepth : std::numeric_limits<float>::max();
+        if (pixelRadius < Utilities::PointSpriteRenderer::MESH_PIXEL_RADIUS) {
+            // Queued in view space, already at hand, so the sprites are drawn with an identity view
+            pointSpriteRenderer.add(glm::vec3(viewPosition.x, viewPosition.y, viewPosition.z), radius, body->getColor());
+        }
+        else {
+            sphereRenderer.addLevelOfDetail(body->getModelMatrix(), body->getColor(), pixelRadius);
+        }
+    }
+    sphereRenderer.draw(view, projection);
+    pointSpriteRenderer.draw(glm::mat4(1.0f), projection);
+}
+#endif
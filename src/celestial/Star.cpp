@@ -1,4 +1,16 @@
 
 #include<Star.h>
+#include <algorithm>
 
 using namespace SolarSystem;
+
+glm::vec3 Star::getColor() const {
+    // Piecewise linear fit to blackbody colours, close enough to tell a red dwarf from the Sun or a B star
+    const float t = static_cast<float>(std::clamp(temperature, 2000.0, 15000.0));
+    if (t <= 6500.0f) {
+        const float f = (t - 2000.0f) / 4500.0f;
+        return glm::vec3(1.0f, 0.6f + 0.4f * f, 0.3f + 0.7f * f);
+    }
+    const float f = (t - 6500.0f) / 8500.0f;
+    return glm::vec3(1.0f - 0.4f * f, 1.0f - 0.2f * f, 1.0f);
+}
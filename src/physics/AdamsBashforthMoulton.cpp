@@ -0,0 +1,60 @@
+
+#include <physics/AdamsBashforthMoulton.h>
+#include <stdexcept>
+#include <string>
+
+using namespace SolarSystem;
+
+AdamsBashforthMoulton::AdamsBashforthMoulton(unsigned int order) : order(order) {
+    if (order < MIN_ORDER || order > MAX_ORDER) {
+        throw std::runtime_error("Adams-Bashforth-Moulton order must be between " + std::to_string(MIN_ORDER) + " and " + std::to_string(MAX_ORDER) + ".");
+    }
+
+    // Nodes are measured in steps relative to the current time
+    std::vector<long double> predictorNodes(order);
+    std::vector<long double> correctorNodes(order);
+    for (unsigned int j = 0; j < order; ++j) {
+        predictorNodes[j] = -static_cast<long double>(j);
+        correctorNodes[j] = 1.0L - static_cast<long double>(j);
+    }
+
+    computeWeights(predictorNodes, predictorVelocityWeights, predictorPositionWeights);
+    computeWeights(correctorNodes, correctorVelocityWeights, correctorPositionWeights);
+}
+
+void AdamsBashforthMoulton::computeWeights(const std::vector<long double>& nodes, std::vector<double>& velocityWeights, std::vector<double>& positionWeights) {
+    const std::size_t count = nodes.size();
+    velocityWeights.assign(count, 0.0);
+    positionWeights.assign(count, 0.0);
+
+    for (std::size_t j = 0; j < count; ++j) {
+        // Expand L_j(s) = prod (s - node_m) / (node_j - node_m) into monomial coefficients
+        std::vector<long double> polynomial(1, 1.0L);
+        long double denominator = 1.0L;
+
+        for (std::size_t m = 0; m < count; ++m) {
+            if (m == j) {
+                continue;
+            }
+
+            std::vector<long double> next(polynomial.size() + 1, 0.0L);
+            for (std::size_t p = 0; p < polynomial.size(); ++p) {
+                next[p + 1] += polynomial[p];
+                next[p] -= polynomial[p] * nodes[m];
+            }
+            polynomial.swap(next);
+            denominator *= nodes[j] - nodes[m];
+        }
+
+        // int_0^1 s^p ds = 1 / (p + 1) and int_0^1 (1 - s) s^p ds = 1 / ((p + 1)(p + 2))
+        long double velocityIntegral = 0.0L;
+        long double positionIntegral = 0.0L;
+        for (std::size_t p = 0; p < polynomial.size(); ++p) {
+            velocityIntegral += polynomial[p] / static_cast<long double>(p + 1);
+            positionIntegral += polynomial[p] / static_cast<long double>((p + 1) * (p + 2));
+        }
+
+        velocityWeights[j] = static_cast<double>(velocityIntegral / denominator);
+        positionWeights[j] = static_cast<double>(positionIntegral / denominator);
+    }
+}
@@ -0,0 +1,177 @@
+
+#include <physics/CloseEncounterIntegrator.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace SolarSystem;
+
+void CloseEncounterIntegrator::integrate(std::vector<Utilities::Vector>& positions, std::vector<Utilities::Vector>& velocities,
+    const std::vector<double>& gravitationalParameters, const std::vector<Utilities::Vector>& externalAccelerationsAtStart,
+    const std::vector<Utilities::Vector>& externalAccelerationsAtEnd, double duration) {
+
+    const std::size_t memberCount = positions.size();
+    this->gravitationalParameters = &gravitationalParameters;
+    this->externalAtStart = &externalAccelerationsAtStart;
+    this->externalAtEnd = &externalAccelerationsAtEnd;
+    this->totalDuration = duration;
+    this->lastSubstepCount = 0;
+
+    state.resize(6 * memberCount);
+    result.resize(6 * memberCount);
+    for (std::size_t i = 0; i < memberCount; ++i) {
+        state[6 * i + 0] = positions[i].getX();
+        state[6 * i + 1] = positions[i].getY();
+        state[6 * i + 2] = positions[i].getZ();
+        state[6 * i + 3] = velocities[i].getX();
+        state[6 * i + 4] = velocities[i].getY();
+        state[6 * i + 5] = velocities[i].getZ();
+    }
+
+    double remaining = duration;
+    double step = duration;
+    int halvings = 0;
+
+    while (remaining > std::abs(duration) * 1e-14) {
+        // Never overshoot, and absorb a sliver that would otherwise need one more tiny step
+        if (step >= remaining * (1.0 - 1e-12)) {
+            step = remaining;
+        }
+
+        int columns = tryStep(duration - remaining, state, step, result);
+        if (columns == 0) {
+            step *= 0.5;
+            if (++halvings > MAX_STEP_HALVINGS) {
+                throw std::runtime_error("Close encounter integration failed to converge.");
+            }
+            continue;
+        }
+
+        state.swap(result);
+        remaining -= step;
+        ++this->lastSubstepCount;
+
+        // Quick convergence means the substep can grow, slow convergence means it is close to failing
+        if (columns <= 4) {
+            step *= 2.0;
+        }
+        else if (columns >= MAX_COLUMNS - 1) {
+            step *= 0.7;
+        }
+    }
+
+    for (std::size_t i = 0; i < memberCount; ++i) {
+        positions[i] = Utilities::Vector(state[6 * i + 0], state[6 * i + 1], state[6 * i + 2]);
+        velocities[i] = Utilities::Vector(state[6 * i + 3], state[6 * i + 4], state[6 * i + 5]);
+    }
+}
+
+void CloseEncounterIntegrator::evaluateDerivative(double time, const std::vector<double>& state, std::vector<double>& out) const {
+    const std::size_t memberCount = state.size() / 6;
+    const std::vector<double>& mu = *this->gravitationalParameters;
+    const std::vector<Utilities::Vector>& atStart = *this->externalAtStart;
+    const std::vector<Utilities::Vector>& atEnd = *this->externalAtEnd;
+    const double fraction = (totalDuration != 0) ? time / totalDuration : 0.0;
+
+    out.resize(state.size());
+    for (std::size_t i = 0; i < memberCount; ++i) {
+        Utilities::Vector external = atStart[i] + (atEnd[i] - atStart[i]) * fraction;
+        out[6 * i + 0] = state[6 * i + 3];
+        out[6 * i + 1] = state[6 * i + 4];
+        out[6 * i + 2] = state[6 * i + 5];
+        out[6 * i + 3] = external.getX();
+        out[6 * i + 4] = external.getY();
+        out[6 * i + 5] = external.getZ();
+    }
+
+    for (std::size_t i = 0; i < memberCount; ++i) {
+        for (std::size_t j = i + 1; j < memberCount; ++j) {
+            const double dx = state[6 * j + 0] - state[6 * i + 0];
+            const double dy = state[6 * j + 1] - state[6 * i + 1];
+            const double dz = state[6 * j + 2] - state[6 * i + 2];
+            const double distanceSquared = dx * dx + dy * dy + dz * dz;
+            if (distanceSquared == 0) {
+                throw std::runtime_error("Attempt to calculate gravitational force between overlapping celestial bodies.");
+            }
+            const double inverseDistanceCubed = 1.0 / (distanceSquared * std::sqrt(distanceSquared));
+
+            out[6 * i + 3] += mu[j] * dx * inverseDistanceCubed;
+            out[6 * i + 4] += mu[j] * dy * inverseDistanceCubed;
+            out[6 * i + 5] += mu[j] * dz * inverseDistanceCubed;
+            out[6 * j + 3] -= mu[i] * dx * inverseDistanceCubed;
+            out[6 * j + 4] -= mu[i] * dy * inverseDistanceCubed;
+            out[6 * j + 5] -= mu[i] * dz * inverseDistanceCubed;
+        }
+    }
+}
+
+void CloseEncounterIntegrator::modifiedMidpoint(double time, const std::vector<double>& start, const std::vector<double>& startDerivative, double step, int substeps, std::vector<double>& out) {
+    const std::size_t size = start.size();
+    const double h = step / substeps;
+
+    midpointPrevious = start;
+    midpointCurrent.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        midpointCurrent[i] = start[i] + h * startDerivative[i];
+    }
+
+    midpointNext.resize(size);
+    for (int k = 1; k < substeps; ++k) {
+        evaluateDerivative(time + k * h, midpointCurrent, derivative);
+        for (std::size_t i = 0; i < size; ++i) {
+            midpointNext[i] = midpointPrevious[i] + 2.0 * h * derivative[i];
+        }
+        midpointPrevious.swap(midpointCurrent);
+        midpointCurrent.swap(midpointNext);
+    }
+
+    evaluateDerivative(time + step, midpointCurrent, derivative);
+    out.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        out[i] = 0.5 * (midpointCurrent[i] + midpointPrevious[i] + h * derivative[i]);
+    }
+}
+
+int CloseEncounterIntegrator::tryStep(double time, const std::vector<double>& start, double step, std::vector<double>& out) {
+    const std::size_t size = start.size();
+
+    evaluateDerivative(time, start, startDerivative);
+
+    scale.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        scale[i] = std::abs(start[i]) + std::abs(step * startDerivative[i]) + 1e-300;
+    }
+
+    // Neville extrapolation to zero substep size in h^2. tableau[j] holds column j of the previous row until it is
+    // consumed, after which it holds column j of the current row.
+    current.resize(size);
+    next.resize(size);
+    for (int k = 0; k < MAX_COLUMNS; ++k) {
+        const int substeps = 2 * (k + 1);
+        modifiedMidpoint(time, start, startDerivative, step, substeps, current);
+
+        for (int j = 1; j <= k; ++j) {
+            const double ratio = static_cast<double>(substeps) / (2 * (k - j + 1));
+            const double factor = 1.0 / (ratio * ratio - 1.0);
+            for (std::size_t i = 0; i < size; ++i) {
+                next[i] = current[i] + (current[i] - tableau[j - 1][i]) * factor;
+            }
+            tableau[j - 1].swap(current);
+            current.swap(next);
+        }
+        tableau[k] = current;
+
+        if (k > 0) {
+            double error = 0.0;
+            for (std::size_t i = 0; i < size; ++i) {
+                error = std::max(error, std::abs(tableau[k][i] - tableau[k - 1][i]) / scale[i]);
+            }
+            if (error < tolerance) {
+                out = tableau[k];
+                return k + 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,518 @@
+
+#include <physics/DistributedSimulation.h>
+
+#ifdef SOLAR_SYSTEM_WITH_MPI
+
+#include <celestial/SolarSystemModel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace SolarSystem;
+
+namespace {
+
+    constexpr std::size_t LEAF_SIZE = 8;
+    constexpr int MAX_TREE_DEPTH = 48;
+    constexpr int MORTON_BITS = 21;                 // Per axis, 63 bits of key in total
+    constexpr int HISTOGRAM_BITS = 16;              // Leading key bits used to cut the curve between ranks
+
+    // A body travelling between ranks keeps its acceleration so the next half kick needs no force pass
+    struct MigratingBody {
+        DistributedBody body;
+        double acceleration[3];
+        double cost;
+    };
+
+    std::uint64_t spreadBits(std::uint64_t value) {
+        value &= 0x1fffff;
+        value = (value | value << 32) & 0x1f00000000ffffULL;
+        value = (value | value << 16) & 0x1f0000ff0000ffULL;
+        value = (value | value << 8) & 0x100f00f00f00f00fULL;
+        value = (value | value << 4) & 0x10c30c30c30c30c3ULL;
+        value = (value | value << 2) & 0x1249249249249249ULL;
+        return value;
+    }
+
+    std::uint64_t mortonKey(const double position[3], const double minimum[3], const double scale[3]) {
+        const double cells = static_cast<double>((1u << MORTON_BITS) - 1);
+        std::uint64_t key = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            double cell = std::min(cells, std::max(0.0, (position[axis] - minimum[axis]) * scale[axis]));
+            key |= spreadBits(static_cast<std::uint64_t>(cell)) << (2 - axis);
+        }
+        return key;
+    }
+
+    // Exchanges variable length byte payloads, counts are in elements of T
+    template <typename T>
+    std::vector<T> exchangeBytes(MPI_Comm communicator, const std::vector<std::vector<T>>& outgoing) {
+        const int rankCount = static_cast<int>(outgoing.size());
+        std::vector<int> sendCounts(rankCount), receiveCounts(rankCount), sendOffsets(rankCount), receiveOffsets(rankCount);
+        std::vector<char> sendBuffer;
+
+        int offset = 0;
+        for (int r = 0; r < rankCount; ++r) {
+            sendCounts[r] = static_cast<int>(outgoing[r].size() * sizeof(T));
+            sendOffsets[r] = offset;
+            offset += sendCounts[r];
+        }
+        sendBuffer.resize(offset);
+        for (int r = 0; r < rankCount; ++r) {
+            if (!outgoing[r].empty()) {
+                std::copy_n(reinterpret_cast<const char*>(outgoing[r].data()), sendCounts[r], sendBuffer.data() + sendOffsets[r]);
+            }
+        }
+
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, communicator);
+
+        offset = 0;
+        for (int r = 0; r < rankCount; ++r) {
+            receiveOffsets[r] = offset;
+            offset += receiveCounts[r];
+        }
+
+        std::vector<T> received(offset / sizeof(T));
+        MPI_Alltoallv(sendBuffer.data(), sendCounts.data(), sendOffsets.data(), MPI_BYTE,
+            received.data(), receiveCounts.data(), receiveOffsets.data(), MPI_BYTE, communicator);
+        return received;
+    }
+}
+
+DistributedSimulation::DistributedSimulation(MPI_Comm communicator, DistributedSettings settings)
+    : communicator(communicator), settings(settings) {
+    if (settings.openingAngle < 0) {
+        throw std::runtime_error("Barnes-Hut opening angle must not be negative.");
+    }
+    MPI_Comm_rank(communicator, &this->rank);
+    MPI_Comm_size(communicator, &this->rankCount);
+}
+
+void DistributedSimulation::distributeBodies(const std::vector<DistributedBody>& bodies) {
+    localBodies = bodies;
+    localAccelerations.assign(3 * localBodies.size(), 0.0);
+    localCosts.assign(localBodies.size(), 1.0);
+    accelerationsValid = false;
+    rebalance();
+}
+
+DistributedSimulation::Bounds DistributedSimulation::computeGlobalBounds() const {
+    Bounds local;
+    for (int axis = 0; axis < 3; ++axis) {
+        local.minimum[axis] = std::numeric_limits<double>::max();
+        local.maximum[axis] = -std::numeric_limits<double>::max();
+    }
+    for (const DistributedBody& body : localBodies) {
+        for (int axis = 0; axis < 3; ++axis) {
+            local.minimum[axis] = std::min(local.minimum[axis], body.position[axis]);
+            local.maximum[axis] = std::max(local.maximum[axis], body.position[axis]);
+        }
+    }
+
+    Bounds global;
+    MPI_Allreduce(local.minimum, global.minimum, 3, MPI_DOUBLE, MPI_MIN, communicator);
+    MPI_Allreduce(local.maximum, global.maximum, 3, MPI_DOUBLE, MPI_MAX, communicator);
+    return global;
+}
+
+void DistributedSimulation::rebalance() {
+    const Bounds global = computeGlobalBounds();
+    const std::size_t binCount = std::size_t(1) << HISTOGRAM_BITS;
+    const int keyShift = 3 * MORTON_BITS - HISTOGRAM_BITS;
+
+    double scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        double extent = global.maximum[axis] - global.minimum[axis];
+        scale[axis] = extent > 0 ? ((1u << MORTON_BITS) - 1) / extent : 0.0;
+    }
+
+    // Global cost histogram along the curve
+    std::vector<std::size_t> bins(localBodies.size());
+    std::vector<double> localHistogram(binCount, 0.0);
+    for (std::size_t i = 0; i < localBodies.size(); ++i) {
+        bins[i] = static_cast<std::size_t>(mortonKey(localBodies[i].position, global.minimum, scale) >> keyShift);
+        localHistogram[bins[i]] += localCosts[i];
+    }
+    std::vector<double> histogram(binCount);
+    MPI_Allreduce(localHistogram.data(), histogram.data(), static_cast<int>(binCount), MPI_DOUBLE, MPI_SUM, communicator);
+
+    double totalCost = 0.0;
+    for (double cost : histogram) {
+        totalCost += cost;
+    }
+
+    // A bin goes to the rank whose share of the total cost contains the bin's midpoint
+    std::vector<int> binOwner(binCount);
+    double cumulative = 0.0;
+    for (std::size_t b = 0; b < binCount; ++b) {
+        double midpoint = cumulative + 0.5 * histogram[b];
+        int owner = totalCost > 0 ? static_cast<int>(midpoint / totalCost * rankCount) : 0;
+        binOwner[b] = std::min(owner, rankCount - 1);
+        cumulative += histogram[b];
+    }
+
+    std::vector<std::vector<MigratingBody>> outgoing(rankCount);
+    for (std::size_t i = 0; i < localBodies.size(); ++i) {
+        MigratingBody migrating;
+        migrating.body = localBodies[i];
+        std::copy_n(&localAccelerations[3 * i], 3, migrating.acceleration);
+        migrating.cost = localCosts[i];
+        outgoing[binOwner[bins[i]]].push_back(migrating);
+    }
+
+    std::vector<MigratingBody> received = exchangeBytes(communicator, outgoing);
+
+    localBodies.resize(received.size());
+    localAccelerations.resize(3 * received.size());
+    localCosts.resize(received.size());
+    for (std::size_t i = 0; i < received.size(); ++i) {
+        localBodies[i] = received[i].body;
+        std::copy_n(received[i].acceleration, 3, &localAccelerations[3 * i]);
+        localCosts[i] = received[i].cost;
+    }
+
+    stepsSinceRebalance = 0;
+    ++rebalanceCount;
+}
+
+bool DistributedSimulation::isImbalanced() const {
+    double localCost = 0.0;
+    for (double cost : localCosts) {
+        localCost += cost;
+    }
+
+    double largestCost = 0.0, totalCost = 0.0;
+    MPI_Allreduce(&localCost, &largestCost, 1, MPI_DOUBLE, MPI_MAX, communicator);
+    MPI_Allreduce(&localCost, &totalCost, 1, MPI_DOUBLE, MPI_SUM, communicator);
+    return largestCost > (1.0 + settings.imbalanceTolerance) * totalCost / rankCount;
+}
+
+void DistributedSimulation::buildTree() {
+    tree.clear();
+    treeOrder.resize(localBodies.size());
+    for (std::size_t i = 0; i < treeOrder.size(); ++i) {
+        treeOrder[i] = i;
+    }
+    if (localBodies.empty()) {
+        return;
+    }
+
+    double minimum[3], maximum[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        minimum[axis] = maximum[axis] = localBodies[0].position[axis];
+    }
+    for (const DistributedBody& body : localBodies) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minimum[axis] = std::min(minimum[axis], body.position[axis]);
+            maximum[axis] = std::max(maximum[axis], body.position[axis]);
+        }
+    }
+
+    double center[3], size = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+        center[axis] = 0.5 * (minimum[axis] + maximum[axis]);
+        size = std::max(size, maximum[axis] - minimum[axis]);
+    }
+    // Slightly enlarged so bodies on the boundary fall strictly inside
+    size = size * (1.0 + 1e-9) + std::numeric_limits<double>::min();
+
+    buildNode(0, localBodies.size(), center, size, 0);
+}
+
+int DistributedSimulation::buildNode(std::size_t first, std::size_t count, const double center[3], double size, int depth) {
+    const int nodeIndex = static_cast<int>(tree.size());
+    tree.emplace_back();
+
+    TreeNode node;
+    node.size = size;
+    node.firstBody = first;
+    node.bodyCount = count;
+    node.gravitationalParameter = 0.0;
+    std::fill(std::begin(node.children), std::end(node.children), -1);
+    for (int axis = 0; axis < 3; ++axis) {
+        node.center[axis] = center[axis];
+        node.centerOfMass[axis] = 0.0;
+    }
+
+    for (std::size_t k = first; k < first + count; ++k) {
+        const DistributedBody& body = localBodies[treeOrder[k]];
+        node.gravitationalParameter += body.gravitationalParameter;
+        for (int axis = 0; axis < 3; ++axis) {
+            node.centerOfMass[axis] += body.gravitationalParameter * body.position[axis];
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        node.centerOfMass[axis] = node.gravitationalParameter > 0 ? node.centerOfMass[axis] / node.gravitationalParameter : center[axis];
+    }
+
+    node.leaf = count <= LEAF_SIZE || depth >= MAX_TREE_DEPTH;
+    if (node.leaf) {
+        tree[nodeIndex] = node;
+        return nodeIndex;
+    }
+
+    // Counting sort of the range by octant
+    auto octantOf = [&](std::size_t bodyIndex) {
+        const double* position = localBodies[bodyIndex].position;
+        return (position[0] >= center[0] ? 1 : 0) | (position[1] >= center[1] ? 2 : 0) | (position[2] >= center[2] ? 4 : 0);
+    };
+
+    std::size_t octantCounts[8] = {};
+    for (std::size_t k = first; k < first + count; ++k) {
+        ++octantCounts[octantOf(treeOrder[k])];
+    }
+    std::size_t octantStarts[8];
+    std::size_t running = first;
+    for (int octant = 0; octant < 8; ++octant) {
+        octantStarts[octant] = running;
+        running += octantCounts[octant];
+    }
+
+    partitionScratch.resize(count);
+    std::size_t cursors[8];
+    std::copy(std::begin(octantStarts), std::end(octantStarts), cursors);
+    for (std::size_t k = first; k < first + count; ++k) {
+        partitionScratch[cursors[octantOf(treeOrder[k])]++ - first] = treeOrder[k];
+    }
+    std::copy_n(partitionScratch.begin(), count, treeOrder.begin() + first);
+
+    tree[nodeIndex] = node;
+    for (int octant = 0; octant < 8; ++octant) {
+        if (octantCounts[octant] == 0) {
+            continue;
+        }
+        double childCenter[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            childCenter[axis] = center[axis] + ((octant >> axis) & 1 ? 0.25 : -0.25) * size;
+        }
+        int child = buildNode(octantStarts[octant], octantCounts[octant], childCenter, 0.5 * size, depth + 1);
+        tree[nodeIndex].children[octant] = child;
+    }
+    return nodeIndex;
+}
+
+void DistributedSimulation::collectEssentialMasses(int nodeIndex, const Bounds& remote, std::vector<PointMass>& out) const {
+    const TreeNode& node = tree[nodeIndex];
+
+    // Closest distance from the cell's center of mass to anything the remote rank owns
+    double distanceSquared = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+        double gap = std::max(0.0, std::max(remote.minimum[axis] - node.centerOfMass[axis], node.centerOfMass[axis] - remote.maximum[axis]));
+        distanceSquared += gap * gap;
+    }
+
+    if (distanceSquared > 0 && node.size * node.size < settings.openingAngle * settings.openingAngle * distanceSquared) {
+        out.push_back({ { node.centerOfMass[0], node.centerOfMass[1], node.centerOfMass[2] }, node.gravitationalParameter });
+        return;
+    }
+
+    if (node.leaf) {
+        for (std::size_t k = node.firstBody; k < node.firstBody + node.bodyCount; ++k) {
+            const DistributedBody& body = localBodies[treeOrder[k]];
+            out.push_back({ { body.position[0], body.position[1], body.position[2] }, body.gravitationalParameter });
+        }
+        return;
+    }
+
+    for (int child : node.children) {
+        if (child >= 0) {
+            collectEssentialMasses(child, remote, out);
+        }
+    }
+}
+
+void DistributedSimulation::exchangeEssentialTrees() {
+    Bounds local;
+    for (int axis = 0; axis < 3; ++axis) {
+        local.minimum[axis] = std::numeric_limits<double>::max();
+        local.maximum[axis] = -std::numeric_limits<double>::max();
+    }
+    for (const DistributedBody& body : localBodies) {
+        for (int axis = 0; axis < 3; ++axis) {
+            local.minimum[axis] = std::min(local.minimum[axis], body.position[axis]);
+            local.maximum[axis] = std::max(local.maximum[axis], body.position[axis]);
+        }
+    }
+
+    rankBounds.resize(rankCount);
+    MPI_Allgather(&local, sizeof(Bounds), MPI_BYTE, rankBounds.data(), sizeof(Bounds), MPI_BYTE, communicator);
+
+    std::vector<std::vector<PointMass>> outgoing(rankCount);
+    for (int r = 0; r < rankCount; ++r) {
+        // Ranks without bodies report inverted bounds and need nothing
+        if (r == rank || tree.empty() || rankBounds[r].minimum[0] > rankBounds[r].maximum[0]) {
+            continue;
+        }
+        collectEssentialMasses(0, rankBounds[r], outgoing[r]);
+    }
+
+    remoteMasses = exchangeBytes(communicator, outgoing);
+}
+
+void DistributedSimulation::accumulateFromTree(int nodeIndex, std::size_t bodyIndex, double acceleration[3], double& cost) const {
+    const TreeNode& node = tree[nodeIndex];
+    const double* position = localBodies[bodyIndex].position;
+
+    if (node.leaf) {
+        for (std::size_t k = node.firstBody; k < node.firstBody + node.bodyCount; ++k) {
+            const std::size_t other = treeOrder[k];
+            if (other == bodyIndex) {
+                continue;
+            }
+            const DistributedBody& body = localBodies[other];
+            const double dx = body.position[0] - position[0];
+            const double dy = body.position[1] - position[1];
+            const double dz = body.position[2] - position[2];
+            const double distanceSquared = dx * dx + dy * dy + dz * dz;
+            if (distanceSquared == 0) {
+                throw std::runtime_error("Attempt to calculate gravitational force between overlapping celestial bodies.");
+            }
+            const double factor = body.gravitationalParameter / (distanceSquared * std::sqrt(distanceSquared));
+            acceleration[0] += factor * dx;
+            acceleration[1] += factor * dy;
+            acceleration[2] += factor * dz;
+        }
+        cost += static_cast<double>(node.bodyCount);
+        return;
+    }
+
+    // A cell containing the body itself is always opened so its own mass never enters the monopole
+    bool containsBody = true;
+    double distanceSquared = 0.0;
+    double offset[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        containsBody = containsBody && std::abs(position[axis] - node.center[axis]) <= 0.5 * node.size;
+        offset[axis] = node.centerOfMass[axis] - position[axis];
+        distanceSquared += offset[axis] * offset[axis];
+    }
+
+    if (!containsBody && node.size * node.size < settings.openingAngle * settings.openingAngle * distanceSquared) {
+        const double factor = node.gravitationalParameter / (distanceSquared * std::sqrt(distanceSquared));
+        acceleration[0] += factor * offset[0];
+        acceleration[1] += factor * offset[1];
+        acceleration[2] += factor * offset[2];
+        cost += 1.0;
+        return;
+    }
+
+    for (int child : node.children) {
+        if (child >= 0) {
+            accumulateFromTree(child, bodyIndex, acceleration, cost);
+        }
+    }
+}
+
+void DistributedSimulation::computeAccelerations() {
+    buildTree();
+    exchangeEssentialTrees();
+
+    localAccelerations.assign(3 * localBodies.size(), 0.0);
+    localCosts.assign(localBodies.size(), 0.0);
+
+    for (std::size_t i = 0; i < localBodies.size(); ++i) {
+        double* acceleration = &localAccelerations[3 * i];
+        double cost = 0.0;
+        accumulateFromTree(0, i, acceleration, cost);
+
+        const double* position = localBodies[i].position;
+        for (const PointMass& mass : remoteMasses) {
+            const double dx = mass.position[0] - position[0];
+            const double dy = mass.position[1] - position[1];
+            const double dz = mass.position[2] - position[2];
+            const double distanceSquared = dx * dx + dy * dy + dz * dz;
+            // Far cells never contain the body, so only a remote body sitting exactly on it can get here
+            if (distanceSquared == 0) {
+                throw std::runtime_error("Attempt to calculate gravitational force between overlapping celestial bodies.");
+            }
+            const double factor = mass.gravitationalParameter / (distanceSquared * std::sqrt(distanceSquared));
+            acceleration[0] += factor * dx;
+            acceleration[1] += factor * dy;
+            acceleration[2] += factor * dz;
+        }
+        localCosts[i] = cost + static_cast<double>(remoteMasses.size());
+    }
+
+    accelerationsValid = true;
+}
+
+void DistributedSimulation::step(double timestep) {
+    if (!accelerationsValid) {
+        computeAccelerations();
+    }
+
+    // Kick-drift-kick leapfrog
+    for (std::size_t i = 0; i < localBodies.size(); ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            localBodies[i].velocity[axis] += 0.5 * timestep * localAccelerations[3 * i + axis];
+            localBodies[i].position[axis] += timestep * localBodies[i].velocity[axis];
+        }
+    }
+
+    computeAccelerations();
+
+    for (std::size_t i = 0; i < localBodies.size(); ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            localBodies[i].velocity[axis] += 0.5 * timestep * localAccelerations[3 * i + axis];
+        }
+    }
+
+    ++stepsSinceRebalance;
+    if ((settings.rebalanceInterval != 0 && stepsSinceRebalance >= settings.rebalanceInterval) || isImbalanced()) {
+        rebalance();
+    }
+}
+
+std::vector<DistributedBody> DistributedSimulation::gatherBodies(int root) const {
+    int localBytes = static_cast<int>(localBodies.size() * sizeof(DistributedBody));
+    std::vector<int> counts(rank == root ? rankCount : 0);
+    MPI_Gather(&localBytes, 1, MPI_INT, counts.data(), 1, MPI_INT, root, communicator);
+
+    std::vector<int> offsets(counts.size());
+    int totalBytes = 0;
+    for (std::size_t r = 0; r < counts.size(); ++r) {
+        offsets[r] = totalBytes;
+        totalBytes += counts[r];
+    }
+
+    std::vector<DistributedBody> bodies(totalBytes / sizeof(DistributedBody));
+    MPI_Gatherv(localBodies.data(), localBytes, MPI_BYTE, bodies.data(), counts.data(), offsets.data(), MPI_BYTE, root, communicator);
+
+    std::sort(bodies.begin(), bodies.end(), [](const DistributedBody& a, const DistributedBody& b) {
+        return a.id < b.id;
+    });
+    return bodies;
+}
+
+std::vector<DistributedBody> DistributedSimulation::collectBodies(const SolarSystemModel& model) {
+    const auto& celestialBodies = model.getCelestialBodies();
+    std::vector<DistributedBody> bodies(celestialBodies.size());
+
+    for (std::size_t i = 0; i < celestialBodies.size(); ++i) {
+        Utilities::Vector position = celestialBodies[i]->getCurrentPosition();
+        Utilities::Vector velocity = celestialBodies[i]->getVelocity();
+        bodies[i].id = i;
+        bodies[i].gravitationalParameter = model.getBodyStore().getGravitationalParameter(i);
+        bodies[i].position[0] = position.getX();
+        bodies[i].position[1] = position.getY();
+        bodies[i].position[2] = position.getZ();
+        bodies[i].velocity[0] = velocity.getX();
+        bodies[i].velocity[1] = velocity.getY();
+        bodies[i].velocity[2] = velocity.getZ();
+    }
+    return bodies;
+}
+
+void DistributedSimulation::applyBodies(const std::vector<DistributedBody>& bodies, SolarSystemModel& model) {
+    const auto& celestialBodies = model.getCelestialBodies();
+
+    for (const DistributedBody& body : bodies) {
+        if (body.id >= celestialBodies.size()) {
+            throw std::runtime_error("Distributed body does not exist in the solar system model.");
+        }
+        celestialBodies[body.id]->setPosition(Utilities::Vector(body.position[0], body.position[1], body.position[2]));
+        celestialBodies[body.id]->setVelocity(Utilities::Vector(body.velocity[0], body.velocity[1], body.velocity[2]));
+    }
+}
+
+#endif
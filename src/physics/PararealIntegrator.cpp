@@ -0,0 +1,209 @@
+
+#include <physics/PararealIntegrator.h>
+#include <utils/MathUtils.h>
+#include <utils/VectorExpression.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace SolarSystem;
+using Utilities::lazy;
+
+PararealIntegrator::PararealIntegrator(std::vector<double> gravitationalParameters, PararealSettings settings)
+    : gravitationalParameters(std::move(gravitationalParameters)), settings(settings) {
+    if (this->settings.coarseSubsteps == 0 || this->settings.fineSubsteps == 0) {
+        throw std::runtime_error("Parareal propagators need at least one substep per slice.");
+    }
+}
+
+void PararealIntegrator::propagateCoarse(NBodyState& state, double duration) const {
+    const double h = duration / settings.coarseSubsteps;
+    std::vector<Utilities::Vector> accelerations;
+
+    // Kick-drift-kick leapfrog, one force evaluation per substep
+    Utilities::MathUtils::calculateAccelerations(state.positions, gravitationalParameters, accelerations);
+    for (unsigned int step = 0; step < settings.coarseSubsteps; ++step) {
+        accumulate(state.velocities, lazy(accelerations) * (0.5 * h));
+        accumulate(state.positions, lazy(state.velocities) * h);
+        Utilities::MathUtils::calculateAccelerations(state.positions, gravitationalParameters, accelerations);
+        accumulate(state.velocities, lazy(accelerations) * (0.5 * h));
+    }
+}
+
+void PararealIntegrator::propagateFine(NBodyState& state, double duration) const {
+    const double h = duration / settings.fineSubsteps;
+
+    std::vector<Utilities::Vector> stagePositions;
+    std::vector<Utilities::Vector> stageVelocities;
+    std::vector<Utilities::Vector> accelerations;
+    std::vector<Utilities::Vector> positionIncrements;
+    std::vector<Utilities::Vector> velocityIncrements;
+
+    const double stageOffsets[3] = { 0.5 * h, 0.5 * h, h };
+    const double stageWeights[3] = { 2.0, 2.0, 1.0 };
+
+    for (unsigned int step = 0; step < settings.fineSubsteps; ++step) {
+        Utilities::MathUtils::calculateAccelerations(state.positions, gravitationalParameters, accelerations);
+        positionIncrements = state.velocities;
+        velocityIncrements = accelerations;
+        stageVelocities = state.velocities;
+
+        for (int stage = 0; stage < 3; ++stage) {
+            // The stage position uses the previous stage's velocity, so it is formed before the velocity is replaced
+            assign(stagePositions, lazy(state.positions) + lazy(stageVelocities) * stageOffsets[stage]);
+            assign(stageVelocities, lazy(state.velocities) + lazy(accelerations) * stageOffsets[stage]);
+
+            Utilities::MathUtils::calculateAccelerations(stagePositions, gravitationalParameters, accelerations);
+
+            accumulate(positionIncrements, lazy(stageVelocities) * stageWeights[stage]);
+            accumulate(velocityIncrements, lazy(accelerations) * stageWeights[stage]);
+        }
+
+        accumulate(state.positions, lazy(positionIncrements) * (h / 6.0));
+        accumulate(state.velocities, lazy(velocityIncrements) * (h / 6.0));
+    }
+}
+
+double PararealIntegrator::relativeDifference(const NBodyState& a, const NBodyState& b) {
+    // Measured against the scale of the whole state rather than each body's own, so a body resting near the origin,
+    // usually the central star, does not turn a negligible absolute change into a huge relative one
+    double positionScale = 0.0, velocityScale = 0.0;
+    double positionDifference = 0.0, velocityDifference = 0.0;
+    for (std::size_t i = 0; i < a.positions.size(); ++i) {
+        positionScale = std::max(positionScale, b.positions[i].magnitude());
+        velocityScale = std::max(velocityScale, b.velocities[i].magnitude());
+        positionDifference = std::max(positionDifference, (a.positions[i] - b.positions[i]).magnitude());
+        velocityDifference = std::max(velocityDifference, (a.velocities[i] - b.velocities[i]).magnitude());
+    }
+    return std::max(positionDifference / (positionScale + 1e-300), velocityDifference / (velocityScale + 1e-300));
+}
+
+unsigned int PararealIntegrator::automaticSliceCount(const NBodyState& state, double duration, unsigned int minimum) const {
+    if (state.positions.size() < 2) {
+        return minimum;
+    }
+
+    // Periods of the circular orbits at each body's current distance from the heaviest one
+    const std::size_t central = std::max_element(gravitationalParameters.begin(), gravitationalParameters.end()) - gravitationalParameters.begin();
+    double shortestPeriod = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < state.positions.size(); ++i) {
+        const double distance = (state.positions[i] - state.positions[central]).magnitude();
+        if (i != central && distance > 0.0) {
+            const double mu = gravitationalParameters[central] + gravitationalParameters[i];
+            shortestPeriod = std::min(shortestPeriod, 2.0 * Utilities::PI * std::sqrt(distance * distance * distance / mu));
+        }
+    }
+    if (!std::isfinite(shortestPeriod)) {
+        return minimum;
+    }
+
+    const double slices = std::ceil(std::abs(duration) * SLICES_PER_ORBIT / shortestPeriod);
+    return static_cast<unsigned int>(std::clamp(slices, static_cast<double>(minimum), static_cast<double>(std::numeric_limits<unsigned int>::max())));
+}
+
+NBodyState PararealIntegrator::integrate(const NBodyState& initial, double duration) {
+    const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned int threadCount = settings.threadCount != 0 ? settings.threadCount : hardwareThreads;
+    const unsigned int sliceCount = settings.sliceCount != 0 ? settings.sliceCount : automaticSliceCount(initial, duration, threadCount);
+    const unsigned int defaultWindowSlices = threadCount >= MIN_PARALLEL_THREADS ? threadCount : 1;
+    const unsigned int windowSlices = std::min(sliceCount, settings.windowSlices != 0 ? settings.windowSlices : defaultWindowSlices);
+    const double sliceDuration = duration / sliceCount;
+
+    iterationsUsed = 0;
+    windowsUsed = 0;
+    NBodyState state = initial;
+    for (unsigned int first = 0; first < sliceCount; first += windowSlices) {
+        const unsigned int count = std::min(windowSlices, sliceCount - first);
+        state = integrateWindow(state, sliceDuration, count, std::min(count, threadCount));
+        ++windowsUsed;
+    }
+    return state;
+}
+
+NBodyState PararealIntegrator::integrateWindow(const NBodyState& initial, double sliceDuration, unsigned int sliceCount, unsigned int threadCount) {
+    // One slice is exact after the first fine sweep, the coarse sweeps around it would be wasted
+    if (sliceCount == 1) {
+        NBodyState state = initial;
+        propagateFine(state, sliceDuration);
+        ++iterationsUsed;
+        return state;
+    }
+
+    const unsigned int maxIterations = settings.maxIterations != 0 ? std::min(settings.maxIterations, sliceCount) : sliceCount;
+
+    // slices[n] is the state at the start of slice n, slices[sliceCount] the final state
+    std::vector<NBodyState> slices(sliceCount + 1);
+    std::vector<NBodyState> coarse(sliceCount);
+    std::vector<NBodyState> fine(sliceCount);
+
+    slices[0] = initial;
+    for (unsigned int n = 0; n < sliceCount; ++n) {
+        coarse[n] = slices[n];
+        propagateCoarse(coarse[n], sliceDuration);
+        slices[n + 1] = coarse[n];
+    }
+
+    unsigned int firstOpenSlice = 0;
+
+    for (unsigned int iteration = 1; iteration <= maxIterations; ++iteration) {
+        // Fine sweep, every open slice is independent. An error, such as two bodies meeting, stops the other
+        // workers taking new slices and is rethrown here once they are done, rather than escaping its thread.
+        std::atomic<unsigned int> nextSlice(firstOpenSlice);
+        std::mutex errorMutex;
+        std::exception_ptr workerError;
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&] {
+                try {
+                    for (unsigned int n = nextSlice++; n < sliceCount; n = nextSlice++) {
+                        fine[n] = slices[n];
+                        propagateFine(fine[n], sliceDuration);
+                    }
+                }
+                catch (...) {
+                    nextSlice = sliceCount;
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!workerError) {
+                        workerError = std::current_exception();
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (workerError) {
+            std::rethrow_exception(workerError);
+        }
+
+        // Serial coarse correction sweep
+        double largestChange = 0.0;
+        NBodyState corrected;
+        for (unsigned int n = firstOpenSlice; n < sliceCount; ++n) {
+            NBodyState predicted = slices[n];
+            propagateCoarse(predicted, sliceDuration);
+
+            assign(corrected.positions, lazy(predicted.positions) + lazy(fine[n].positions) - lazy(coarse[n].positions));
+            assign(corrected.velocities, lazy(predicted.velocities) + lazy(fine[n].velocities) - lazy(coarse[n].velocities));
+
+            largestChange = std::max(largestChange, relativeDifference(corrected, slices[n + 1]));
+            coarse[n] = std::move(predicted);
+            std::swap(slices[n + 1], corrected);
+        }
+
+        // The slice after the last converged one now holds exactly the serial fine solution
+        ++firstOpenSlice;
+        ++iterationsUsed;
+
+        if (largestChange < settings.tolerance || firstOpenSlice == sliceCount) {
+            break;
+        }
+    }
+
+    return slices[sliceCount];
+}
@@ -0,0 +1,57 @@
+
+#include <utils/AllocationCounter.h>
+
+#ifdef SOLAR_SYSTEM_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<std::size_t> allocationCount(0);
+
+    void* countedAllocate(std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        if (void* memory = std::malloc(size != 0 ? size : 1)) {
+            return memory;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+std::size_t Utilities::AllocationCounter::getCount() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+std::size_t Utilities::AllocationCounter::getCount() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,288 @@
+
+#include <utils/BinaryCatalog.h>
+#include <celestial/SolarSystemModel.h>
+#include <celestial/Asteroid.h>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Utilities;
+
+namespace {
+
+    const char CATALOG_MAGIC[8] = { 'S', 'S', 'C', 'A', 'T', 'L', 'G', '\0' };
+    constexpr std::size_t COLUMN_ALIGNMENT = 64;
+    constexpr std::size_t COLUMN_COUNT = static_cast<std::size_t>(CatalogColumnId::Count);
+    constexpr std::size_t FIRST_DOUBLE_COLUMN = static_cast<std::size_t>(CatalogColumnId::Mass);
+    constexpr std::size_t DOUBLE_COLUMN_COUNT = COLUMN_COUNT - FIRST_DOUBLE_COLUMN;
+
+    inline std::size_t alignUp(std::size_t offset) {
+        return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+    }
+
+    std::size_t elementSizeOf(CatalogColumnId column) {
+        switch (column) {
+        case CatalogColumnId::Type: return sizeof(std::uint8_t);
+        case CatalogColumnId::NameOffset: return sizeof(std::uint64_t);
+        case CatalogColumnId::NameLength: return sizeof(std::uint32_t);
+        default: return sizeof(double);
+        }
+    }
+
+    void writePadding(std::ofstream& output, std::size_t& written, std::size_t target) {
+        static const char zeros[COLUMN_ALIGNMENT] = {};
+        while (written < target) {
+            const std::size_t chunk = std::min(target - written, COLUMN_ALIGNMENT);
+            output.write(zeros, static_cast<std::streamsize>(chunk));
+            written += chunk;
+        }
+    }
+}
+
+CatalogBodyType Utilities::parseCatalogBodyType(const std::string& type) {
+    if (type == "Star") {
+        return CatalogBodyType::Star;
+    }
+    if (type == "Planet") {
+        return CatalogBodyType::Planet;
+    }
+    if (type == "Asteroid") {
+        return CatalogBodyType::Asteroid;
+    }
+    throw std::runtime_error("Unknown celestial body type: " + type);
+}
+
+const char* Utilities::toString(CatalogBodyType type) {
+    switch (type) {
+    case CatalogBodyType::Star: return "Star";
+    case CatalogBodyType::Planet: return "Planet";
+    case CatalogBodyType::Asteroid: return "Asteroid";
+    }
+    return "Unknown";
+}
+
+void BinaryCatalogWriter::reserve(std::size_t bodyCount) {
+    types.reserve(bodyCount);
+    nameOffsets.reserve(bodyCount);
+    nameLengths.reserve(bodyCount);
+    for (std::vector<double>& column : doubleColumns) {
+        column.reserve(bodyCount);
+    }
+}
+
+void BinaryCatalogWriter::add(const CelestialBodyRecord& record) {
+    types.push_back(static_cast<std::uint8_t>(parseCatalogBodyType(record.type)));
+    nameOffsets.push_back(names.size());
+    nameLengths.push_back(static_cast<std::uint32_t>(record.name.size()));
+    names += record.name;
+
+    auto column = [this](CatalogColumnId id) -> std::vector<double>& {
+        return doubleColumns[static_cast<std::size_t>(id) - FIRST_DOUBLE_COLUMN];
+    };
+    column(CatalogColumnId::Mass).push_back(record.mass);
+    column(CatalogColumnId::Radius).push_back(record.radius);
+    column(CatalogColumnId::PositionX).push_back(record.position.getX());
+    column(CatalogColumnId::PositionY).push_back(record.position.getY());
+    column(CatalogColumnId::PositionZ).push_back(record.position.getZ());
+    column(CatalogColumnId::VelocityX).push_back(record.velocity.getX());
+    column(CatalogColumnId::VelocityY).push_back(record.velocity.getY());
+    column(CatalogColumnId::VelocityZ).push_back(record.velocity.getZ());
+    column(CatalogColumnId::AngularVelocity).push_back(record.angularVelocity);
+    column(CatalogColumnId::Luminosity).push_back(record.luminosity);
+    column(CatalogColumnId::SurfaceTemperature).push_back(record.surfaceTemperature);
+}
+
+void BinaryCatalogWriter::write(const std::string& path) const {
+    const std::size_t bodyCount = types.size();
+
+    // Lay the file out first so the header and directory can be written in one pass
+    CatalogHeader header = {};
+    std::memcpy(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+    header.version = BinaryCatalog::VERSION;
+    header.byteOrderMark = BinaryCatalog::BYTE_ORDER_MARK;
+    header.bodyCount = bodyCount;
+    header.columnCount = static_cast<std::uint32_t>(COLUMN_COUNT);
+    header.stringTableOffset = sizeof(CatalogHeader) + COLUMN_COUNT * sizeof(CatalogColumn);
+    header.stringTableSize = names.size();
+
+    CatalogColumn directory[COLUMN_COUNT];
+    std::size_t end = static_cast<std::size_t>(header.stringTableOffset + header.stringTableSize);
+    for (std::size_t column = 0; column < COLUMN_COUNT; ++column) {
+        const std::size_t elementSize = elementSizeOf(static_cast<CatalogColumnId>(column));
+        directory[column] = CatalogColumn{ static_cast<std::uint32_t>(column), static_cast<std::uint32_t>(elementSize), alignUp(end) };
+        end = static_cast<std::size_t>(directory[column].offset) + elementSize * bodyCount;
+    }
+    header.fileSize = end;
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + path);
+    }
+
+    std::size_t written = 0;
+    auto writeBytes = [&output, &written](const void* bytes, std::size_t size) {
+        output.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+        written += size;
+    };
+
+    writeBytes(&header, sizeof(header));
+    writeBytes(directory, sizeof(directory));
+    writeBytes(names.data(), names.size());
+
+    for (std::size_t column = 0; column < COLUMN_COUNT; ++column) {
+        writePadding(output, written, static_cast<std::size_t>(directory[column].offset));
+        const std::size_t bytes = directory[column].elementSize * bodyCount;
+        switch (static_cast<CatalogColumnId>(column)) {
+        case CatalogColumnId::Type: writeBytes(types.data(), bytes); break;
+        case CatalogColumnId::NameOffset: writeBytes(nameOffsets.data(), bytes); break;
+        case CatalogColumnId::NameLength: writeBytes(nameLengths.data(), bytes); break;
+        default: writeBytes(doubleColumns[column - FIRST_DOUBLE_COLUMN].data(), bytes); break;
+        }
+    }
+
+    if (!output) {
+        throw std::runtime_error("Could not write binary catalog: " + path);
+    }
+}
+
+BinaryCatalog::BinaryCatalog(const std::string& path) : file(path) {
+    const unsigned char* base = file.data();
+    const std::size_t fileSize = file.size();
+
+    if (fileSize < sizeof(CatalogHeader)) {
+        throw std::runtime_error("File is too small to be a binary catalog: " + path);
+    }
+
+    CatalogHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, CATALOG_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File is not a binary catalog: " + path);
+    }
+    if (header.byteOrderMark != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Binary catalog was written with a different byte order: " + path);
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error("Unsupported binary catalog version " + std::to_string(header.version) + ": " + path);
+    }
+    if (header.fileSize != fileSize) {
+        throw std::runtime_error("Binary catalog is truncated: " + path);
+    }
+
+    const std::uint64_t directoryEnd = sizeof(CatalogHeader) + static_cast<std::uint64_t>(header.columnCount) * sizeof(CatalogColumn);
+    if (directoryEnd > fileSize || header.stringTableOffset > fileSize || header.stringTableSize > fileSize - header.stringTableOffset) {
+        throw std::runtime_error("Binary catalog has an invalid layout: " + path);
+    }
+
+    bodyCount = static_cast<std::size_t>(header.bodyCount);
+    stringTable = reinterpret_cast<const char*>(base + header.stringTableOffset);
+    stringTableSize = static_cast<std::size_t>(header.stringTableSize);
+
+    const void* columns[COLUMN_COUNT] = {};
+    for (std::uint32_t entry = 0; entry < header.columnCount; ++entry) {
+        CatalogColumn column;
+        std::memcpy(&column, base + sizeof(CatalogHeader) + entry * sizeof(CatalogColumn), sizeof(column));
+
+        // Columns from newer writers are skipped, known ones must match their element size and fit the file
+        if (column.id >= COLUMN_COUNT) {
+            continue;
+        }
+        if (column.elementSize != elementSizeOf(static_cast<CatalogColumnId>(column.id))
+            || column.offset % COLUMN_ALIGNMENT != 0
+            || column.offset > fileSize
+            || header.bodyCount > (fileSize - column.offset) / column.elementSize) {
+            throw std::runtime_error("Binary catalog has an invalid column: " + path);
+        }
+        columns[column.id] = base + column.offset;
+    }
+
+    for (std::size_t column = 0; column < COLUMN_COUNT; ++column) {
+        if (columns[column] == nullptr) {
+            throw std::runtime_error("Binary catalog is missing column " + std::to_string(column) + ": " + path);
+        }
+    }
+
+    types = static_cast<const std::uint8_t*>(columns[static_cast<std::size_t>(CatalogColumnId::Type)]);
+    nameOffsets = static_cast<const std::uint64_t*>(columns[static_cast<std::size_t>(CatalogColumnId::NameOffset)]);
+    nameLengths = static_cast<const std::uint32_t*>(columns[static_cast<std::size_t>(CatalogColumnId::NameLength)]);
+    for (std::size_t column = 0; column < DOUBLE_COLUMN_COUNT; ++column) {
+        doubleColumns[column] = static_cast<const double*>(columns[column + FIRST_DOUBLE_COLUMN]);
+    }
+}
+
+std::string_view BinaryCatalog::getName(std::size_t index) const {
+    const std::uint64_t offset = nameOffsets[index];
+    const std::uint32_t length = nameLengths[index];
+    if (offset > stringTableSize || length > stringTableSize - offset) {
+        throw std::runtime_error("Binary catalog name is out of bounds.");
+    }
+    return std::string_view(stringTable + offset, length);
+}
+
+CelestialBodyRecord BinaryCatalog::getRecord(std::size_t index) const {
+    if (index >= bodyCount) {
+        throw std::out_of_range("Binary catalog index out of range.");
+    }
+
+    CelestialBodyRecord record;
+    record.type = toString(getType(index));
+    record.name = std::string(getName(index));
+    record.mass = getColumn(CatalogColumnId::Mass)[index];
+    record.radius = getColumn(CatalogColumnId::Radius)[index];
+    record.position = Vector(getColumn(CatalogColumnId::PositionX)[index], getColumn(CatalogColumnId::PositionY)[index], getColumn(CatalogColumnId::PositionZ)[index]);
+    record.velocity = Vector(getColumn(CatalogColumnId::VelocityX)[index], getColumn(CatalogColumnId::VelocityY)[index], getColumn(CatalogColumnId::VelocityZ)[index]);
+    record.angularVelocity = getColumn(CatalogColumnId::AngularVelocity)[index];
+    record.luminosity = getColumn(CatalogColumnId::Luminosity)[index];
+    record.surfaceTemperature = getColumn(CatalogColumnId::SurfaceTemperature)[index];
+    return record;
+}
+
+std::size_t BinaryCatalog::addToModel(SolarSystem::SolarSystemModel& model) const {
+    const double* mass = getColumn(CatalogColumnId::Mass);
+    const double* radius = getColumn(CatalogColumnId::Radius);
+    const double* positionX = getColumn(CatalogColumnId::PositionX);
+    const double* positionY = getColumn(CatalogColumnId::PositionY);
+    const double* positionZ = getColumn(CatalogColumnId::PositionZ);
+    const double* velocityX = getColumn(CatalogColumnId::VelocityX);
+    const double* velocityY = getColumn(CatalogColumnId::VelocityY);
+    const double* velocityZ = getColumn(CatalogColumnId::VelocityZ);
+    const double* angularVelocity = getColumn(CatalogColumnId::AngularVelocity);
+    const double* luminosity = getColumn(CatalogColumnId::Luminosity);
+    const double* surfaceTemperature = getColumn(CatalogColumnId::SurfaceTemperature);
+
+    // Star is the larger of the two types, so sizing the arena for it covers any mix
+    model.reserveCelestialBodies<SolarSystem::Star>(bodyCount);
+
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        const Vector position(positionX[i], positionY[i], positionZ[i]);
+        const Vector velocity(velocityX[i], velocityY[i], velocityZ[i]);
+        switch (getType(i)) {
+        case CatalogBodyType::Star:
+            model.emplaceCelestialBody<SolarSystem::Star>(mass[i], velocity, radius[i], std::string(getName(i)), position,
+                angularVelocity[i], luminosity[i], surfaceTemperature[i]);
+            break;
+        case CatalogBodyType::Planet:
+            model.emplaceCelestialBody<SolarSystem::Planet>(mass[i], velocity, radius[i], std::string(getName(i)), position,
+                angularVelocity[i]);
+            break;
+        case CatalogBodyType::Asteroid:
+            model.emplaceCelestialBody<SolarSystem::Asteroid>(mass[i], velocity, radius[i], std::string(getName(i)), position,
+                angularVelocity[i]);
+            break;
+        default:
+            throw std::runtime_error("Unknown celestial body type in binary catalog: " + std::to_string(types[i]));
+        }
+    }
+    return bodyCount;
+}
+
+std::size_t BinaryCatalog::ConvertFromJSON(const std::vector<std::string>& jsonPaths, const std::string& outputPath) {
+    BinaryCatalogWriter writer;
+    for (const std::string& path : jsonPaths) {
+        CelestialBodyJSONLoader::StreamBodies(path, [&writer](const CelestialBodyRecord& record) {
+            writer.add(record);
+        });
+    }
+    writer.write(outputPath);
+    return writer.size();
+}
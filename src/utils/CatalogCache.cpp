@@ -0,0 +1,158 @@
+
+#include <utils/CatalogCache.h>
+#include <utils/BinaryCatalog.h>
+#include <utils/MappedFile.h>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <stdexcept>
+
+using namespace Utilities;
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+
+    constexpr const char* CACHE_EXTENSION = ".sscat";
+
+    std::uint64_t hashBytes(const unsigned char* bytes, std::size_t size) {
+        std::uint64_t hash = FNV_OFFSET_BASIS;
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    std::string toHex(std::uint64_t value) {
+        std::ostringstream text;
+        text << std::hex << std::setw(16) << std::setfill('0') << value;
+        return text.str();
+    }
+
+    // Entries are named <catalog stem>-<path hash>-<content hash>.sscat. The stem only keeps the directory readable,
+    // the hash of the absolute source path is what keeps equally named catalogs in different directories apart.
+    std::string entryPrefix(const std::string& catalogPath) {
+        std::error_code error;
+        fs::path absolute = fs::weakly_canonical(fs::absolute(catalogPath, error), error);
+        if (error) {
+            absolute = fs::path(catalogPath);
+        }
+        const std::string source = absolute.generic_string();
+        return fs::path(catalogPath).stem().string() + "-" + toHex(hashBytes(reinterpret_cast<const unsigned char*>(source.data()), source.size())) + "-";
+    }
+
+    bool isEntryOf(const fs::path& entry, const std::string& prefix) {
+        const std::string name = entry.filename().string();
+        return entry.extension() == CACHE_EXTENSION
+            && name.size() == prefix.size() + 16 + std::char_traits<char>::length(CACHE_EXTENSION)
+            && name.compare(0, prefix.size(), prefix) == 0;
+    }
+}
+
+CatalogCache::CatalogCache(std::string cacheDirectory) : directory(std::move(cacheDirectory)) {}
+
+std::uint64_t CatalogCache::HashFile(const std::string& path) {
+    MappedFile file(path);
+    return hashBytes(file.data(), file.size());
+}
+
+std::string CatalogCache::entryPath(const std::string& catalogPath, std::uint64_t contentHash) const {
+    return (fs::path(directory) / (entryPrefix(catalogPath) + toHex(contentHash) + CACHE_EXTENSION)).string();
+}
+
+std::vector<CelestialBodyRecord> CatalogCache::load(const std::string& catalogPath) {
+    const std::uint64_t contentHash = HashFile(catalogPath);
+    const std::string cachedPath = entryPath(catalogPath, contentHash);
+
+    std::error_code error;
+    if (fs::is_regular_file(cachedPath, error)) {
+        try {
+            BinaryCatalog catalog(cachedPath);
+            std::vector<CelestialBodyRecord> records;
+            records.reserve(catalog.size());
+            for (std::size_t i = 0; i < catalog.size(); ++i) {
+                records.push_back(catalog.getRecord(i));
+            }
+            ++hits;
+            return records;
+        }
+        catch (const std::exception&) {
+            // Corrupt or written by another format version, rebuilt below
+        }
+    }
+
+    ++misses;
+    std::vector<CelestialBodyRecord> records;
+    CelestialBodyJSONLoader::StreamBodies(catalogPath, [&records](const CelestialBodyRecord& record) {
+        records.push_back(record);
+    });
+    store(catalogPath, contentHash, records);
+    return records;
+}
+
+void CatalogCache::store(const std::string& catalogPath, std::uint64_t contentHash, const std::vector<CelestialBodyRecord>& records) {
+    // The binary format only knows the built in types, catalogs with registered ones are simply not cached
+    BinaryCatalogWriter writer;
+    writer.reserve(records.size());
+    try {
+        for (const CelestialBodyRecord& record : records) {
+            writer.add(record);
+        }
+    }
+    catch (const std::runtime_error&) {
+        return;
+    }
+
+    // A cache that cannot be written only costs the next launch a parse, so failures here never fail the load
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error) {
+        return;
+    }
+
+    const std::string finalPath = entryPath(catalogPath, contentHash);
+    std::ostringstream temporaryName;
+    temporaryName << finalPath << ".partial-" << std::this_thread::get_id();
+    const std::string temporaryPath = temporaryName.str();
+
+    try {
+        writer.write(temporaryPath);
+    }
+    catch (const std::runtime_error&) {
+        fs::remove(temporaryPath, error);
+        return;
+    }
+
+    fs::rename(temporaryPath, finalPath, error);
+    if (error) {
+        fs::remove(temporaryPath, error);
+        return;
+    }
+
+    // Entries for earlier contents of the same catalog can never hit again
+    const std::string prefix = entryPrefix(catalogPath);
+    const fs::path keep = fs::path(finalPath).filename();
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory, error)) {
+        if (entry.path().filename() != keep && isEntryOf(entry.path(), prefix)) {
+            std::error_code ignored;
+            fs::remove(entry.path(), ignored);
+        }
+    }
+}
+
+void CatalogCache::clear() {
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) {
+        return;
+    }
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory, error)) {
+        if (entry.path().extension() == CACHE_EXTENSION) {
+            std::error_code ignored;
+            fs::remove(entry.path(), ignored);
+        }
+    }
+}
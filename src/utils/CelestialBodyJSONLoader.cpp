@@ -1,39 +1,425 @@
 
 #include <utils/CelestialBodyJSONLoader.h>
+#include <celestial/SolarSystemModel.h>
+#include <utils/ThreadPool.h>
+#include <utils/CatalogCache.h>
+#include <cstdlib>
+#include <cerrno>
+#include <filesystem>
+#include <algorithm>
+#include <iterator>
+#include <future>
+#include <shared_mutex>
+#include <unordered_map>
 using namespace Utilities;
 using json = nlohmann::json;
 
-std::vector<std::unique_ptr<SolarSystem::CelestialBody>> CelestialBodyJSONLoader::LoadBodies(const std::string& filepath)
+namespace {
+
+    // Factories for body types beyond Star, Planet and Asteroid. Catalogs are read concurrently, so lookups share the lock.
+    std::unordered_map<std::string, CelestialBodyJSONLoader::BodyFactory>& bodyFactories() {
+        static std::unordered_map<std::string, CelestialBodyJSONLoader::BodyFactory> factories;
+        return factories;
+    }
+
+    std::shared_mutex& bodyFactoryMutex() {
+        static std::shared_mutex mutex;
+        return mutex;
+    }
+
+    // Returns a copy, so a type registered again while a catalog loads cannot pull the factory from under the caller.
+    // Empty when the type has no factory.
+    CelestialBodyJSONLoader::BodyFactory findBodyFactory(const std::string& type) {
+        std::shared_lock<std::shared_mutex> lock(bodyFactoryMutex());
+        const auto& factories = bodyFactories();
+        auto it = factories.find(type);
+        return it != factories.end() ? it->second : CelestialBodyJSONLoader::BodyFactory();
+    }
+
+    // SAX consumer that assembles one CelestialBodyRecord at a time. Container depth and the key at each level are
+    // enough to tell where a value belongs: depth 2 is the body array, 3 a body and 4 a position or velocity, which
+    // may be an object with x, y and z or an array of the three components.
+    class RecordSaxHandler : public nlohmann::json_sax<json> {
+    public:
+
+        RecordSaxHandler(const CelestialBodyJSONLoader::RecordCallback& onRecord, const std::string& sourceName)
+            : onRecord(onRecord), sourceName(sourceName) {}
+
+        bool null() override {
+            rejectScalarVector();
+            return true;
+        }
+
+        bool boolean(bool) override {
+            rejectScalarVector();
+            return true;
+        }
+
+        bool number_integer(number_integer_t value) override {
+            setNumber(static_cast<double>(value));
+            return true;
+        }
+
+        bool number_unsigned(number_unsigned_t value) override {
+            setNumber(static_cast<double>(value));
+            return true;
+        }
+
+        bool number_float(number_float_t value, const string_t&) override {
+            setNumber(value);
+            return true;
+        }
+
+        bool string(string_t& value) override {
+            if (!inRecord()) {
+                return true;
+            }
+            rejectScalarVector();
+            if (depth == RECORD_DEPTH && keys[RECORD_DEPTH] == "type") {
+                record.type = value;
+            }
+            else if (depth == RECORD_DEPTH && keys[RECORD_DEPTH] == "name") {
+                record.name = value;
+            }
+            else if (isNumericField()) {
+                // Masses beyond the range some writers allow for numbers arrive quoted
+                setNumber(parseNumber(value));
+            }
+            // Any other string, such as a colour or a description, is not part of the record
+            return true;
+        }
+
+        bool binary(binary_t&) override {
+            return true;
+        }
+
+        bool start_object(std::size_t) override {
+            ++depth;
+            if (depth == RECORD_DEPTH && inBodyArray) {
+                record = CelestialBodyRecord();
+                hasMass = false;
+            }
+            clearKey();
+            return true;
+        }
+
+        bool key(string_t& value) override {
+            if (depth < MAX_TRACKED_DEPTH) {
+                keys[depth] = value;
+            }
+            return true;
+        }
+
+        bool end_object() override {
+            if (depth == RECORD_DEPTH && inBodyArray) {
+                finishRecord();
+            }
+            --depth;
+            return true;
+        }
+
+        bool start_array(std::size_t) override {
+            ++depth;
+            if (depth == ARRAY_DEPTH && (keys[1] == "celestialBodies" || keys[1] == "stars")) {
+                inBodyArray = true;
+            }
+            else if (depth == VECTOR_DEPTH && inRecord() && isVectorField()) {
+                vectorComponent = 0;
+            }
+            clearKey();
+            return true;
+        }
+
+        bool end_array() override {
+            if (depth == ARRAY_DEPTH) {
+                inBodyArray = false;
+            }
+            else if (depth == VECTOR_DEPTH && vectorComponent >= 0) {
+                if (vectorComponent != 3) {
+                    rejectVector();
+                }
+                vectorComponent = -1;
+            }
+            --depth;
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& error) override {
+            throw std::runtime_error("Could not parse " + sourceName + " at byte " + std::to_string(position) + ": " + error.what());
+        }
+
+    private:
+
+        static constexpr int ARRAY_DEPTH = 2;
+        static constexpr int RECORD_DEPTH = 3;
+        static constexpr int VECTOR_DEPTH = 4;
+        static constexpr int MAX_TRACKED_DEPTH = 5;
+
+        const CelestialBodyJSONLoader::RecordCallback& onRecord;
+        const std::string& sourceName;
+
+        int depth = 0;
+        std::string keys[MAX_TRACKED_DEPTH];
+        bool inBodyArray = false;
+        CelestialBodyRecord record;
+        bool hasMass = false;
+        int vectorComponent = -1;           // Next component of a vector written as an array, -1 outside one
+
+        bool inRecord() const {
+            return inBodyArray && depth >= RECORD_DEPTH;
+        }
+
+        void clearKey() {
+            if (depth < MAX_TRACKED_DEPTH) {
+                keys[depth].clear();
+            }
+        }
+
+        double parseNumber(const std::string& text) const {
+            const char* begin = text.c_str();
+            char* end = nullptr;
+            errno = 0;
+            double value = std::strtod(begin, &end);
+            if (end == begin || *end != '\0' || errno == ERANGE) {
+                throw std::runtime_error("Invalid number \"" + text + "\" for " + keys[RECORD_DEPTH] + " in " + sourceName);
+            }
+            return value;
+        }
+
+        bool isVectorField() const {
+            return keys[RECORD_DEPTH] == "position" || keys[RECORD_DEPTH] == "velocity";
+        }
+
+        // A vector that is neither an object nor an array of three numbers would leave the body at the origin at rest
+        [[noreturn]] void rejectVector() const {
+            const std::string body = record.name.empty() ? "a celestial body" : "\"" + record.name + "\"";
+            throw std::runtime_error("The " + keys[RECORD_DEPTH] + " of " + body + " in " + sourceName + " must be an object with x, y and z or an array of three numbers.");
+        }
+
+        void rejectScalarVector() const {
+            if (inRecord() && depth == RECORD_DEPTH && isVectorField()) {
+                rejectVector();
+            }
+        }
+
+        // The fields setNumber() stores, anything else is skipped whatever its value
+        bool isNumericField() const {
+            const std::string& field = keys[RECORD_DEPTH];
+            if (depth == VECTOR_DEPTH && vectorComponent >= 0) {
+                return true;
+            }
+            if (depth == VECTOR_DEPTH) {
+                const std::string& axis = keys[VECTOR_DEPTH];
+                return (field == "position" || field == "velocity") && (axis == "x" || axis == "y" || axis == "z");
+            }
+            return depth == RECORD_DEPTH && (field == "mass" || field == "radius" || field == "angularVelocity"
+                || field == "luminosity" || field == "surfaceTemperature");
+        }
+
+        static void setComponent(Vector& vector, const std::string& axis, double value) {
+            if (axis == "x") vector.setX(value);
+            else if (axis == "y") vector.setY(value);
+            else if (axis == "z") vector.setZ(value);
+        }
+
+        static void setComponent(Vector& vector, int component, double value) {
+            if (component == 0) vector.setX(value);
+            else if (component == 1) vector.setY(value);
+            else vector.setZ(value);
+        }
+
+        void setNumber(double value) {
+            if (!inRecord()) {
+                return;
+            }
+
+            const std::string& field = keys[RECORD_DEPTH];
+            if (depth == VECTOR_DEPTH && vectorComponent >= 0) {
+                if (vectorComponent == 3) {
+                    rejectVector();
+                }
+                Vector& vector = field == "position" ? record.position : record.velocity;
+                setComponent(vector, vectorComponent++, value);
+                return;
+            }
+            if (depth == VECTOR_DEPTH) {
+                if (field == "position") setComponent(record.position, keys[VECTOR_DEPTH], value);
+                else if (field == "velocity") setComponent(record.velocity, keys[VECTOR_DEPTH], value);
+                return;
+            }
+            if (depth != RECORD_DEPTH) {
+                return;
+            }
+
+            rejectScalarVector();
+            if (field == "mass") {
+                record.mass = value;
+                hasMass = true;
+            }
+            else if (field == "radius") record.radius = value;
+            else if (field == "angularVelocity") record.angularVelocity = value;
+            else if (field == "luminosity") record.luminosity = value;
+            else if (field == "surfaceTemperature") record.surfaceTemperature = value;
+        }
+
+        void finishRecord() {
+            if (record.type.empty() || record.name.empty() || !hasMass) {
+                throw std::runtime_error("Celestial body in " + sourceName + " is missing its type, name or mass.");
+            }
+            onRecord(record);
+        }
+    };
+}
+
+void CelestialBodyJSONLoader::StreamBodies(std::istream& input, const RecordCallback& onRecord, const std::string& sourceName)
 {
-    std::ifstream file(filepath);
+    RecordSaxHandler handler(onRecord, sourceName);
+    json::sax_parse(input, &handler);
+}
+
+void CelestialBodyJSONLoader::StreamBodies(const std::string& filepath, const RecordCallback& onRecord)
+{
+    std::ifstream file(filepath, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file: " + filepath);
     }
 
-    json j;
-    file >> j;
+    StreamBodies(file, onRecord, filepath);
+}
 
+void CelestialBodyJSONLoader::RegisterBodyType(const std::string& type, BodyFactory factory)
+{
+    if (!factory) {
+        throw std::runtime_error("Attempt to register a null factory for celestial body type: " + type);
+    }
+    std::unique_lock<std::shared_mutex> lock(bodyFactoryMutex());
+    bodyFactories()[type] = std::move(factory);
+}
+
+std::unique_ptr<SolarSystem::CelestialBody> CelestialBodyJSONLoader::CreateBody(const CelestialBodyRecord& record)
+{
+    if (const BodyFactory factory = findBodyFactory(record.type)) {
+        return factory(record);
+    }
+    if (record.type == "Star") {
+        return std::make_unique<SolarSystem::Star>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity, record.luminosity, record.surfaceTemperature);
+    }
+    if (record.type == "Planet") {
+        return std::make_unique<SolarSystem::Planet>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity);
+    }
+    if (record.type == "Asteroid") {
+        return std::make_unique<SolarSystem::Asteroid>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity);
+    }
+    throw std::runtime_error("Unknown celestial body type: " + record.type);
+}
+
+void CelestialBodyJSONLoader::AddBody(const CelestialBodyRecord& record, SolarSystem::SolarSystemModel& model)
+{
+    // Registered types live on the heap, their factories do not know about the model's arena
+    if (const BodyFactory factory = findBodyFactory(record.type)) {
+        model.addCelestialBody(factory(record));
+    }
+    else if (record.type == "Star") {
+        model.emplaceCelestialBody<SolarSystem::Star>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity, record.luminosity, record.surfaceTemperature);
+    }
+    else if (record.type == "Planet") {
+        model.emplaceCelestialBody<SolarSystem::Planet>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity);
+    }
+    else if (record.type == "Asteroid") {
+        model.emplaceCelestialBody<SolarSystem::Asteroid>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity);
+    }
+    else {
+        throw std::runtime_error("Unknown celestial body type: " + record.type);
+    }
+}
+
+std::vector<std::unique_ptr<SolarSystem::CelestialBody>> CelestialBodyJSONLoader::LoadBodies(const std::string& filepath)
+{
     std::vector<std::unique_ptr<SolarSystem::CelestialBody>> bodies;
 
-    for (const auto& item : j["celestialBodies"]) {
-        std::string type = item["type"];
-        if (type == "Star") {
-            bodies.push_back(std::make_unique<SolarSystem::Star>(
-                item["mass"],
-                Utilities::Vector(item["position"]["x"], item["position"]["y"], item["position"]["z"]),
-                item["radius"],
-                item["name"],
-                Utilities::Vector(item["velocity"]["x"], item["velocity"]["y"], item["velocity"]["z"]),
-                item["angularVelocity"],
-                item["luminosity"],
-                item["surfaceTemperature"]
-            ));
+    StreamBodies(filepath, [&bodies](const CelestialBodyRecord& record) {
+        bodies.push_back(CreateBody(record));
+    });
+
+    return bodies;
+}
+
+std::size_t CelestialBodyJSONLoader::LoadBodies(const std::string& filepath, SolarSystem::SolarSystemModel& model)
+{
+    std::size_t added = 0;
+
+    StreamBodies(filepath, [&model, &added](const CelestialBodyRecord& record) {
+        AddBody(record, model);
+        ++added;
+    });
+
+    return added;
+}
+
+std::vector<std::string> CelestialBodyJSONLoader::FindCatalogs(const std::string& directory)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) {
+        throw std::runtime_error("Not a catalog directory: " + directory);
+    }
+
+    std::vector<std::string> catalogs;
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+            catalogs.push_back(entry.path().string());
         }
-        else if (type == "Planet") {
-            
+    }
+    std::sort(catalogs.begin(), catalogs.end());
+    return catalogs;
+}
+
+std::size_t CelestialBodyJSONLoader::LoadDirectory(const std::string& directory, SolarSystem::SolarSystemModel& model, unsigned int threadCount,
+    CatalogCache* cache)
+{
+    using BodyList = std::vector<std::unique_ptr<SolarSystem::CelestialBody>>;
+
+    const std::vector<std::string> catalogs = FindCatalogs(directory);
+    if (catalogs.empty()) {
+        return 0;
+    }
+
+    // Bodies are built on the workers too, only the insert into the model is serial
+    std::vector<std::future<BodyList>> parsed;
+    parsed.reserve(catalogs.size());
+    {
+        ThreadPool pool(std::min<unsigned int>(threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency()),
+            static_cast<unsigned int>(catalogs.size())));
+
+        for (const std::string& catalog : catalogs) {
+            parsed.push_back(pool.submit([&catalog, cache] {
+                if (cache == nullptr) {
+                    return LoadBodies(catalog);
+                }
+                BodyList bodies;
+                for (const CelestialBodyRecord& record : cache->load(catalog)) {
+                    bodies.push_back(CreateBody(record));
+                }
+                return bodies;
+            }));
         }
-       
     }
 
-    return bodies;
+    // Collected in catalog order so handles and body indices do not depend on which file finished first
+    BodyList bodies;
+    for (std::future<BodyList>& result : parsed) {
+        BodyList catalogBodies = result.get();
+        std::move(catalogBodies.begin(), catalogBodies.end(), std::back_inserter(bodies));
+    }
+
+    const std::size_t added = bodies.size();
+    model.addCelestialBodies(std::move(bodies));
+    return added;
 }
@@ -0,0 +1,218 @@
+
+#include <utils/CheckpointFile.h>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace Utilities;
+namespace fs = std::filesystem;
+
+namespace {
+
+    const char CHECKPOINT_MAGIC[8] = { 'S', 'S', 'C', 'H', 'K', 'P', 'T', '\0' };
+
+    static_assert(sizeof(Vector) == 3 * sizeof(double) && std::is_trivially_copyable<Vector>::value,
+        "Checkpoints store vectors as raw triples of doubles.");
+
+    template <typename T>
+    void writeArray(std::ofstream& output, const std::vector<T>& values) {
+        output.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    template <typename T>
+    void readArray(std::ifstream& input, std::vector<T>& values, std::uint64_t count) {
+        values.resize(static_cast<std::size_t>(count));
+        input.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    // Bytes following the header for the given counts, used both to fill and to check fileSize
+    std::uint64_t payloadSize(std::uint64_t bodyCount, std::uint64_t pairCount, std::uint64_t historySlotCount, std::uint64_t nameBytes) {
+        const std::uint64_t perBody = sizeof(std::uint8_t) + sizeof(std::uint32_t) + 5 * sizeof(double) + 3 * sizeof(Vector) + sizeof(std::uint64_t);
+        const std::uint64_t perPair = sizeof(std::int32_t) + sizeof(Vector) + sizeof(std::uint8_t);
+        return bodyCount * perBody + nameBytes + pairCount * perPair + historySlotCount * sizeof(Vector);
+    }
+}
+
+void CheckpointFile::Write(const SolarSystem::ModelCheckpoint& checkpoint, const std::string& path) {
+    const std::size_t bodyCount = checkpoint.bodyCount();
+
+    std::vector<std::uint32_t> nameLengths;
+    nameLengths.reserve(bodyCount);
+    std::uint64_t nameBytes = 0;
+    for (const std::string& name : checkpoint.names) {
+        nameLengths.push_back(static_cast<std::uint32_t>(name.size()));
+        nameBytes += name.size();
+    }
+
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.bodyCount = bodyCount;
+    header.pairCount = checkpoint.pairScores.size();
+    header.historySlotCount = checkpoint.historySlots.size();
+    header.nameBytes = nameBytes;
+    header.fileSize = sizeof(CheckpointHeader) + payloadSize(header.bodyCount, header.pairCount, header.historySlotCount, nameBytes);
+    header.simulationTime = checkpoint.simulationTime;
+    header.multistepTimestep = checkpoint.multistepTimestep;
+    header.encounterTimescaleRatio = checkpoint.encounterTimescaleRatio;
+    header.historyHead = checkpoint.historyHead;
+    header.historyCount = checkpoint.historyCount;
+    header.integrationMethod = static_cast<std::uint32_t>(checkpoint.integrationMethod);
+    header.multistepOrder = checkpoint.multistepOrder;
+    header.historyIsCurrent = checkpoint.historyIsCurrent ? 1 : 0;
+    header.closeEncounterHandling = checkpoint.closeEncounterHandling ? 1 : 0;
+
+    const std::string temporaryPath = path + ".partial";
+    {
+        std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!output.is_open()) {
+            throw std::runtime_error("Could not open file for writing: " + temporaryPath);
+        }
+
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(output, checkpoint.bodyTypes);
+        writeArray(output, nameLengths);
+        for (const std::string& name : checkpoint.names) {
+            output.write(name.data(), static_cast<std::streamsize>(name.size()));
+        }
+        writeArray(output, checkpoint.masses);
+        writeArray(output, checkpoint.radii);
+        writeArray(output, checkpoint.angularVelocities);
+        writeArray(output, checkpoint.luminosities);
+        writeArray(output, checkpoint.surfaceTemperatures);
+        writeArray(output, checkpoint.positions);
+        writeArray(output, checkpoint.velocities);
+        writeArray(output, checkpoint.accelerations);
+        writeArray(output, checkpoint.pairScores);
+        writeArray(output, checkpoint.pairCouplings);
+        writeArray(output, checkpoint.pairInEncounter);
+        writeArray(output, checkpoint.historySlots);
+        writeArray(output, checkpoint.encounterGroupOf);
+
+        output.flush();
+        if (!output) {
+            output.close();
+            std::error_code ignored;
+            fs::remove(temporaryPath, ignored);
+            throw std::runtime_error("Could not write checkpoint: " + path);
+        }
+    }
+
+    std::error_code error;
+    fs::rename(temporaryPath, path, error);
+    if (error) {
+        std::error_code ignored;
+        fs::remove(temporaryPath, ignored);
+        throw std::runtime_error("Could not replace checkpoint " + path + ": " + error.message());
+    }
+}
+
+SolarSystem::ModelCheckpoint CheckpointFile::Read(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) {
+        throw std::runtime_error("Could not open checkpoint: " + path);
+    }
+
+    CheckpointHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File is not a checkpoint: " + path);
+    }
+    if (header.byteOrderMark != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Checkpoint was written with a different byte order: " + path);
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error("Unsupported checkpoint version " + std::to_string(header.version) + ": " + path);
+    }
+
+    // Checked before anything is allocated, a damaged header cannot ask for more memory than the file holds
+    std::error_code error;
+    const std::uint64_t actualSize = fs::file_size(path, error);
+    if (error || header.fileSize != actualSize || header.bodyCount > actualSize || header.pairCount > actualSize
+        || header.historySlotCount > actualSize || header.nameBytes > actualSize
+        || header.fileSize != sizeof(CheckpointHeader) + payloadSize(header.bodyCount, header.pairCount, header.historySlotCount, header.nameBytes)) {
+        throw std::runtime_error("Checkpoint is truncated: " + path);
+    }
+
+    SolarSystem::ModelCheckpoint checkpoint;
+    checkpoint.simulationTime = header.simulationTime;
+    checkpoint.integrationMethod = static_cast<SolarSystem::IntegrationMethod>(header.integrationMethod);
+    checkpoint.multistepOrder = header.multistepOrder;
+    checkpoint.multistepTimestep = header.multistepTimestep;
+    checkpoint.historyIsCurrent = header.historyIsCurrent != 0;
+    checkpoint.historyHead = header.historyHead;
+    checkpoint.historyCount = header.historyCount;
+    checkpoint.closeEncounterHandling = header.closeEncounterHandling != 0;
+    checkpoint.encounterTimescaleRatio = header.encounterTimescaleRatio;
+
+    std::vector<std::uint32_t> nameLengths;
+    readArray(input, checkpoint.bodyTypes, header.bodyCount);
+    readArray(input, nameLengths, header.bodyCount);
+
+    std::string names(static_cast<std::size_t>(header.nameBytes), '\0');
+    input.read(&names[0], static_cast<std::streamsize>(names.size()));
+    checkpoint.names.reserve(nameLengths.size());
+    std::size_t nameOffset = 0;
+    for (std::uint32_t length : nameLengths) {
+        if (length > names.size() - nameOffset) {
+            throw std::runtime_error("Checkpoint has an invalid name table: " + path);
+        }
+        checkpoint.names.emplace_back(names, nameOffset, length);
+        nameOffset += length;
+    }
+
+    readArray(input, checkpoint.masses, header.bodyCount);
+    readArray(input, checkpoint.radii, header.bodyCount);
+    readArray(input, checkpoint.angularVelocities, header.bodyCount);
+    readArray(input, checkpoint.luminosities, header.bodyCount);
+    readArray(input, checkpoint.surfaceTemperatures, header.bodyCount);
+    readArray(input, checkpoint.positions, header.bodyCount);
+    readArray(input, checkpoint.velocities, header.bodyCount);
+    readArray(input, checkpoint.accelerations, header.bodyCount);
+    readArray(input, checkpoint.pairScores, header.pairCount);
+    readArray(input, checkpoint.pairCouplings, header.pairCount);
+    readArray(input, checkpoint.pairInEncounter, header.pairCount);
+    readArray(input, checkpoint.historySlots, header.historySlotCount);
+    readArray(input, checkpoint.encounterGroupOf, header.bodyCount);
+
+    if (!input) {
+        throw std::runtime_error("Checkpoint is truncated: " + path);
+    }
+    return checkpoint;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (pending.valid()) {
+        try {
+            pending.get();
+        }
+        catch (const std::exception&) {
+            // Destructors cannot report a failed write, call wait() to see it
+        }
+    }
+}
+
+bool CheckpointWriter::isBusy() const {
+    return pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+bool CheckpointWriter::writeAsync(SolarSystem::ModelCheckpoint checkpoint, const std::string& path) {
+    if (isBusy()) {
+        return false;
+    }
+    wait();
+
+    pending = std::async(std::launch::async, [checkpoint = std::move(checkpoint), path]() {
+        CheckpointFile::Write(checkpoint, path);
+    });
+    return true;
+}
+
+void CheckpointWriter::wait() {
+    if (pending.valid()) {
+        pending.get();
+    }
+}
@@ -0,0 +1,210 @@
+
+#include <utils/Frustum.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using namespace Utilities;
+
+namespace {
+
+    // Spreads the low 10 bits of value so two zero bits follow each one
+    inline std::uint32_t spreadBits(std::uint32_t value) {
+        value &= 0x3ff;
+        value = (value | (value << 16)) & 0x030000ff;
+        value = (value | (value << 8)) & 0x0300f00f;
+        value = (value | (value << 4)) & 0x030c30c3;
+        value = (value | (value << 2)) & 0x09249249;
+        return value;
+    }
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    // glm is column major, row i of the matrix is m[0][i], m[1][i], m[2][i], m[3][i]
+    auto row = [&viewProjection](int i) {
+        return std::array<double, 4>{ viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+    };
+    const std::array<double, 4> x = row(0), y = row(1), z = row(2), w = row(3);
+    const std::array<std::array<double, 4>, 6> planes = { {
+        { w[0] + x[0], w[1] + x[1], w[2] + x[2], w[3] + x[3] },     // Left
+        { w[0] - x[0], w[1] - x[1], w[2] - x[2], w[3] - x[3] },     // Right
+        { w[0] + y[0], w[1] + y[1], w[2] + y[2], w[3] + y[3] },     // Bottom
+        { w[0] - y[0], w[1] - y[1], w[2] - y[2], w[3] - y[3] },     // Top
+        { w[0] + z[0], w[1] + z[1], w[2] + z[2], w[3] + z[3] },     // Near
+        { w[0] - z[0], w[1] - z[1], w[2] - z[2], w[3] - z[3] }      // Far
+    } };
+
+    for (std::size_t i = 0; i < planes.size(); ++i) {
+        const Vec3 normal(planes[i][0], planes[i][1], planes[i][2]);
+        const double scale = 1.0 / length(normal);
+        normals[i] = normal * scale;
+        offsets[i] = planes[i][3] * scale;
+    }
+}
+
+bool Frustum::intersectsSphere(const Vec3& center, double radius) const {
+    for (std::size_t i = 0; i < normals.size(); ++i) {
+        if (dot(normals[i], center) + offsets[i] < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Frustum::Containment Frustum::classifySphere(const Vec3& center, double radius) const {
+    Containment containment = Containment::Inside;
+    for (std::size_t i = 0; i < normals.size(); ++i) {
+        const double distance = dot(normals[i], center) + offsets[i];
+        if (distance < -radius) {
+            return Containment::Outside;
+        }
+        if (distance < radius) {
+            containment = Containment::Intersecting;
+        }
+    }
+    return containment;
+}
+
+void Frustum::cullSpheres(const Vec3* centers, const double* radii, std::size_t count, unsigned char* visible) const {
+    constexpr std::size_t width = Vec3x4::width();
+
+    for (std::size_t first = 0; first < count; first += width) {
+        const std::size_t lanes = std::min(width, count - first);
+        Lanes<double, width> x, y, z, radius;
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            x[lane] = centers[first + lane].x;
+            y[lane] = centers[first + lane].y;
+            z[lane] = centers[first + lane].z;
+            radius[lane] = radii[first + lane];
+        }
+
+        // Smallest signed distance plus radius over all planes, negative once any plane rejects the sphere. Written
+        // lane by lane with the plane in scalars, which vectorizes better than the Vec3x4 operators here.
+        Lanes<double, width> nearest(std::numeric_limits<double>::infinity());
+        for (std::size_t i = 0; i < normals.size(); ++i) {
+            const Vec3& normal = normals[i];
+            const double offset = offsets[i];
+            for (std::size_t lane = 0; lane < width; ++lane) {
+                nearest[lane] = std::min(nearest[lane], x[lane] * normal.x + y[lane] * normal.y + z[lane] * normal.z + offset + radius[lane]);
+            }
+        }
+
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            visible[first + lane] = nearest[lane] >= 0.0 ? 1 : 0;
+        }
+    }
+}
+
+const std::vector<std::uint32_t>& FrustumCuller::cull(const Frustum& frustum, const std::vector<Vec3>& centers, const std::vector<double>& radii) {
+    const std::size_t count = centers.size();
+    visibleIndices.clear();
+    clustersTested = 0;
+
+    if (count < HIERARCHY_THRESHOLD) {
+        visible.resize(count);
+        frustum.cullSpheres(centers.data(), radii.data(), count, visible.data());
+        spheresTested = count;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (visible[i]) {
+                visibleIndices.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+        return visibleIndices;
+    }
+
+    if (order.size() != count || ++callsSinceRegroup >= REGROUP_INTERVAL) {
+        regroup(centers);
+    }
+
+    refitClusters(centers, radii);
+
+    spheresTested = 0;
+    for (const Cluster& cluster : clusters) {
+        ++clustersTested;
+        const Frustum::Containment containment = frustum.classifySphere(cluster.center, cluster.radius);
+        if (containment == Frustum::Containment::Outside) {
+            continue;
+        }
+        if (containment == Frustum::Containment::Inside) {
+            visibleIndices.insert(visibleIndices.end(), order.begin() + cluster.first, order.begin() + cluster.first + cluster.count);
+            continue;
+        }
+
+        // Only clusters straddling a plane need their members tested, gathered so they can go four at a time
+        memberCenters.resize(cluster.count);
+        memberRadii.resize(cluster.count);
+        for (std::size_t m = 0; m < cluster.count; ++m) {
+            const std::uint32_t index = order[cluster.first + m];
+            memberCenters[m] = centers[index];
+            memberRadii[m] = radii[index];
+        }
+        visible.resize(cluster.count);
+        frustum.cullSpheres(memberCenters.data(), memberRadii.data(), cluster.count, visible.data());
+        spheresTested += cluster.count;
+        for (std::size_t m = 0; m < cluster.count; ++m) {
+            if (visible[m]) {
+                visibleIndices.push_back(order[cluster.first + m]);
+            }
+        }
+    }
+    return visibleIndices;
+}
+
+void FrustumCuller::regroup(const std::vector<Vec3>& centers) {
+    const std::size_t count = centers.size();
+    callsSinceRegroup = 0;
+
+    Vec3 lower(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+    Vec3 upper = -lower;
+    for (const Vec3& center : centers) {
+        lower = Vec3(std::min(lower.x, center.x), std::min(lower.y, center.y), std::min(lower.z, center.z));
+        upper = Vec3(std::max(upper.x, center.x), std::max(upper.y, center.y), std::max(upper.z, center.z));
+    }
+
+    // 10 bits per axis over the bounding box, enough to keep each cluster of 64 compact for a million bodies
+    const Vec3 extent = upper - lower;
+    auto quantize = [](double offset, double size) {
+        return size > 0.0 ? static_cast<std::uint32_t>(std::min(1023.0, offset / size * 1024.0)) : 0u;
+    };
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> codes(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Vec3 offset = centers[i] - lower;
+        const std::uint32_t code = spreadBits(quantize(offset.x, extent.x)) | (spreadBits(quantize(offset.y, extent.y)) << 1) | (spreadBits(quantize(offset.z, extent.z)) << 2);
+        codes[i] = { code, static_cast<std::uint32_t>(i) };
+    }
+    std::sort(codes.begin(), codes.end());
+
+    order.resize(count);
+    clusterOf.resize(count);
+    for (std::size_t k = 0; k < count; ++k) {
+        order[k] = codes[k].second;
+        clusterOf[codes[k].second] = static_cast<std::uint32_t>(k / CLUSTER_SIZE);
+    }
+
+    clusters.clear();
+    for (std::size_t first = 0; first < count; first += CLUSTER_SIZE) {
+        clusters.push_back(Cluster{ first, std::min(CLUSTER_SIZE, count - first), Vec3(), 0.0 });
+    }
+}
+
+void FrustumCuller::refitClusters(const std::vector<Vec3>& centers, const std::vector<double>& radii) {
+    // Bounding sphere of each cluster's bounding box. The spheres are read in the caller's order, which is sequential,
+    // and only the cluster boxes, small enough to stay in cache, are touched out of order.
+    const double limit = std::numeric_limits<double>::max();
+    clusterLower.assign(clusters.size(), Vec3(limit, limit, limit));
+    clusterUpper.assign(clusters.size(), Vec3(-limit, -limit, -limit));
+    for (std::size_t i = 0; i < centers.size(); ++i) {
+        const Vec3& center = centers[i];
+        const double radius = radii[i];
+        Vec3& lower = clusterLower[clusterOf[i]];
+        Vec3& upper = clusterUpper[clusterOf[i]];
+        lower = Vec3(std::min(lower.x, center.x - radius), std::min(lower.y, center.y - radius), std::min(lower.z, center.z - radius));
+        upper = Vec3(std::max(upper.x, center.x + radius), std::max(upper.y, center.y + radius), std::max(upper.z, center.z + radius));
+    }
+
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        clusters[c].center = (clusterLower[c] + clusterUpper[c]) * 0.5;
+        clusters[c].radius = length(clusterUpper[c] - clusterLower[c]) * 0.5;
+    }
+}
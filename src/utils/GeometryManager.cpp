@@ -1,16 +1,35 @@
 #include <utils/GeometryManager.h>
 #include <vector>
+#include <cassert>
 #include <utils/UtilitiesNamespace.h>
 #include <glm/glm.hpp>
 
 namespace Utilities {
 
-    std::unordered_map<GLuint, GeometryManager::GeometryData> GeometryManager::geometries;
+    namespace {
+
+        struct SphereLodLevel {
+            unsigned int longitudeBands;
+            unsigned int latitudeBands;
+            float minPixelRadius;
+        };
+
+        // Each level halves the tessellation of the one before. A level is used until its triangles would be
+        // about four pixels across. Spheres under PointSpriteRenderer::MESH_PIXEL_RADIUS are drawn as sprites rather
+        // than meshes, so the coarsest level is the one for that radius.
+        constexpr SphereLodLevel SPHERE_LOD_LEVELS[] = {
+            { 64, 32, 64.0f },
+            { 32, 16, 16.0f },
+            { 16, 8, 4.0f }
+        };
+    }
 
-    GLuint GeometryManager::generateSphereVAO(float radius, unsigned int longitudeBands, unsigned int latitudeBands, GLuint& indicesCount) {
-        // Example implementation to generate sphere vertices and indices
-        // You would replace this with your actual sphere generation logic
+    std::unordered_map<GLuint, GeometryManager::GeometryEntry> GeometryManager::geometries;
+    std::map<GeometryManager::GeometryKey, GLuint> GeometryManager::cache;
+    std::size_t GeometryManager::gpuMemoryBytes = 0;
 
+    GeometryManager::GeometryEntry GeometryManager::generateSphere(unsigned int longitudeBands, unsigned int latitudeBands) {
+        // Unit sphere, instances scale it by the body's radius
         std::vector<float> vertices;
         std::vector<GLuint> indices;
 
@@ -28,9 +47,9 @@ namespace Utilities {
                 float y = cosTheta;
                 float z = sinPhi * sinTheta;
 
-                vertices.push_back(radius * x);
-                vertices.push_back(radius * y);
-                vertices.push_back(radius * z);
+                vertices.push_back(x);
+                vertices.push_back(y);
+                vertices.push_back(z);
             }
         }
 
@@ -66,53 +85,109 @@ namespace Utilities {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
-        // Setup vertex attributes (e.g., position)
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0); // Position
+        // Vertices hold only a position, color comes from the instance buffer, see SphereRenderer
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0); // Position
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float))); // Color
-        glEnableVertexAttribArray(1);
 
         // Unbind VAO
         glBindVertexArray(0);
 
-        // Store indices count for drawing
-        indicesCount = indices.size();
+        GeometryEntry entry{};
+        entry.data = { VAO, static_cast<GLuint>(indices.size()) };
+        entry.VBO = VBO;
+        entry.EBO = EBO;
+        entry.bufferBytes = vertices.size() * sizeof(float) + indices.size() * sizeof(GLuint);
+        return entry;
+    }
+
+    GeometryManager::GeometryData GeometryManager::acquireSphereGeometry(unsigned int longitudeBands, unsigned int latitudeBands, MeshType type) {
+        if (type != MeshType::UvSphere) {
+            throw std::runtime_error("Not a sphere mesh type.");
+        }
+        return acquire(GeometryKey(type, longitudeBands, latitudeBands));
+    }
 
-        // Return VAO
-        return VAO;
+    std::vector<GeometryManager::SphereLod> GeometryManager::acquireSphereLodChain() {
+        std::vector<SphereLod> chain;
+        for (const SphereLodLevel& level : SPHERE_LOD_LEVELS) {
+            chain.push_back(SphereLod{ acquireSphereGeometry(level.longitudeBands, level.latitudeBands), level.minPixelRadius });
+        }
+        return chain;
     }
 
-    GeometryManager::GeometryData GeometryManager::createSphereGeometry(float radius, unsigned int longitudeBands, unsigned int latitudeBands) {
-        GLuint indicesCount;
-        GLuint sphereVAO = generateSphereVAO(radius, longitudeBands, latitudeBands, indicesCount);
-        // Store VAO and indices count
-        GeometryData geomData = { sphereVAO, indicesCount };
-        geometries[sphereVAO] = geomData; // Adjust how you store this based on your storage strategy
-        return geomData;
+    std::size_t GeometryManager::selectSphereLod(const std::vector<SphereLod>& chain, float pixelRadius) {
+        std::size_t level = 0;
+        while (level + 1 < chain.size() && pixelRadius < chain[level].minPixelRadius) {
+            ++level;
+        }
+        return level;
     }
 
-    // Assuming GeometryData struct and geometries map are defined within GeometryManager
+    GeometryManager::GeometryData GeometryManager::acquire(const GeometryKey& key) {
+        auto cached = cache.find(key);
+        if (cached != cache.end()) {
+            GeometryEntry& entry = geometries.at(cached->second);
+            ++entry.references;
+            return entry.data;
+        }
+
+        GeometryEntry entry = generateSphere(std::get<1>(key), std::get<2>(key));
+        entry.key = key;
+        entry.references = 1;
+        gpuMemoryBytes += entry.bufferBytes;
+        cache.emplace(key, entry.data.VAO);
+        geometries.emplace(entry.data.VAO, entry);
+        return entry.data;
+    }
 
     Utilities::GeometryManager::GeometryData Utilities::GeometryManager::getGeometryData(unsigned int geometryID) {
         auto it = geometries.find(geometryID);
         if (it != geometries.end()) {
-            return it->second;
+            return it->second.data;
         }
         // Handle the case where the geometryID is not found. This could be returning a default GeometryData, or throwing an exception.
         throw std::runtime_error("Geometry ID not found.");
     }
 
-    void GeometryManager::deleteGeometry(GLuint geometryID) {
-        auto it = geometries.find(geometryID);
-        if (it != geometries.end()) {
-            // Delete the VAO, VBO, and EBO associated with this geometry
-            glDeleteVertexArrays(1, &it->second.VAO);
-            // Assuming VBO and EBO IDs are stored or can be retrieved, delete them too
-            // glDeleteBuffers(1, &VBO);
-            // glDeleteBuffers(1, &EBO);
+    void GeometryManager::releaseGeometry(GLuint geometryID) {
+        if (!release(geometryID)) {
+            throw std::runtime_error("Geometry ID not found.");
+        }
+    }
+
+    void GeometryManager::releaseGeometryNoThrow(GLuint geometryID) noexcept {
+        bool released = release(geometryID);
+        assert(released && "Geometry ID not found.");
+        (void)released;
+    }
 
-            geometries.erase(it); // Remove the geometry from the map
+    bool GeometryManager::release(GLuint geometryID) noexcept {
+        auto it = geometries.find(geometryID);
+        if (it == geometries.end()) {
+            return false;
+        }
+        GeometryEntry& entry = it->second;
+        if (--entry.references > 0) {
+            return true;
         }
+
+        // Delete the VAO, VBO, and EBO associated with this geometry
+        glDeleteVertexArrays(1, &entry.data.VAO);
+        glDeleteBuffers(1, &entry.VBO);
+        glDeleteBuffers(1, &entry.EBO);
+
+        gpuMemoryBytes -= entry.bufferBytes;
+        cache.erase(entry.key);
+        geometries.erase(it); // Remove the geometry from the map
+        return true;
+    }
+
+    std::size_t GeometryManager::getGeometryCount() {
+        return geometries.size();
+    }
+
+    std::size_t GeometryManager::getGpuMemoryBytes() {
+        return gpuMemoryBytes;
     }
 
     void GeometryManager::initialize() {
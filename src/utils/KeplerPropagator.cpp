@@ -0,0 +1,402 @@
+
+#include <utils/KeplerPropagator.h>
+#include <utils/UtilitiesNamespace.h>
+#include <cmath>
+#include <stdexcept>
+
+using namespace Utilities;
+
+namespace {
+
+    constexpr double TWO_PI = 2.0 * PI;
+    constexpr double ELEMENT_TOLERANCE = 1e-11;     // Below this an eccentricity or node vector is treated as zero
+    constexpr double SOLVER_TOLERANCE = 1e-15;
+    constexpr int MAX_SOLVER_ITERATIONS = 50;
+
+    // Fixed iteration counts for the batched kernel. Laguerre-Conway reaches machine precision in at most four
+    // iterations for e < 0.99 from the Danby starting guess, Newton needs a few more near parabolic orbits.
+    constexpr int BATCH_LAGUERRE_ITERATIONS = 6;
+    constexpr int BATCH_NEWTON_ITERATIONS = 12;
+
+    inline double wrapAngle(double angle) {
+        return angle - TWO_PI * std::floor(angle / TWO_PI + 0.5);
+    }
+
+    inline double initialEccentricAnomaly(double meanAnomaly, double eccentricity) {
+        return meanAnomaly + std::copysign(0.85 * eccentricity, meanAnomaly);
+    }
+
+    void perifocalBasis(double inclination, double node, double periapsis, Vector& p, Vector& q) {
+        const double cosNode = std::cos(node), sinNode = std::sin(node);
+        const double cosPeri = std::cos(periapsis), sinPeri = std::sin(periapsis);
+        const double cosInc = std::cos(inclination), sinInc = std::sin(inclination);
+
+        p = Vector(cosPeri * cosNode - sinPeri * cosInc * sinNode,
+            cosPeri * sinNode + sinPeri * cosInc * cosNode,
+            sinPeri * sinInc);
+        q = Vector(-sinPeri * cosNode - cosPeri * cosInc * sinNode,
+            -sinPeri * sinNode + cosPeri * cosInc * cosNode,
+            cosPeri * sinInc);
+    }
+}
+
+double KeplerPropagator::solveKeplerEquation(double meanAnomaly, double eccentricity, KeplerSolver solver) {
+    if (eccentricity < 0.0) {
+        throw std::runtime_error("Negative eccentricity passed to Kepler solver.");
+    }
+    if (eccentricity >= 1.0) {
+        return solveHyperbolicKeplerEquation(meanAnomaly, eccentricity, solver);
+    }
+
+    const double m = wrapAngle(meanAnomaly);
+    double e = initialEccentricAnomaly(m, eccentricity);
+
+    for (int iteration = 0; iteration < MAX_SOLVER_ITERATIONS; ++iteration) {
+        const double sinE = std::sin(e);
+        const double cosE = std::cos(e);
+        const double f = e - eccentricity * sinE - m;
+        const double fPrime = 1.0 - eccentricity * cosE;
+
+        double delta;
+        if (solver == KeplerSolver::Laguerre) {
+            const double fSecond = eccentricity * sinE;
+            delta = 5.0 * f / (fPrime + std::sqrt(std::abs(16.0 * fPrime * fPrime - 20.0 * f * fSecond)));
+        }
+        else {
+            delta = f / fPrime;
+        }
+
+        e -= delta;
+        if (std::abs(delta) <= SOLVER_TOLERANCE * (1.0 + std::abs(e))) {
+            break;
+        }
+    }
+
+    // Hand back an anomaly on the same revolution as the caller's mean anomaly
+    return e + (meanAnomaly - m);
+}
+
+double KeplerPropagator::solveHyperbolicKeplerEquation(double meanAnomaly, double eccentricity, KeplerSolver solver) {
+    if (eccentricity == 1.0) {
+        throw std::runtime_error("Parabolic orbits are not supported by the Kepler solver.");
+    }
+
+    double h = std::copysign(std::log(2.0 * std::abs(meanAnomaly) / eccentricity + 1.8), meanAnomaly);
+
+    for (int iteration = 0; iteration < MAX_SOLVER_ITERATIONS; ++iteration) {
+        const double sinhH = std::sinh(h);
+        const double coshH = std::cosh(h);
+        const double f = eccentricity * sinhH - h - meanAnomaly;
+        const double fPrime = eccentricity * coshH - 1.0;
+
+        double delta;
+        if (solver == KeplerSolver::Laguerre) {
+            const double fSecond = eccentricity * sinhH;
+            delta = 5.0 * f / (fPrime + std::copysign(std::sqrt(std::abs(16.0 * fPrime * fPrime - 20.0 * f * fSecond)), fPrime));
+        }
+        else {
+            delta = f / fPrime;
+        }
+
+        h -= delta;
+        if (std::abs(delta) <= SOLVER_TOLERANCE * (1.0 + std::abs(h))) {
+            break;
+        }
+    }
+
+    return h;
+}
+
+void KeplerPropagator::solveKeplerEquationBatch(const double* meanAnomaly, const double* eccentricity, double* eccentricAnomaly, std::size_t count, KeplerSolver solver) {
+    if (solver == KeplerSolver::Laguerre) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const double m = wrapAngle(meanAnomaly[i]);
+            const double ecc = eccentricity[i];
+            double e = initialEccentricAnomaly(m, ecc);
+
+            for (int iteration = 0; iteration < BATCH_LAGUERRE_ITERATIONS; ++iteration) {
+                const double sinE = std::sin(e);
+                const double f = e - ecc * sinE - m;
+                const double fPrime = 1.0 - ecc * std::cos(e);
+                const double fSecond = ecc * sinE;
+                e -= 5.0 * f / (fPrime + std::sqrt(std::abs(16.0 * fPrime * fPrime - 20.0 * f * fSecond)));
+            }
+
+            eccentricAnomaly[i] = e;
+        }
+    }
+    else {
+        for (std::size_t i = 0; i < count; ++i) {
+            const double m = wrapAngle(meanAnomaly[i]);
+            const double ecc = eccentricity[i];
+            double e = initialEccentricAnomaly(m, ecc);
+
+            for (int iteration = 0; iteration < BATCH_NEWTON_ITERATIONS; ++iteration) {
+                e -= (e - ecc * std::sin(e) - m) / (1.0 - ecc * std::cos(e));
+            }
+
+            eccentricAnomaly[i] = e;
+        }
+    }
+}
+
+OrbitalElements KeplerPropagator::cartesianToElements(const Vector& position, const Vector& velocity, double mu) {
+    const double r = position.magnitude();
+    if (r == 0) {
+        throw std::runtime_error("Cannot derive orbital elements for a body at the central mass.");
+    }
+
+    const Vector angularMomentum = position.cross(velocity);
+    const double h = angularMomentum.magnitude();
+    if (h == 0) {
+        throw std::runtime_error("Cannot derive orbital elements for purely radial motion.");
+    }
+    const Vector orbitNormal = angularMomentum / h;
+
+    const double speedSquared = velocity.dot(velocity);
+    const Vector eccentricityVector = (position * (speedSquared - mu / r) - velocity * position.dot(velocity)) / mu;
+    const double e = eccentricityVector.magnitude();
+
+    const double specificEnergy = 0.5 * speedSquared - mu / r;
+    if (std::abs(e - 1.0) < ELEMENT_TOLERANCE || specificEnergy == 0) {
+        throw std::runtime_error("Parabolic orbits are not supported by the Kepler propagator.");
+    }
+
+    OrbitalElements elements;
+    elements.semiMajorAxis = -mu / (2.0 * specificEnergy);
+    elements.eccentricity = e;
+    elements.inclination = std::acos(Utilities::clamp(angularMomentum.getZ() / h, -1.0, 1.0));
+
+    // Equatorial orbits have no line of nodes, so angles are measured from the x axis instead
+    const Vector nodeVector(-angularMomentum.getY(), angularMomentum.getX(), 0.0);
+    const double nodeMagnitude = nodeVector.magnitude();
+    Vector reference(1.0, 0.0, 0.0);
+    if (nodeMagnitude > ELEMENT_TOLERANCE * h) {
+        reference = nodeVector / nodeMagnitude;
+        elements.longitudeOfAscendingNode = std::atan2(angularMomentum.getX(), -angularMomentum.getY());
+    }
+
+    // Circular orbits have no periapsis, the anomaly then becomes the argument of latitude
+    double trueAnomaly;
+    if (e > ELEMENT_TOLERANCE) {
+        elements.argumentOfPeriapsis = std::atan2(orbitNormal.dot(reference.cross(eccentricityVector)), reference.dot(eccentricityVector));
+        trueAnomaly = std::atan2(orbitNormal.dot(eccentricityVector.cross(position)), eccentricityVector.dot(position));
+    }
+    else {
+        trueAnomaly = std::atan2(orbitNormal.dot(reference.cross(position)), reference.dot(position));
+    }
+
+    if (e < 1.0) {
+        const double eccentricAnomaly = std::atan2(std::sqrt(1.0 - e * e) * std::sin(trueAnomaly), e + std::cos(trueAnomaly));
+        elements.meanAnomaly = eccentricAnomaly - e * std::sin(eccentricAnomaly);
+    }
+    else {
+        const double sinhH = std::sqrt(e * e - 1.0) * std::sin(trueAnomaly) / (1.0 + e * std::cos(trueAnomaly));
+        const double hyperbolicAnomaly = std::asinh(sinhH);
+        elements.meanAnomaly = e * sinhH - hyperbolicAnomaly;
+    }
+
+    return elements;
+}
+
+void KeplerPropagator::elementsToCartesian(const OrbitalElements& elements, double mu, Vector& position, Vector& velocity, KeplerSolver solver) {
+    Vector p, q;
+    perifocalBasis(elements.inclination, elements.longitudeOfAscendingNode, elements.argumentOfPeriapsis, p, q);
+
+    const double e = elements.eccentricity;
+    const double a = std::abs(elements.semiMajorAxis);
+    const double anomaly = solveKeplerEquation(elements.meanAnomaly, e, solver);
+
+    double x, y, vx, vy;
+    if (e < 1.0) {
+        const double b = std::sqrt(1.0 - e * e);
+        const double cosE = std::cos(anomaly), sinE = std::sin(anomaly);
+        const double r = a * (1.0 - e * cosE);
+        const double speedFactor = std::sqrt(mu * a) / r;
+        x = a * (cosE - e);
+        y = a * b * sinE;
+        vx = -speedFactor * sinE;
+        vy = speedFactor * b * cosE;
+    }
+    else {
+        const double b = std::sqrt(e * e - 1.0);
+        const double coshH = std::cosh(anomaly), sinhH = std::sinh(anomaly);
+        const double r = a * (e * coshH - 1.0);
+        const double speedFactor = std::sqrt(mu * a) / r;
+        x = a * (e - coshH);
+        y = a * b * sinhH;
+        vx = -speedFactor * sinhH;
+        vy = speedFactor * b * coshH;
+    }
+
+    position = p * x + q * y;
+    velocity = p * vx + q * vy;
+}
+
+void KeplerPropagator::propagateState(Vector& position, Vector& velocity, double mu, double dt, KeplerSolver solver) {
+    OrbitalElements elements = cartesianToElements(position, velocity, mu);
+    const double a = std::abs(elements.semiMajorAxis);
+    elements.meanAnomaly += std::sqrt(mu / (a * a * a)) * dt;
+    elementsToCartesian(elements, mu, position, velocity, solver);
+}
+
+std::size_t KeplerOrbitBatch::addOrbit(const OrbitalElements& elements) {
+    if (elements.eccentricity < 0.0 || elements.eccentricity == 1.0 || elements.semiMajorAxis == 0.0) {
+        throw std::runtime_error("Invalid orbital elements added to Kepler batch.");
+    }
+
+    const std::size_t index = size();
+    const double e = elements.eccentricity;
+    const double a = std::abs(elements.semiMajorAxis);
+
+    Vector p, q;
+    perifocalBasis(elements.inclination, elements.longitudeOfAscendingNode, elements.argumentOfPeriapsis, p, q);
+
+    semiMajorAxis.push_back(e < 1.0 ? a : -a);
+    eccentricity.push_back(e);
+    meanAnomaly.push_back(elements.meanAnomaly);
+    meanMotion.push_back(std::sqrt(mu / (a * a * a)));
+    semiMinorFactor.push_back(std::sqrt(std::abs(1.0 - e * e)));
+    inclination.push_back(elements.inclination);
+    longitudeOfAscendingNode.push_back(elements.longitudeOfAscendingNode);
+    argumentOfPeriapsis.push_back(elements.argumentOfPeriapsis);
+
+    periapsisX.push_back(p.getX());
+    periapsisY.push_back(p.getY());
+    periapsisZ.push_back(p.getZ());
+    perpendicularX.push_back(q.getX());
+    perpendicularY.push_back(q.getY());
+    perpendicularZ.push_back(q.getZ());
+
+    if (e > 1.0) {
+        hyperbolicIndices.push_back(index);
+    }
+
+    eccentricAnomaly.push_back(0.0);
+    positionX.push_back(0.0);
+    positionY.push_back(0.0);
+    positionZ.push_back(0.0);
+    velocityX.push_back(0.0);
+    velocityY.push_back(0.0);
+    velocityZ.push_back(0.0);
+
+    Vector position, velocity;
+    KeplerPropagator::elementsToCartesian(elements, mu, position, velocity);
+    positionX[index] = position.getX();
+    positionY[index] = position.getY();
+    positionZ[index] = position.getZ();
+    velocityX[index] = velocity.getX();
+    velocityY[index] = velocity.getY();
+    velocityZ[index] = velocity.getZ();
+
+    return index;
+}
+
+std::size_t KeplerOrbitBatch::addState(const Vector& position, const Vector& velocity) {
+    return addOrbit(KeplerPropagator::cartesianToElements(position, velocity, mu));
+}
+
+void KeplerOrbitBatch::reserve(std::size_t count) {
+    for (auto* column : { &semiMajorAxis, &eccentricity, &meanAnomaly, &meanMotion, &semiMinorFactor,
+        &inclination, &longitudeOfAscendingNode, &argumentOfPeriapsis,
+        &periapsisX, &periapsisY, &periapsisZ, &perpendicularX, &perpendicularY, &perpendicularZ,
+        &eccentricAnomaly, &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ }) {
+        column->reserve(count);
+    }
+}
+
+void KeplerOrbitBatch::clear() {
+    for (auto* column : { &semiMajorAxis, &eccentricity, &meanAnomaly, &meanMotion, &semiMinorFactor,
+        &inclination, &longitudeOfAscendingNode, &argumentOfPeriapsis,
+        &periapsisX, &periapsisY, &periapsisZ, &perpendicularX, &perpendicularY, &perpendicularZ,
+        &eccentricAnomaly, &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ }) {
+        column->clear();
+    }
+    hyperbolicIndices.clear();
+}
+
+void KeplerOrbitBatch::propagate(double dt, KeplerSolver solver) {
+    const std::size_t count = size();
+    double* m = meanAnomaly.data();
+    const double* n = meanMotion.data();
+    const double* e = eccentricity.data();
+
+    // Elliptic mean anomalies are kept wrapped so they never lose precision over long runs
+    for (std::size_t i = 0; i < count; ++i) {
+        const double advanced = m[i] + n[i] * dt;
+        m[i] = e[i] < 1.0 ? wrapAngle(advanced) : advanced;
+    }
+
+    KeplerPropagator::solveKeplerEquationBatch(m, e, eccentricAnomaly.data(), count, solver);
+
+    for (std::size_t index : hyperbolicIndices) {
+        eccentricAnomaly[index] = KeplerPropagator::solveKeplerEquation(m[index], e[index], solver);
+    }
+
+    updateCartesianState();
+}
+
+void KeplerOrbitBatch::updateCartesianState() {
+    const std::size_t count = size();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const double a = semiMajorAxis[i];
+        const double ecc = eccentricity[i];
+        const double b = semiMinorFactor[i];
+        const double cosE = std::cos(eccentricAnomaly[i]);
+        const double sinE = std::sin(eccentricAnomaly[i]);
+        const double r = a * (1.0 - ecc * cosE);
+        const double speedFactor = meanMotion[i] * a * a / r;     // n a^2 == sqrt(mu a)
+
+        const double x = a * (cosE - ecc);
+        const double y = a * b * sinE;
+        const double vx = -speedFactor * sinE;
+        const double vy = speedFactor * b * cosE;
+
+        positionX[i] = x * periapsisX[i] + y * perpendicularX[i];
+        positionY[i] = x * periapsisY[i] + y * perpendicularY[i];
+        positionZ[i] = x * periapsisZ[i] + y * perpendicularZ[i];
+        velocityX[i] = vx * periapsisX[i] + vy * perpendicularX[i];
+        velocityY[i] = vx * periapsisY[i] + vy * perpendicularY[i];
+        velocityZ[i] = vx * periapsisZ[i] + vy * perpendicularZ[i];
+    }
+
+    // Hyperbolic entries were filled with meaningless values by the elliptic kernel above
+    for (std::size_t i : hyperbolicIndices) {
+        const double a = -semiMajorAxis[i];
+        const double ecc = eccentricity[i];
+        const double b = semiMinorFactor[i];
+        const double coshH = std::cosh(eccentricAnomaly[i]);
+        const double sinhH = std::sinh(eccentricAnomaly[i]);
+        const double r = a * (ecc * coshH - 1.0);
+        const double speedFactor = meanMotion[i] * a * a / r;
+
+        const double x = a * (ecc - coshH);
+        const double y = a * b * sinhH;
+        const double vx = -speedFactor * sinhH;
+        const double vy = speedFactor * b * coshH;
+
+        positionX[i] = x * periapsisX[i] + y * perpendicularX[i];
+        positionY[i] = x * periapsisY[i] + y * perpendicularY[i];
+        positionZ[i] = x * periapsisZ[i] + y * perpendicularZ[i];
+        velocityX[i] = vx * periapsisX[i] + vy * perpendicularX[i];
+        velocityY[i] = vx * periapsisY[i] + vy * perpendicularY[i];
+        velocityZ[i] = vx * periapsisZ[i] + vy * perpendicularZ[i];
+    }
+}
+
+void KeplerOrbitBatch::getState(std::size_t index, Vector& position, Vector& velocity) const {
+    position = Vector(positionX.at(index), positionY.at(index), positionZ.at(index));
+    velocity = Vector(velocityX.at(index), velocityY.at(index), velocityZ.at(index));
+}
+
+OrbitalElements KeplerOrbitBatch::getElements(std::size_t index) const {
+    OrbitalElements elements;
+    elements.semiMajorAxis = semiMajorAxis.at(index);
+    elements.eccentricity = eccentricity[index];
+    elements.inclination = inclination[index];
+    elements.longitudeOfAscendingNode = longitudeOfAscendingNode[index];
+    elements.argumentOfPeriapsis = argumentOfPeriapsis[index];
+    elements.meanAnomaly = meanAnomaly[index];
+    return elements;
+}
@@ -0,0 +1,146 @@
+
+#include <utils/MappedFile.h>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Utilities;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not read the size of file: " + path);
+    }
+
+    fileHandle = file;
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+    opened = true;
+
+    // Empty files cannot be mapped, they simply have no view
+    if (length == 0) {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        close();
+        throw std::runtime_error("Could not map file: " + path);
+    }
+
+    view = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (view == nullptr) {
+        close();
+        throw std::runtime_error("Could not map file: " + path);
+    }
+}
+
+void MappedFile::close() {
+    if (view != nullptr) {
+        UnmapViewOfFile(view);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    view = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : view(std::exchange(other.view, nullptr)), length(std::exchange(other.length, 0)), opened(std::exchange(other.opened, false)),
+      fileHandle(std::exchange(other.fileHandle, nullptr)), mappingHandle(std::exchange(other.mappingHandle, nullptr)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        view = std::exchange(other.view, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    struct stat status;
+    if (::fstat(descriptor, &status) != 0) {
+        ::close(descriptor);
+        throw std::runtime_error("Could not read the size of file: " + path);
+    }
+
+    length = static_cast<std::size_t>(status.st_size);
+    opened = true;
+
+    if (length > 0) {
+        void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(descriptor);
+            length = 0;
+            opened = false;
+            throw std::runtime_error("Could not map file: " + path);
+        }
+        view = static_cast<const unsigned char*>(mapping);
+    }
+
+    // The mapping keeps the file alive on its own
+    ::close(descriptor);
+}
+
+void MappedFile::close() {
+    if (view != nullptr) {
+        ::munmap(const_cast<unsigned char*>(view), length);
+    }
+    view = nullptr;
+    length = 0;
+    opened = false;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : view(std::exchange(other.view, nullptr)), length(std::exchange(other.length, 0)), opened(std::exchange(other.opened, false)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        view = std::exchange(other.view, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
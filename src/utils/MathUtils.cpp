@@ -1,8 +1,25 @@
 #include "utils/MathUtils.h"
 #include "celestial/CelestialBody.h" 
+#include "utils/Vec3.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace Utilities;
 
+namespace {
+
+    // Padding bodies sit this far out with no mass, so the loads past the last body add nothing
+    constexpr double PADDING_DISTANCE = 1e30;
+
+    // Per thread, the Parareal workers evaluate accelerations concurrently
+    struct AccelerationScratch {
+        std::vector<double> x, y, z, mu;
+        std::vector<double> ax, ay, az;
+    };
+
+    thread_local AccelerationScratch accelerationScratch;
+}
+
 
 Vector MathUtils::calculateGravitationalForceBetweenMasses(const SolarSystem::CelestialBody& bodyOne, const SolarSystem::CelestialBody& bodyTwo) {
     const Vector& positionOne = bodyOne.getCurrentPosition();
@@ -23,6 +40,80 @@ Vector MathUtils::calculateGravitationalForceBetweenMasses(const SolarSystem::Ce
     return forceVector;
 }
 
+Vector MathUtils::calculateGravitationalCoupling(const Vector& positionOne, const Vector& positionTwo) {
+    Vector direction = positionTwo - positionOne;
+
+    double distanceSquared = direction.dot(direction);
+
+    if (distanceSquared == 0) {
+        throw std::runtime_error("Attempt to calculate gravitational force between overlapping celestial bodies.");
+    }
+
+    double inverseDistanceCubed = 1.0 / (distanceSquared * std::sqrt(distanceSquared));
+
+    return direction * inverseDistanceCubed;
+}
+
+void MathUtils::calculateAccelerations(const std::vector<Vector>& positions, const std::vector<double>& gravitationalParameters, std::vector<Vector>& accelerations) {
+    constexpr std::size_t width = Vec3x4::width();
+    using Batch = Lanes<double, width>;
+    const std::size_t bodyCount = positions.size();
+    const std::size_t paddedCount = bodyCount + width;
+
+    // Structure of arrays with a batch of padding at the end, so every load in the pair loop is a full one
+    AccelerationScratch& scratch = accelerationScratch;
+    for (std::vector<double>* column : { &scratch.x, &scratch.y, &scratch.z, &scratch.mu }) {
+        column->resize(paddedCount);
+    }
+    for (std::vector<double>* column : { &scratch.ax, &scratch.ay, &scratch.az }) {
+        column->assign(paddedCount, 0.0);
+    }
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        scratch.x[i] = positions[i].getX();
+        scratch.y[i] = positions[i].getY();
+        scratch.z[i] = positions[i].getZ();
+        scratch.mu[i] = gravitationalParameters[i];
+    }
+    for (std::size_t i = bodyCount; i < paddedCount; ++i) {
+        scratch.x[i] = scratch.y[i] = scratch.z[i] = PADDING_DISTANCE;
+        scratch.mu[i] = 0.0;
+    }
+
+    // Each pair is evaluated once and acts on both bodies, body i sums over the bodies after it four at a time and
+    // pushes the reactions into their rows. Overlaps only show up in the smallest distance, checked after the loop.
+    Batch smallestDistanceSquared(HUGE_VAL);
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        const Batch selfX(scratch.x[i]), selfY(scratch.y[i]), selfZ(scratch.z[i]), selfMu(scratch.mu[i]);
+        Vec3x4 sum;
+
+        for (std::size_t j = i + 1; j < bodyCount; j += width) {
+            const Vec3x4 direction(loadLanes<width>(&scratch.x[j]) - selfX, loadLanes<width>(&scratch.y[j]) - selfY, loadLanes<width>(&scratch.z[j]) - selfZ);
+            const Batch distanceSquared = lengthSquared(direction);
+            smallestDistanceSquared = min(smallestDistanceSquared, distanceSquared);
+
+            const Batch inverseDistanceCubed = Batch(1.0) / (distanceSquared * Utilities::sqrt(distanceSquared));
+            sum += direction * (loadLanes<width>(&scratch.mu[j]) * inverseDistanceCubed);
+
+            const Vec3x4 reaction = direction * (selfMu * inverseDistanceCubed);
+            storeLanes(&scratch.ax[j], loadLanes<width>(&scratch.ax[j]) - reaction.x);
+            storeLanes(&scratch.ay[j], loadLanes<width>(&scratch.ay[j]) - reaction.y);
+            storeLanes(&scratch.az[j], loadLanes<width>(&scratch.az[j]) - reaction.z);
+        }
+
+        scratch.ax[i] += horizontalSum(sum.x);
+        scratch.ay[i] += horizontalSum(sum.y);
+        scratch.az[i] += horizontalSum(sum.z);
+    }
+
+    if (horizontalMin(smallestDistanceSquared) == 0) {
+        throw std::runtime_error("Attempt to calculate gravitational force between overlapping celestial bodies.");
+    }
+
+    accelerations.resize(bodyCount);
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        accelerations[i] = Vector(scratch.ax[i], scratch.ay[i], scratch.az[i]);
+    }
+}
 
 // 5,890,329,911 == 100 // Mercury and Pluto
 // 37,236,121,041,383 == 90 // earth and titan
@@ -0,0 +1,109 @@
+
+#include <utils/MemoryArena.h>
+#include <algorithm>
+#include <cstdint>
+
+using namespace Utilities;
+
+MonotonicArena::~MonotonicArena() {
+    releaseBlocks();
+}
+
+void MonotonicArena::releaseBlocks() {
+    for (const Block& block : blocks) {
+        ::operator delete(block.data);
+    }
+    blocks.clear();
+    currentBlock = 0;
+    offset = 0;
+    capacity = 0;
+}
+
+void MonotonicArena::addBlock(std::size_t minimumSize) {
+    const std::size_t size = std::max(blockSize, minimumSize);
+    blocks.push_back(Block{ static_cast<char*>(::operator new(size)), size });
+    capacity += size;
+}
+
+void* MonotonicArena::allocate(std::size_t bytes, std::size_t alignment) {
+    // Walk forward through blocks kept from earlier cycles before adding a new one
+    while (currentBlock < blocks.size()) {
+        const Block& block = blocks[currentBlock];
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block.data) + offset;
+        const std::size_t padding = (alignment - address % alignment) % alignment;
+
+        if (offset + padding + bytes <= block.size) {
+            void* memory = block.data + offset + padding;
+            offset += padding + bytes;
+            bytesUsed += padding + bytes;
+            return memory;
+        }
+
+        ++currentBlock;
+        offset = 0;
+    }
+
+    addBlock(bytes + alignment);
+    return allocate(bytes, alignment);
+}
+
+void MonotonicArena::reset() {
+    if (blocks.size() > 1) {
+        const std::size_t combined = capacity;
+        releaseBlocks();
+        addBlock(combined);
+    }
+    currentBlock = 0;
+    offset = 0;
+    bytesUsed = 0;
+}
+
+void MonotonicArena::reserve(std::size_t bytes) {
+    std::size_t available = 0;
+    if (currentBlock < blocks.size()) {
+        available = blocks[currentBlock].size - offset;
+        for (std::size_t block = currentBlock + 1; block < blocks.size(); ++block) {
+            available = std::max(available, blocks[block].size);
+        }
+    }
+    if (available < bytes) {
+        addBlock(bytes + alignof(std::max_align_t));
+    }
+}
+
+std::size_t MemoryPool::roundUp(std::size_t bytes) {
+    const std::size_t granule = alignof(std::max_align_t);
+    return std::max((bytes + granule - 1) / granule * granule, sizeof(FreeNode));
+}
+
+MemoryPool::SizeClass& MemoryPool::sizeClassFor(std::size_t roundedBytes) {
+    for (SizeClass& sizeClass : sizeClasses) {
+        if (sizeClass.size == roundedBytes) {
+            return sizeClass;
+        }
+    }
+    sizeClasses.push_back(SizeClass{ roundedBytes, nullptr });
+    return sizeClasses.back();
+}
+
+void* MemoryPool::allocate(std::size_t bytes) {
+    const std::size_t rounded = roundUp(bytes);
+    SizeClass& sizeClass = sizeClassFor(rounded);
+
+    if (sizeClass.head != nullptr) {
+        FreeNode* node = sizeClass.head;
+        sizeClass.head = node->next;
+        return node;
+    }
+    return arena.allocate(rounded, alignof(std::max_align_t));
+}
+
+void MemoryPool::deallocate(void* memory, std::size_t bytes) {
+    if (memory == nullptr) {
+        return;
+    }
+    SizeClass& sizeClass = sizeClassFor(roundUp(bytes));
+    FreeNode* node = static_cast<FreeNode*>(memory);
+    node->next = sizeClass.head;
+    sizeClass.head = node;
+}
@@ -0,0 +1,478 @@
+
+#include <utils/OrbitalCatalogImporter.h>
+#include <utils/MappedFile.h>
+#include <utils/ThreadPool.h>
+#include <utils/BinaryCatalog.h>
+#include <utils/KeplerPropagator.h>
+#include <utils/UtilitiesNamespace.h>
+#include <celestial/SolarSystemModel.h>
+#include <celestial/Asteroid.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <iterator>
+#include <thread>
+
+using namespace Utilities;
+
+namespace {
+
+    constexpr double DEGREES_TO_RADIANS = PI / 180.0;
+    constexpr double MODIFIED_JULIAN_DATE_OFFSET = 2400000.5;
+
+    // Only the first part of the file is searched for the end of a header, MPCORB's is about forty lines
+    constexpr std::size_t HEADER_SEARCH_LIMIT = 1 << 20;
+
+    // Chunks smaller than this are not worth a task of their own
+    constexpr std::size_t MINIMUM_CHUNK_BYTES = 1 << 20;
+
+    // Half-open byte range of a column within a line, empty when the catalog does not have the column
+    struct Field {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+
+        inline bool isPresent() const {
+            return end > begin;
+        }
+    };
+
+    struct ColumnLayout {
+        Field designation;
+        Field name;
+        Field epoch;
+        Field meanAnomaly;
+        Field argumentOfPeriapsis;
+        Field longitudeOfAscendingNode;
+        Field inclination;
+        Field eccentricity;
+        Field semiMajorAxis;
+        Field perihelionDistance;               // Comet dumps give q and Tp in place of a and M
+        Field timeOfPerihelion;
+        Field absoluteMagnitude;
+        bool packedEpoch = false;               // MPC packed date, otherwise a modified Julian date
+        std::size_t minimumLength = 0;          // Shorter lines hold no elements
+    };
+
+    // Columns are given 1-based and inclusive as in the MPC documentation
+    inline Field columns(std::size_t first, std::size_t last) {
+        return Field{ first - 1, last };
+    }
+
+    ColumnLayout mpcorbLayout() {
+        ColumnLayout layout;
+        layout.designation = columns(1, 7);
+        layout.absoluteMagnitude = columns(9, 13);
+        layout.epoch = columns(21, 25);
+        layout.meanAnomaly = columns(27, 35);
+        layout.argumentOfPeriapsis = columns(38, 46);
+        layout.longitudeOfAscendingNode = columns(49, 57);
+        layout.inclination = columns(60, 68);
+        layout.eccentricity = columns(71, 79);
+        layout.semiMajorAxis = columns(93, 103);
+        layout.name = columns(167, 194);
+        layout.packedEpoch = true;
+        layout.minimumLength = 103;
+        return layout;
+    }
+
+    // Julian date at 0h of a Gregorian calendar date
+    double julianDateAtMidnight(int year, int month, int day) {
+        const int a = (14 - month) / 12;
+        const int y = year + 4800 - a;
+        const int m = month + 12 * a - 3;
+        const long dayNumber = day + (153 * m + 2) / 5 + 365L * y + y / 4 - y / 100 + y / 400 - 32045;
+        return static_cast<double>(dayNumber) - 0.5;
+    }
+
+    inline std::string_view trim(std::string_view text) {
+        const std::size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) {
+            return std::string_view();
+        }
+        const std::size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+
+    inline std::string_view fieldText(std::string_view line, const Field& field) {
+        if (!field.isPresent() || field.begin >= line.size()) {
+            return std::string_view();
+        }
+        return trim(line.substr(field.begin, std::min(field.end, line.size()) - field.begin));
+    }
+
+    inline bool isSeparatorLine(std::string_view line) {
+        line = trim(line);
+        return line.size() >= 3 && line.front() == '-' && line.find_first_not_of("- ") == std::string_view::npos;
+    }
+
+    // Error reporting needs the line number, which is only counted when something actually fails
+    [[noreturn]] void throwMalformed(const char* what, const char* fileStart, const char* lineStart, const std::string& path) {
+        const std::size_t lineNumber = static_cast<std::size_t>(std::count(fileStart, lineStart, '\n')) + 1;
+        throw std::runtime_error(std::string("Malformed ") + what + " on line " + std::to_string(lineNumber) + " of " + path);
+    }
+
+    struct LineContext {
+        const ColumnLayout& layout;
+        const OrbitalImportSettings& settings;
+        const std::string& path;
+        const char* fileStart;
+    };
+
+    double parseField(std::string_view text, const char* what, const LineContext& context, const char* lineStart) {
+        char buffer[64];
+        if (text.empty() || text.size() >= sizeof(buffer)) {
+            throwMalformed(what, context.fileStart, lineStart, context.path);
+        }
+        std::memcpy(buffer, text.data(), text.size());
+        buffer[text.size()] = '\0';
+
+        char* end = nullptr;
+        const double value = std::strtod(buffer, &end);
+        if (end != buffer + text.size() || !std::isfinite(value)) {
+            throwMalformed(what, context.fileStart, lineStart, context.path);
+        }
+        return value;
+    }
+
+    // JPL writes the time of perihelion as a calendar date with a fractional day, YYYYMMDD.DDDDD
+    double parsePerihelionTime(std::string_view text, const LineContext& context, const char* lineStart) {
+        const double value = parseField(text, "time of perihelion", context, lineStart);
+        const double date = std::floor(value);
+        const long packed = static_cast<long>(date);
+        const int year = static_cast<int>(packed / 10000);
+        const int month = static_cast<int>(packed / 100 % 100);
+        const int day = static_cast<int>(packed % 100);
+        if (month < 1 || month > 12 || day < 1 || day > 31) {
+            throwMalformed("time of perihelion", context.fileStart, lineStart, context.path);
+        }
+        return julianDateAtMidnight(year, month, day) + (value - date);
+    }
+
+    // Returns false for lines that carry no orbit the importer can represent
+    bool parseLine(std::string_view line, const LineContext& context, CelestialBodyRecord& record) {
+        const ColumnLayout& layout = context.layout;
+        const OrbitalImportSettings& settings = context.settings;
+        const char* lineStart = line.data();
+
+        if (line.size() < layout.minimumLength || trim(line).empty()) {
+            return false;
+        }
+
+        const std::string_view epochText = fieldText(line, layout.epoch);
+        double epoch;
+        if (layout.packedEpoch) {
+            try {
+                epoch = OrbitalCatalogImporter::UnpackEpoch(epochText);
+            }
+            catch (const std::runtime_error&) {
+                throwMalformed("epoch", context.fileStart, lineStart, context.path);
+            }
+        }
+        else {
+            epoch = parseField(epochText, "epoch", context, lineStart) + MODIFIED_JULIAN_DATE_OFFSET;
+        }
+
+        OrbitalElements elements;
+        elements.eccentricity = parseField(fieldText(line, layout.eccentricity), "eccentricity", context, lineStart);
+        double semiMajorAxis;
+        if (layout.semiMajorAxis.isPresent()) {
+            semiMajorAxis = parseField(fieldText(line, layout.semiMajorAxis), "semi-major axis", context, lineStart);
+        }
+        else {
+            const double perihelionDistance = parseField(fieldText(line, layout.perihelionDistance), "perihelion distance", context, lineStart);
+            semiMajorAxis = elements.eccentricity < 1.0 ? perihelionDistance / (1.0 - elements.eccentricity) : 0.0;
+        }
+
+        // Parabolic and hyperbolic comets have no closed orbit for KeplerPropagator and are skipped
+        if (elements.eccentricity < 0.0 || elements.eccentricity >= 1.0 || semiMajorAxis <= 0.0) {
+            return false;
+        }
+
+        elements.semiMajorAxis = semiMajorAxis * KILOMETERS_PER_ASTRONOMICAL_UNIT;
+        elements.inclination = parseField(fieldText(line, layout.inclination), "inclination", context, lineStart) * DEGREES_TO_RADIANS;
+        elements.longitudeOfAscendingNode = parseField(fieldText(line, layout.longitudeOfAscendingNode), "ascending node", context, lineStart) * DEGREES_TO_RADIANS;
+        elements.argumentOfPeriapsis = parseField(fieldText(line, layout.argumentOfPeriapsis), "argument of perihelion", context, lineStart) * DEGREES_TO_RADIANS;
+
+        const double mu = settings.centralGravitationalParameter;
+        const double meanMotion = std::sqrt(mu / (elements.semiMajorAxis * elements.semiMajorAxis * elements.semiMajorAxis));
+        const double stateEpoch = settings.targetEpoch != 0.0 ? settings.targetEpoch : epoch;
+        if (layout.meanAnomaly.isPresent()) {
+            elements.meanAnomaly = parseField(fieldText(line, layout.meanAnomaly), "mean anomaly", context, lineStart) * DEGREES_TO_RADIANS
+                + meanMotion * (stateEpoch - epoch) * SECONDS_PER_DAY;
+        }
+        else {
+            const double perihelionTime = parsePerihelionTime(fieldText(line, layout.timeOfPerihelion), context, lineStart);
+            elements.meanAnomaly = meanMotion * (stateEpoch - perihelionTime) * SECONDS_PER_DAY;
+        }
+
+        Vector position, velocity;
+        KeplerPropagator::elementsToCartesian(elements, mu, position, velocity);
+
+        record.type = "Asteroid";
+        record.position = position + settings.centralPosition;
+        record.velocity = velocity + settings.centralVelocity;
+        record.angularVelocity = 0.0;
+
+        std::string_view name = fieldText(line, layout.name);
+        if (name.empty()) {
+            name = fieldText(line, layout.designation);
+        }
+        if (name.empty()) {
+            throwMalformed("designation", context.fileStart, lineStart, context.path);
+        }
+        record.name.assign(name.data(), name.size());
+
+        // Objects without an absolute magnitude are imported as massless test particles
+        const std::string_view magnitudeText = fieldText(line, layout.absoluteMagnitude);
+        if (magnitudeText.empty()) {
+            record.radius = 0.0;
+            record.mass = 0.0;
+        }
+        else {
+            const double absoluteMagnitude = parseField(magnitudeText, "absolute magnitude", context, lineStart);
+            const double diameter = 1329.0 / std::sqrt(settings.albedo) * std::pow(10.0, -absoluteMagnitude / 5.0);
+            const double radiusMeters = 500.0 * diameter;
+            record.radius = 0.5 * diameter;
+            record.mass = settings.density * 4.0 / 3.0 * PI * radiusMeters * radiusMeters * radiusMeters;
+        }
+        return true;
+    }
+
+    // Next line of [cursor, end), without its terminator
+    inline std::string_view nextLine(const char*& cursor, const char* end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        std::string_view line(cursor, static_cast<std::size_t>(lineEnd - cursor));
+        cursor = lineEnd < end ? lineEnd + 1 : end;
+        return line;
+    }
+
+    // Finds the dashed line that ends a header and returns the offset just past it, or 0 when there is none
+    std::size_t findDataStart(const char* data, std::size_t size, std::string_view* headerLine, std::string_view* separatorLine) {
+        const char* end = data + std::min(size, HEADER_SEARCH_LIMIT);
+        const char* cursor = data;
+        std::string_view previous;
+        while (cursor < end) {
+            std::string_view line = nextLine(cursor, end);
+            if (isSeparatorLine(line)) {
+                if (headerLine != nullptr) *headerLine = previous;
+                if (separatorLine != nullptr) *separatorLine = line;
+                return static_cast<std::size_t>(cursor - data);
+            }
+            previous = line;
+        }
+        return 0;
+    }
+
+    // Titles are not always inside their column's dashes, so the header word overlapping the column is taken whole
+    std::string_view columnTitle(std::string_view header, const Field& field) {
+        std::size_t begin = std::min(field.begin, header.size());
+        std::size_t end = std::min(field.end, header.size());
+        while (begin < end && header[begin] == ' ') ++begin;
+        while (end > begin && header[end - 1] == ' ') --end;
+        if (begin == end) {
+            return std::string_view();
+        }
+        while (begin > 0 && header[begin - 1] != ' ') --begin;
+        while (end < header.size() && header[end] != ' ') ++end;
+        return trim(header.substr(begin, end - begin));
+    }
+
+    // Every run of dashes in the separator is one column, titled by the header text above it
+    ColumnLayout jplLayout(std::string_view header, std::string_view separator, const std::string& path) {
+        ColumnLayout layout;
+        Field number;
+        Field designation;
+
+        std::size_t position = 0;
+        while (position < separator.size()) {
+            const std::size_t begin = separator.find('-', position);
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            std::size_t end = separator.find_first_not_of('-', begin);
+            if (end == std::string_view::npos) {
+                end = separator.size();
+            }
+            position = end;
+
+            const Field field{ begin, end };
+            const std::string_view title = columnTitle(header, field);
+            // Comet dumps put the number and name under one run titled "Num  Name", the unnumbered asteroid dump
+            // titles its first column "Designation (and name)"
+            if (title == "Num") number = field;
+            else if (title == "Name" || (title.substr(0, 3) == "Num" && title.find("Name") != std::string_view::npos)) layout.name = field;
+            else if (title.substr(0, 11) == "Designation") designation = field;
+            else if (title == "Epoch") layout.epoch = field;
+            else if (title == "a") layout.semiMajorAxis = field;
+            else if (title == "q") layout.perihelionDistance = field;
+            else if (title == "Tp") layout.timeOfPerihelion = field;
+            else if (title == "e") layout.eccentricity = field;
+            else if (title == "i") layout.inclination = field;
+            else if (title == "w") layout.argumentOfPeriapsis = field;
+            else if (title == "Node") layout.longitudeOfAscendingNode = field;
+            else if (title == "M") layout.meanAnomaly = field;
+            else if (title == "H") layout.absoluteMagnitude = field;
+        }
+
+        // Asteroid dumps place the orbit with a and M, comet dumps with q and Tp
+        const bool cometElements = !layout.semiMajorAxis.isPresent() && layout.perihelionDistance.isPresent();
+        const std::pair<const char*, Field> required[] = {
+            { "Epoch", layout.epoch }, { "e", layout.eccentricity }, { "i", layout.inclination }, { "w", layout.argumentOfPeriapsis },
+            { "Node", layout.longitudeOfAscendingNode },
+            { cometElements ? "q" : "a", cometElements ? layout.perihelionDistance : layout.semiMajorAxis },
+            { cometElements ? "Tp" : "M", cometElements ? layout.timeOfPerihelion : layout.meanAnomaly }
+        };
+        for (const auto& column : required) {
+            if (!column.second.isPresent()) {
+                throw std::runtime_error(std::string("JPL catalog is missing the ") + column.first + " column: " + path);
+            }
+        }
+        if (cometElements) {
+            layout.meanAnomaly = Field();
+        }
+
+        // Numbered dumps title objects by name, unnumbered ones by provisional designation
+        layout.designation = designation.isPresent() ? designation : number;
+        layout.packedEpoch = false;
+        for (const auto& column : required) {
+            layout.minimumLength = std::max(layout.minimumLength, column.second.end);
+        }
+        return layout;
+    }
+
+    std::vector<CelestialBodyRecord> parseChunk(const char* begin, const char* end, const LineContext& context) {
+        std::vector<CelestialBodyRecord> records;
+        // Element lines are a little over 200 bytes in MPCORB and about 120 in the JPL dumps
+        records.reserve(static_cast<std::size_t>(end - begin) / 120 + 1);
+
+        CelestialBodyRecord record;
+        const char* cursor = begin;
+        while (cursor < end) {
+            if (parseLine(nextLine(cursor, end), context, record)) {
+                records.push_back(record);
+            }
+        }
+        return records;
+    }
+}
+
+double OrbitalCatalogImporter::UnpackEpoch(std::string_view packed) {
+    auto packedDigit = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'V') return c - 'A' + 10;
+        return -1;
+    };
+
+    if (packed.size() != 5 || packed[0] < 'I' || packed[0] > 'L'
+        || packed[1] < '0' || packed[1] > '9' || packed[2] < '0' || packed[2] > '9') {
+        throw std::runtime_error("Invalid packed epoch: " + std::string(packed));
+    }
+
+    const int year = (packed[0] - 'I' + 18) * 100 + (packed[1] - '0') * 10 + (packed[2] - '0');
+    const int month = packedDigit(packed[3]);
+    const int day = packedDigit(packed[4]);
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        throw std::runtime_error("Invalid packed epoch: " + std::string(packed));
+    }
+
+    return julianDateAtMidnight(year, month, day);
+}
+
+std::vector<CelestialBodyRecord> OrbitalCatalogImporter::Import(const std::string& path, OrbitalCatalogFormat format, const OrbitalImportSettings& settings) {
+    MappedFile file(path);
+    const char* data = reinterpret_cast<const char*>(file.data());
+    const std::size_t size = file.size();
+    if (size == 0) {
+        return {};
+    }
+
+    ColumnLayout layout;
+    std::size_t dataStart;
+    if (format == OrbitalCatalogFormat::MPCORB) {
+        layout = mpcorbLayout();
+        dataStart = findDataStart(data, size, nullptr, nullptr);
+    }
+    else {
+        std::string_view header, separator;
+        dataStart = findDataStart(data, size, &header, &separator);
+        if (dataStart == 0) {
+            throw std::runtime_error("JPL catalog has no dashed line under its column titles: " + path);
+        }
+        layout = jplLayout(header, separator, path);
+    }
+
+    // Cut the body into roughly equal chunks, each moved forward to the start of a line
+    const unsigned int hardwareThreads = settings.threadCount != 0 ? settings.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t bodySize = size - dataStart;
+    const std::size_t chunkCount = std::max<std::size_t>(1, std::min<std::size_t>(hardwareThreads, bodySize / MINIMUM_CHUNK_BYTES));
+
+    std::vector<const char*> boundaries;
+    boundaries.reserve(chunkCount + 1);
+    boundaries.push_back(data + dataStart);
+    for (std::size_t chunk = 1; chunk < chunkCount; ++chunk) {
+        const char* guess = data + dataStart + bodySize / chunkCount * chunk;
+        const char* lineEnd = static_cast<const char*>(std::memchr(guess, '\n', static_cast<std::size_t>(data + size - guess)));
+        boundaries.push_back(lineEnd != nullptr ? std::max(lineEnd + 1, boundaries.back()) : data + size);
+    }
+    boundaries.push_back(data + size);
+
+    const LineContext context{ layout, settings, path, data };
+    std::vector<std::vector<CelestialBodyRecord>> chunks(chunkCount);
+    if (chunkCount == 1) {
+        chunks[0] = parseChunk(boundaries[0], boundaries[1], context);
+    }
+    else {
+        std::vector<std::future<std::vector<CelestialBodyRecord>>> parsed;
+        parsed.reserve(chunkCount);
+        ThreadPool pool(static_cast<unsigned int>(chunkCount));
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            parsed.push_back(pool.submit([&context, &boundaries, chunk] {
+                return parseChunk(boundaries[chunk], boundaries[chunk + 1], context);
+            }));
+        }
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            chunks[chunk] = parsed[chunk].get();
+        }
+    }
+
+    std::size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += chunk.size();
+    }
+
+    std::vector<CelestialBodyRecord> records = std::move(chunks[0]);
+    records.reserve(total);
+    for (std::size_t chunk = 1; chunk < chunkCount; ++chunk) {
+        std::move(chunks[chunk].begin(), chunks[chunk].end(), std::back_inserter(records));
+    }
+    return records;
+}
+
+std::size_t OrbitalCatalogImporter::ImportToCatalog(const std::string& path, OrbitalCatalogFormat format, const std::string& outputPath, const OrbitalImportSettings& settings) {
+    const std::vector<CelestialBodyRecord> records = Import(path, format, settings);
+
+    BinaryCatalogWriter writer;
+    writer.reserve(records.size());
+    for (const CelestialBodyRecord& record : records) {
+        writer.add(record);
+    }
+    writer.write(outputPath);
+    return records.size();
+}
+
+std::size_t OrbitalCatalogImporter::ImportToModel(const std::string& path, OrbitalCatalogFormat format, SolarSystem::SolarSystemModel& model, const OrbitalImportSettings& settings) {
+    const std::vector<CelestialBodyRecord> records = Import(path, format, settings);
+
+    model.reserveCelestialBodies<SolarSystem::Asteroid>(records.size());
+    for (const CelestialBodyRecord& record : records) {
+        model.emplaceCelestialBody<SolarSystem::Asteroid>(record.mass, record.velocity, record.radius, record.name, record.position,
+            record.angularVelocity);
+    }
+    return records.size();
+}
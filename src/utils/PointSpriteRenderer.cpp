@@ -0,0 +1,225 @@
+
+#include <utils/PointSpriteRenderer.h>
+#include <utils/ShaderUtils.h>
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+
+using namespace Utilities;
+
+namespace {
+
+    // Window depth that no sprite beats, the far plane
+    constexpr float EMPTY_SPLAT_DEPTH = 1.0f;
+
+    // The dimming the point vertex shader applies below a pixel, so both paths draw a sprite alike
+    inline std::uint32_t dimColor(std::uint32_t color, float diameter) {
+        const std::uint32_t scale = static_cast<std::uint32_t>(std::clamp(diameter * diameter, 0.25f, 1.0f) * 256.0f);
+        const std::uint32_t red = ((color & 0xff) * scale) >> 8;
+        const std::uint32_t green = (((color >> 8) & 0xff) * scale) >> 8;
+        const std::uint32_t blue = (((color >> 16) & 0xff) * scale) >> 8;
+        return std::min(red, 255u) | (std::min(green, 255u) << 8) | (std::min(blue, 255u) << 16) | (0xffu << 24);
+    }
+}
+
+PointSpriteRenderer::~PointSpriteRenderer() {
+    shutdown();
+}
+
+void PointSpriteRenderer::shutdown() {
+    if (spriteBuffer == 0) {
+        return;
+    }
+    glDeleteBuffers(1, &spriteBuffer);
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteVertexArrays(1, &splatVertexArray);
+    glDeleteTextures(1, &splatColorTexture);
+    glDeleteTextures(1, &splatDepthTexture);
+    glDeleteProgram(shaderProgram);
+    glDeleteProgram(splatProgram);
+    spriteBuffer = vertexArray = splatVertexArray = splatColorTexture = splatDepthTexture = shaderProgram = splatProgram = 0;
+    spriteBufferCapacity = 0;
+    splatWidth = splatHeight = 0;
+    sprites.clear();
+    points.clear();
+}
+
+void PointSpriteRenderer::initialize() {
+    if (spriteBuffer != 0) {
+        return;
+    }
+    shaderProgram = ShaderUtils::createShaderProgram(ShaderUtils::pointSpriteVertexShaderSource, ShaderUtils::pointSpriteFragmentShaderSource);
+    viewLocation = glGetUniformLocation(shaderProgram, "view");
+    projectionLocation = glGetUniformLocation(shaderProgram, "projection");
+    pixelScaleLocation = glGetUniformLocation(shaderProgram, "pixelsPerUnitAtUnitDepth");
+    maxPointSizeLocation = glGetUniformLocation(shaderProgram, "maxPointSize");
+
+    // The attributes always read from offset 0 of the one stream buffer, so they are bound once
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &spriteBuffer);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, spriteBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointSprite), (void*)offsetof(PointSprite, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(PointSprite), (void*)offsetof(PointSprite, radius));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PointSprite), (void*)offsetof(PointSprite, color));
+    glEnableVertexAttribArray(2);
+
+    // The full screen triangle is built from gl_VertexID, the core profile still wants a vertex array bound
+    splatProgram = ShaderUtils::createShaderProgram(ShaderUtils::spriteSplatVertexShaderSource, ShaderUtils::spriteSplatFragmentShaderSource);
+    viewportOriginLocation = glGetUniformLocation(splatProgram, "viewportOrigin");
+    glUseProgram(splatProgram);
+    glUniform1i(glGetUniformLocation(splatProgram, "splatColor"), 0);
+    glUniform1i(glGetUniformLocation(splatProgram, "splatDepth"), 1);
+    glGenVertexArrays(1, &splatVertexArray);
+
+    glGenTextures(1, &splatColorTexture);
+    glGenTextures(1, &splatDepthTexture);
+    for (GLuint texture : { splatColorTexture, splatDepthTexture }) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+}
+
+std::uint32_t PointSpriteRenderer::packColor(const glm::vec3& color) {
+    auto channel = [](float value) {
+        return static_cast<std::uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (0xffu << 24);
+}
+
+void PointSpriteRenderer::draw(const glm::mat4& view, const glm::mat4& projection) {
+    draw(sprites.data(), sprites.size(), view, projection);
+    sprites.clear();
+}
+
+void PointSpriteRenderer::draw(const PointSprite* buffer, std::size_t count, const glm::mat4& view, const glm::mat4& projection) {
+    spriteCount = count;
+    pointCount = 0;
+    splatPixelCount = 0;
+    if (count == 0) {
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    // A sphere of radius r at view depth d covers r / d * projection[1][1] of the half viewport height
+    const float pixelsPerUnitAtUnitDepth = projection[1][1] * 0.5f * static_cast<float>(viewport[3]);
+
+    if (count < SPLAT_THRESHOLD) {
+        drawPoints(buffer, count, view, projection, pixelsPerUnitAtUnitDepth);
+        return;
+    }
+
+    splat(buffer, count, projection * view, pixelsPerUnitAtUnitDepth, viewport[2], viewport[3]);
+    if (splatPixelCount > 0) {
+        drawSplats(viewport);
+    }
+    if (!points.empty()) {
+        drawPoints(points.data(), points.size(), view, projection, pixelsPerUnitAtUnitDepth);
+    }
+}
+
+void PointSpriteRenderer::splat(const PointSprite* buffer, std::size_t count, const glm::mat4& viewProjection, float pixelsPerUnitAtUnitDepth, GLsizei width, GLsizei height) {
+    const std::size_t pixels = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    points.clear();
+    splatColors.assign(pixels, 0);
+    splatDepths.assign(pixels, EMPTY_SPLAT_DEPTH);
+
+    // Rows of the matrix in scalars, glm is column major
+    const float x0 = viewProjection[0][0], x1 = viewProjection[1][0], x2 = viewProjection[2][0], x3 = viewProjection[3][0];
+    const float y0 = viewProjection[0][1], y1 = viewProjection[1][1], y2 = viewProjection[2][1], y3 = viewProjection[3][1];
+    const float z0 = viewProjection[0][2], z1 = viewProjection[1][2], z2 = viewProjection[2][2], z3 = viewProjection[3][2];
+    const float w0 = viewProjection[0][3], w1 = viewProjection[1][3], w2 = viewProjection[2][3], w3 = viewProjection[3][3];
+    const float halfWidth = 0.5f * static_cast<float>(width);
+    const float halfHeight = 0.5f * static_cast<float>(height);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const PointSprite& sprite = buffer[i];
+        // Under a perspective projection clip w is the depth in front of the camera
+        const float clipW = w0 * sprite.x + w1 * sprite.y + w2 * sprite.z + w3;
+        if (clipW <= 0.0f) {
+            continue;
+        }
+        const float diameter = 2.0f * sprite.radius * pixelsPerUnitAtUnitDepth / clipW;
+        if (diameter > SPLAT_DIAMETER) {
+            points.push_back(sprite);
+            continue;
+        }
+
+        // A point of one pixel covers the pixel its centre falls in, the same one GL would rasterize
+        const float inverseW = 1.0f / clipW;
+        const float windowX = ((x0 * sprite.x + x1 * sprite.y + x2 * sprite.z + x3) * inverseW + 1.0f) * halfWidth;
+        const float windowY = ((y0 * sprite.x + y1 * sprite.y + y2 * sprite.z + y3) * inverseW + 1.0f) * halfHeight;
+        const float depth = ((z0 * sprite.x + z1 * sprite.y + z2 * sprite.z + z3) * inverseW + 1.0f) * 0.5f;
+        if (!(windowX >= 0.0f && windowX < 2.0f * halfWidth && windowY >= 0.0f && windowY < 2.0f * halfHeight && depth >= 0.0f)) {
+            continue;
+        }
+
+        const std::size_t pixel = static_cast<std::size_t>(windowY) * static_cast<std::size_t>(width) + static_cast<std::size_t>(windowX);
+        if (depth < splatDepths[pixel]) {
+            splatPixelCount += splatColors[pixel] == 0 ? 1 : 0;
+            splatDepths[pixel] = depth;
+            splatColors[pixel] = dimColor(sprite.color, diameter);
+        }
+    }
+}
+
+void PointSpriteRenderer::drawSplats(const GLint* viewport) {
+    const GLsizei width = viewport[2];
+    const GLsizei height = viewport[3];
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, splatDepthTexture);
+    if (width != splatWidth || height != splatHeight) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, splatDepths.data());
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, splatDepths.data());
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, splatColorTexture);
+    if (width != splatWidth || height != splatHeight) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, splatColors.data());
+        splatWidth = width;
+        splatHeight = height;
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, splatColors.data());
+    }
+
+    glUseProgram(splatProgram);
+    glUniform2i(viewportOriginLocation, viewport[0], viewport[1]);
+    glBindVertexArray(splatVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void PointSpriteRenderer::drawPoints(const PointSprite* buffer, std::size_t count, const glm::mat4& view, const glm::mat4& projection, float pixelsPerUnitAtUnitDepth) {
+    pointCount = count;
+
+    // Grows geometrically, otherwise orphans the old storage so the driver need not wait for the previous draw
+    glBindBuffer(GL_ARRAY_BUFFER, spriteBuffer);
+    if (count > spriteBufferCapacity) {
+        spriteBufferCapacity = std::max(count, spriteBufferCapacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER, spriteBufferCapacity * sizeof(PointSprite), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(PointSprite), buffer);
+
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1f(pixelScaleLocation, pixelsPerUnitAtUnitDepth);
+    glUniform1f(maxPointSizeLocation, MAX_POINT_SIZE);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(vertexArray);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
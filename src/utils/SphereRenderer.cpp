@@ -0,0 +1,102 @@
+
+#include <utils/SphereRenderer.h>
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+
+using namespace Utilities;
+
+SphereRenderer::~SphereRenderer() {
+    shutdown();
+}
+
+void SphereRenderer::shutdown() {
+    if (instanceBuffer == 0) {
+        return;
+    }
+    glDeleteBuffers(1, &instanceBuffer);
+    instanceBuffer = 0;
+    instanceBufferCapacity = 0;
+    for (const GeometryManager::SphereLod& level : sphereLods) {
+        GeometryManager::releaseGeometryNoThrow(level.geometry.VAO);
+    }
+    sphereLods.clear();
+    batches.clear();
+}
+
+void SphereRenderer::initialize(GLuint shaderProgram) {
+    this->shaderProgram = shaderProgram;
+    // Looked up once rather than every frame
+    viewLocation = glGetUniformLocation(shaderProgram, "view");
+    projectionLocation = glGetUniformLocation(shaderProgram, "projection");
+    if (instanceBuffer == 0) {
+        glGenBuffers(1, &instanceBuffer);
+        sphereLods = GeometryManager::acquireSphereLodChain();
+    }
+}
+
+void SphereRenderer::add(const GeometryManager::GeometryData& geometry, const glm::mat4& model, const glm::vec3& color) {
+    // A handful of meshes at most, a linear search beats hashing
+    for (Batch& batch : batches) {
+        if (batch.geometry.VAO == geometry.VAO) {
+            // A released VAO name can come back for another mesh
+            batch.geometry = geometry;
+            batch.instances.push_back(SphereInstance{ model, color });
+            return;
+        }
+    }
+    batches.push_back(Batch{ geometry, { SphereInstance{ model, color } } });
+}
+
+void SphereRenderer::addLevelOfDetail(const glm::mat4& model, const glm::vec3& color, float pixelRadius) {
+    add(sphereLods[GeometryManager::selectSphereLod(sphereLods, pixelRadius)].geometry, model, color);
+}
+
+void SphereRenderer::bindInstanceAttributes(GLuint VAO) {
+    // The attributes point at offset 0 of the shared instance buffer, which holds the batch being drawn
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offsetof(SphereInstance, color));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    for (GLuint column = 0; column < 4; ++column) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)(offsetof(SphereInstance, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribDivisor(2 + column, 1);
+    }
+}
+
+void SphereRenderer::draw(const glm::mat4& view, const glm::mat4& projection) {
+    drawCalls = 0;
+    instanceCount = 0;
+    triangleCount = 0;
+
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+
+    for (Batch& batch : batches) {
+        if (batch.instances.empty()) {
+            continue;
+        }
+
+        // Grows geometrically, otherwise orphans the old storage so the driver need not wait for the previous draw
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        if (batch.instances.size() > instanceBufferCapacity) {
+            instanceBufferCapacity = std::max(batch.instances.size(), instanceBufferCapacity * 2);
+        }
+        glBufferData(GL_ARRAY_BUFFER, instanceBufferCapacity * sizeof(SphereInstance), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, batch.instances.size() * sizeof(SphereInstance), batch.instances.data());
+
+        bindInstanceAttributes(batch.geometry.VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, batch.geometry.indicesCount, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(batch.instances.size()));
+
+        ++drawCalls;
+        instanceCount += batch.instances.size();
+        triangleCount += batch.instances.size() * (batch.geometry.indicesCount / 3);
+        batch.instances.clear();
+    }
+    glBindVertexArray(0);
+}
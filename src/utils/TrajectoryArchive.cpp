@@ -0,0 +1,295 @@
+
+#include <utils/TrajectoryArchive.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Utilities;
+
+namespace {
+
+    const std::vector<std::string> NO_BODIES;
+
+    inline void readState(const double* values, std::size_t body, std::size_t frame, std::size_t bodyCount, std::size_t frameCount,
+        Vector& position, Vector& velocity) {
+
+        auto at = [&](TrajectoryColumn column) {
+            return values[TrajectoryCodec::valueIndex(column, body, frame, bodyCount, frameCount)];
+        };
+        position = Vector(at(TrajectoryColumn::PositionX), at(TrajectoryColumn::PositionY), at(TrajectoryColumn::PositionZ));
+        velocity = Vector(at(TrajectoryColumn::VelocityX), at(TrajectoryColumn::VelocityY), at(TrajectoryColumn::VelocityZ));
+    }
+}
+
+TrajectoryArchive::TrajectoryArchive(const std::string& path) : file(path) {
+    if (file.size() < sizeof(TrajectoryFileHeader)) {
+        throw std::runtime_error("File is too small to be a trajectory: " + path);
+    }
+
+    TrajectoryFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, TrajectoryCodec::MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File is not a trajectory: " + path);
+    }
+    if (header.byteOrderMark != TrajectoryCodec::BYTE_ORDER_MARK) {
+        throw std::runtime_error("Trajectory was written with a different byte order: " + path);
+    }
+    if (header.version != TrajectoryCodec::VERSION) {
+        throw std::runtime_error("Unsupported trajectory version " + std::to_string(header.version) + ": " + path);
+    }
+
+    storedIndex = readStoredIndex();
+    if (!storedIndex) {
+        scanBlocks();
+    }
+    loadBodyTables();
+}
+
+bool TrajectoryArchive::readStoredIndex() {
+    const std::size_t fileSize = file.size();
+    if (fileSize < sizeof(TrajectoryFileHeader) + sizeof(TrajectoryFileFooter)) {
+        return false;
+    }
+
+    TrajectoryFileFooter footer;
+    std::memcpy(&footer, file.data() + fileSize - sizeof(footer), sizeof(footer));
+    if (std::memcmp(footer.magic, TrajectoryCodec::FOOTER_MAGIC, sizeof(footer.magic)) != 0) {
+        return false;
+    }
+
+    const TrajectoryBlockHeader& block = blockAt(footer.indexOffset, TrajectoryBlockType::Index);
+    if (block.storedSize != footer.chunkCount * sizeof(TrajectoryIndexEntry)) {
+        throw std::runtime_error("Trajectory index does not match its footer.");
+    }
+
+    chunks.resize(static_cast<std::size_t>(footer.chunkCount));
+    std::memcpy(chunks.data(), file.data() + footer.indexOffset + sizeof(TrajectoryBlockHeader), static_cast<std::size_t>(block.storedSize));
+    for (const TrajectoryIndexEntry& entry : chunks) {
+        blockAt(entry.chunkOffset, TrajectoryBlockType::Chunk);
+        blockAt(entry.bodyTableOffset, TrajectoryBlockType::BodyTable);
+    }
+    return true;
+}
+
+void TrajectoryArchive::scanBlocks() {
+    const std::size_t fileSize = file.size();
+    std::uint64_t offset = sizeof(TrajectoryFileHeader);
+    std::uint64_t bodyTableOffset = 0;
+    bool haveBodyTable = false;
+
+    // A recording cut short may end in a partly written block, everything before it is still usable
+    while (offset + sizeof(TrajectoryBlockHeader) <= fileSize) {
+        TrajectoryBlockHeader block;
+        std::memcpy(&block, file.data() + offset, sizeof(block));
+        if (block.storedSize > fileSize - offset - sizeof(block)) {
+            break;
+        }
+
+        if (block.type == static_cast<std::uint32_t>(TrajectoryBlockType::BodyTable)) {
+            bodyTableOffset = offset;
+            haveBodyTable = true;
+        }
+        else if (block.type == static_cast<std::uint32_t>(TrajectoryBlockType::Chunk)) {
+            if (!haveBodyTable || block.storedSize < sizeof(TrajectoryChunkHeader)) {
+                throw std::runtime_error("Trajectory has a chunk without a body table.");
+            }
+            TrajectoryChunkHeader chunk;
+            std::memcpy(&chunk, file.data() + offset + sizeof(block), sizeof(chunk));
+            chunks.push_back({ chunk.firstTime, chunk.lastTime, chunk.firstFrame, chunk.frameCount, chunk.bodyCount, offset, bodyTableOffset });
+        }
+        offset = TrajectoryCodec::alignBlock(offset + sizeof(block) + block.storedSize);
+    }
+}
+
+void TrajectoryArchive::loadBodyTables() {
+    chunkTables.reserve(chunks.size());
+    std::uint64_t loadedOffset = 0;
+    for (std::size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+        const TrajectoryIndexEntry& entry = chunks[chunk];
+        if (chunk > 0 && (entry.firstTime < chunks[chunk - 1].lastTime || entry.firstFrame < chunks[chunk - 1].firstFrame + chunks[chunk - 1].frameCount)) {
+            throw std::runtime_error("Trajectory chunks are out of order.");
+        }
+        if (entry.frameCount == 0) {
+            throw std::runtime_error("Trajectory has an empty chunk.");
+        }
+
+        // Chunks share a table until the bodies change, so each table is decoded once
+        if (tables.empty() || entry.bodyTableOffset != loadedOffset) {
+            const TrajectoryBlockHeader& block = blockAt(entry.bodyTableOffset, TrajectoryBlockType::BodyTable);
+            BodyTable table;
+            table.names = TrajectoryCodec::decodeBodyTable(file.data() + entry.bodyTableOffset + sizeof(block), static_cast<std::size_t>(block.storedSize));
+            table.indices.reserve(table.names.size());
+            for (std::size_t body = 0; body < table.names.size(); ++body) {
+                table.indices.emplace(table.names[body], static_cast<std::uint32_t>(body));
+            }
+            tables.push_back(std::move(table));
+            loadedOffset = entry.bodyTableOffset;
+        }
+        if (tables.back().names.size() != entry.bodyCount) {
+            throw std::runtime_error("Trajectory chunk does not match its body table.");
+        }
+        chunkTables.push_back(static_cast<std::uint32_t>(tables.size() - 1));
+    }
+}
+
+const TrajectoryBlockHeader& TrajectoryArchive::blockAt(std::uint64_t offset, TrajectoryBlockType type) const {
+    const std::size_t fileSize = file.size();
+    if (offset % TrajectoryCodec::BLOCK_ALIGNMENT != 0 || offset < sizeof(TrajectoryFileHeader) || offset > fileSize - sizeof(TrajectoryBlockHeader)) {
+        throw std::runtime_error("Trajectory refers to a block outside the file.");
+    }
+
+    // Aligned offsets into a page aligned mapping, the header can be used in place
+    const TrajectoryBlockHeader& block = *reinterpret_cast<const TrajectoryBlockHeader*>(file.data() + offset);
+    if (block.type != static_cast<std::uint32_t>(type) || block.storedSize > fileSize - offset - sizeof(block)) {
+        throw std::runtime_error("Trajectory has an invalid block.");
+    }
+    return block;
+}
+
+std::size_t TrajectoryArchive::findChunk(double time) const {
+    // Last chunk starting at or before time
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), time, [](double value, const TrajectoryIndexEntry& entry) {
+        return value < entry.firstTime;
+    });
+    return it == chunks.begin() ? 0 : static_cast<std::size_t>(it - chunks.begin()) - 1;
+}
+
+const std::vector<std::string>& TrajectoryArchive::getBodyNames(double time) const {
+    if (chunks.empty() || time < getStartTime() || time > getEndTime()) {
+        return NO_BODIES;
+    }
+    return tables[chunkTables[findChunk(time)]].names;
+}
+
+std::optional<std::uint32_t> TrajectoryArchive::findBody(std::size_t chunk, const std::string& name) const {
+    const BodyTable& table = tables[chunkTables[chunk]];
+    auto it = table.indices.find(name);
+    if (it == table.indices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void TrajectoryArchive::readChunk(std::size_t chunk, std::vector<unsigned char>& scratch, std::vector<double>& times, std::vector<double>& values) const {
+    const TrajectoryIndexEntry& entry = chunks[chunk];
+    const TrajectoryBlockHeader& block = blockAt(entry.chunkOffset, TrajectoryBlockType::Chunk);
+    const unsigned char* payload = file.data() + entry.chunkOffset + sizeof(block) + sizeof(TrajectoryChunkHeader);
+    const std::size_t payloadSize = static_cast<std::size_t>(block.storedSize) - sizeof(TrajectoryChunkHeader);
+
+    TrajectoryChunkHeader header;
+    std::memcpy(&header, file.data() + entry.chunkOffset + sizeof(block), sizeof(header));
+    times.resize(entry.frameCount);
+    values.resize(TrajectoryCodec::COLUMN_COUNT * entry.bodyCount * entry.frameCount);
+    TrajectoryCodec::decodeChunk(header, payload, payloadSize, static_cast<std::size_t>(block.rawSize),
+        static_cast<TrajectoryCompression>(block.compression), scratch, times.data(), values.data());
+}
+
+TrajectoryArchive::ChunkView TrajectoryArchive::view(std::size_t chunk) {
+    const TrajectoryIndexEntry& entry = chunks[chunk];
+    const TrajectoryBlockHeader& block = blockAt(entry.chunkOffset, TrajectoryBlockType::Chunk);
+
+    ChunkView result;
+    result.frameCount = entry.frameCount;
+    result.bodyCount = entry.bodyCount;
+
+    if (block.compression == static_cast<std::uint32_t>(TrajectoryCompression::None)) {
+        const unsigned char* payload = file.data() + entry.chunkOffset + sizeof(block) + sizeof(TrajectoryChunkHeader);
+        const std::size_t valueCount = TrajectoryCodec::COLUMN_COUNT * entry.bodyCount * entry.frameCount;
+        if (block.storedSize - sizeof(TrajectoryChunkHeader) != (entry.frameCount + valueCount) * sizeof(double)) {
+            throw std::runtime_error("Corrupt trajectory chunk.");
+        }
+        result.times = reinterpret_cast<const double*>(payload);
+        result.values = result.times + entry.frameCount;
+        return result;
+    }
+
+    auto cached = std::find_if(decoded.begin(), decoded.end(), [chunk](const DecodedChunk& slot) {
+        return slot.chunk == chunk;
+    });
+    if (cached == decoded.end()) {
+        cached = std::min_element(decoded.begin(), decoded.end(), [](const DecodedChunk& a, const DecodedChunk& b) {
+            return a.lastUse < b.lastUse;
+        });
+
+        // Mark the slot empty first so a decoding error cannot leave half a chunk behind
+        cached->chunk = SIZE_MAX;
+        readChunk(chunk, decodeScratch, cached->times, cached->values);
+        cached->chunk = chunk;
+    }
+    cached->lastUse = ++useCounter;
+
+    result.times = cached->times.data();
+    result.values = cached->values.data();
+    return result;
+}
+
+bool TrajectoryArchive::sample(const std::string& name, double time, TrajectorySample& result) {
+    if (chunks.empty() || !(time >= getStartTime() && time <= getEndTime())) {
+        return false;
+    }
+
+    const std::size_t chunk = findChunk(time);
+    const std::optional<std::uint32_t> body = findBody(chunk, name);
+    if (!body) {
+        return false;
+    }
+
+    ChunkView current = view(chunk);
+    const std::size_t frame = static_cast<std::size_t>(std::upper_bound(current.times, current.times + current.frameCount, time) - current.times) - 1;
+    const double firstTime = current.times[frame];
+    Vector firstPosition, firstVelocity;
+    readState(current.values, *body, frame, current.bodyCount, current.frameCount, firstPosition, firstVelocity);
+
+    if (time == firstTime) {
+        result.position = firstPosition;
+        result.velocity = firstVelocity;
+        return true;
+    }
+
+    // The following frame is either in this chunk or starts the next one, where the body may sit at another index
+    double secondTime;
+    Vector secondPosition, secondVelocity;
+    if (frame + 1 < current.frameCount) {
+        secondTime = current.times[frame + 1];
+        readState(current.values, *body, frame + 1, current.bodyCount, current.frameCount, secondPosition, secondVelocity);
+    }
+    else {
+        const std::optional<std::uint32_t> nextBody = findBody(chunk + 1, name);
+        if (!nextBody) {
+            return false;
+        }
+        ChunkView next = view(chunk + 1);
+        secondTime = next.times[0];
+        readState(next.values, *nextBody, 0, next.bodyCount, next.frameCount, secondPosition, secondVelocity);
+    }
+
+    result = interpolateHermite(firstTime, TrajectorySample{ firstPosition, firstVelocity }, secondTime, TrajectorySample{ secondPosition, secondVelocity }, time);
+    return true;
+}
+
+TrajectorySample Utilities::interpolateHermite(double firstTime, const TrajectorySample& first, double secondTime, const TrajectorySample& second, double time) {
+    // Files from before the recorder rejected repeated times can hold two frames at one time
+    const double h = secondTime - firstTime;
+    if (!(h > 0.0)) {
+        return first;
+    }
+
+    // Cubic Hermite basis on s in [0, 1], velocities scaled by the frame spacing to match
+    const double s = (time - firstTime) / h;
+    const double s2 = s * s;
+    const double s3 = s2 * s;
+    const double h00 = 2.0 * s3 - 3.0 * s2 + 1.0;
+    const double h10 = s3 - 2.0 * s2 + s;
+    const double h01 = -2.0 * s3 + 3.0 * s2;
+    const double h11 = s3 - s2;
+
+    const double d00 = (6.0 * s2 - 6.0 * s) / h;
+    const double d10 = 3.0 * s2 - 4.0 * s + 1.0;
+    const double d01 = (6.0 * s - 6.0 * s2) / h;
+    const double d11 = 3.0 * s2 - 2.0 * s;
+
+    TrajectorySample result;
+    result.position = first.position * h00 + first.velocity * (h10 * h) + second.position * h01 + second.velocity * (h11 * h);
+    result.velocity = first.position * d00 + first.velocity * d10 + second.position * d01 + second.velocity * d11;
+    return result;
+}
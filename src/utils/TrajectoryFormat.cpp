@@ -0,0 +1,279 @@
+
+#include <utils/TrajectoryFormat.h>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef SOLAR_SYSTEM_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace Utilities;
+
+namespace {
+
+    constexpr std::size_t WORD_BYTES = sizeof(std::uint64_t);
+
+    // Zero runs shorter than this are cheaper to keep inside a literal run
+    constexpr std::size_t MINIMUM_ZERO_RUN = 4;
+
+#ifdef SOLAR_SYSTEM_WITH_ZSTD
+    constexpr int ZSTD_LEVEL = 3;
+#endif
+
+    void writeVarint(std::vector<unsigned char>& out, std::size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    std::size_t readVarint(const unsigned char*& cursor, const unsigned char* end) {
+        std::size_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            if (cursor == end) {
+                break;
+            }
+            const unsigned char byte = *cursor++;
+            value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Corrupt trajectory chunk.");
+    }
+
+    // Tokens of (zero run length, literal length, literal bytes)
+    void compressZeroRuns(const unsigned char* data, std::size_t size, std::vector<unsigned char>& out) {
+        std::size_t position = 0;
+        while (position < size) {
+            std::size_t zeros = 0;
+            while (position + zeros < size && data[position + zeros] == 0) {
+                ++zeros;
+            }
+            position += zeros;
+
+            // A literal ends where the next worthwhile zero run starts
+            std::size_t literalEnd = position;
+            std::size_t zeroStreak = 0;
+            while (literalEnd < size) {
+                zeroStreak = data[literalEnd] == 0 ? zeroStreak + 1 : 0;
+                ++literalEnd;
+                if (zeroStreak == MINIMUM_ZERO_RUN) {
+                    literalEnd -= MINIMUM_ZERO_RUN;
+                    break;
+                }
+            }
+
+            writeVarint(out, zeros);
+            writeVarint(out, literalEnd - position);
+            out.insert(out.end(), data + position, data + literalEnd);
+            position = literalEnd;
+        }
+    }
+
+    void decompressZeroRuns(const unsigned char* data, std::size_t size, unsigned char* out, std::size_t rawSize) {
+        const unsigned char* cursor = data;
+        const unsigned char* end = data + size;
+        std::size_t written = 0;
+        while (cursor < end) {
+            const std::size_t zeros = readVarint(cursor, end);
+            const std::size_t literals = readVarint(cursor, end);
+            if (zeros > rawSize - written || literals > rawSize - written - zeros || literals > static_cast<std::size_t>(end - cursor)) {
+                throw std::runtime_error("Corrupt trajectory chunk.");
+            }
+            std::memset(out + written, 0, zeros);
+            written += zeros;
+            std::memcpy(out + written, cursor, literals);
+            written += literals;
+            cursor += literals;
+        }
+        if (written != rawSize) {
+            throw std::runtime_error("Corrupt trajectory chunk.");
+        }
+    }
+
+    // Each series is XORed with its previous frame, series of one frame stay as they are
+    void xorDelta(std::uint64_t* words, std::size_t seriesCount, std::size_t seriesLength) {
+        for (std::size_t series = 0; series < seriesCount; ++series) {
+            std::uint64_t* values = words + series * seriesLength;
+            for (std::size_t frame = seriesLength; frame-- > 1;) {
+                values[frame] ^= values[frame - 1];
+            }
+        }
+    }
+
+    void undoXorDelta(std::uint64_t* words, std::size_t seriesCount, std::size_t seriesLength) {
+        for (std::size_t series = 0; series < seriesCount; ++series) {
+            std::uint64_t* values = words + series * seriesLength;
+            for (std::size_t frame = 1; frame < seriesLength; ++frame) {
+                values[frame] ^= values[frame - 1];
+            }
+        }
+    }
+
+    // Byte k of every word goes to plane k
+    void shuffleBytes(const unsigned char* words, std::size_t wordCount, unsigned char* planes) {
+        for (std::size_t word = 0; word < wordCount; ++word) {
+            for (std::size_t byte = 0; byte < WORD_BYTES; ++byte) {
+                planes[byte * wordCount + word] = words[word * WORD_BYTES + byte];
+            }
+        }
+    }
+
+    void unshuffleBytes(const unsigned char* planes, std::size_t wordCount, unsigned char* words) {
+        for (std::size_t byte = 0; byte < WORD_BYTES; ++byte) {
+            for (std::size_t word = 0; word < wordCount; ++word) {
+                words[word * WORD_BYTES + byte] = planes[byte * wordCount + word];
+            }
+        }
+    }
+}
+
+bool TrajectoryCodec::isAvailable(TrajectoryCompression compression) {
+    switch (compression) {
+    case TrajectoryCompression::None:
+    case TrajectoryCompression::ZeroRun:
+        return true;
+    case TrajectoryCompression::Zstd:
+#ifdef SOLAR_SYSTEM_WITH_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+std::size_t TrajectoryCodec::encodeChunk(const TrajectoryChunkHeader& header, const double* times, const double* values,
+    TrajectoryCompression compression, std::vector<unsigned char>& scratch, std::vector<unsigned char>& encoded) {
+
+    const std::size_t frameCount = header.frameCount;
+    const std::size_t seriesCount = 1 + COLUMN_COUNT * header.bodyCount;
+    const std::size_t wordCount = seriesCount * frameCount;
+    const std::size_t rawSize = wordCount * WORD_BYTES;
+
+    // The words and their shuffled planes share one scratch buffer
+    scratch.resize(2 * rawSize);
+    unsigned char* words = scratch.data();
+    unsigned char* planes = scratch.data() + rawSize;
+    std::memcpy(words, times, frameCount * sizeof(double));
+    std::memcpy(words + frameCount * sizeof(double), values, (wordCount - frameCount) * sizeof(double));
+
+    if (compression != TrajectoryCompression::None) {
+        std::uint64_t* series = reinterpret_cast<std::uint64_t*>(words);
+        xorDelta(series, seriesCount, frameCount);
+        shuffleBytes(words, wordCount, planes);
+    }
+    else {
+        std::memcpy(planes, words, rawSize);
+    }
+
+    encoded.clear();
+    switch (compression) {
+    case TrajectoryCompression::None:
+        encoded.assign(planes, planes + rawSize);
+        break;
+    case TrajectoryCompression::ZeroRun:
+        encoded.reserve(rawSize / 2);
+        compressZeroRuns(planes, rawSize, encoded);
+        break;
+    case TrajectoryCompression::Zstd:
+#ifdef SOLAR_SYSTEM_WITH_ZSTD
+    {
+        encoded.resize(ZSTD_compressBound(rawSize));
+        const std::size_t written = ZSTD_compress(encoded.data(), encoded.size(), planes, rawSize, ZSTD_LEVEL);
+        if (ZSTD_isError(written)) {
+            throw std::runtime_error(std::string("Could not compress trajectory chunk: ") + ZSTD_getErrorName(written));
+        }
+        encoded.resize(written);
+        break;
+    }
+#else
+        throw std::runtime_error("Trajectory zstd compression needs a build with SOLAR_SYSTEM_WITH_ZSTD.");
+#endif
+    default:
+        throw std::runtime_error("Unknown trajectory compression.");
+    }
+    return rawSize;
+}
+
+void TrajectoryCodec::decodeChunk(const TrajectoryChunkHeader& header, const unsigned char* encoded, std::size_t encodedSize, std::size_t rawSize,
+    TrajectoryCompression compression, std::vector<unsigned char>& scratch, double* times, double* values) {
+
+    const std::size_t frameCount = header.frameCount;
+    const std::size_t seriesCount = 1 + COLUMN_COUNT * header.bodyCount;
+    const std::size_t wordCount = seriesCount * frameCount;
+    if (rawSize != wordCount * WORD_BYTES) {
+        throw std::runtime_error("Corrupt trajectory chunk.");
+    }
+
+    scratch.resize(2 * rawSize);
+    unsigned char* planes = scratch.data();
+    unsigned char* words = scratch.data() + rawSize;
+
+    switch (compression) {
+    case TrajectoryCompression::None:
+        if (encodedSize != rawSize) {
+            throw std::runtime_error("Corrupt trajectory chunk.");
+        }
+        std::memcpy(words, encoded, rawSize);
+        break;
+    case TrajectoryCompression::ZeroRun:
+        decompressZeroRuns(encoded, encodedSize, planes, rawSize);
+        break;
+    case TrajectoryCompression::Zstd:
+#ifdef SOLAR_SYSTEM_WITH_ZSTD
+    {
+        const std::size_t written = ZSTD_decompress(planes, rawSize, encoded, encodedSize);
+        if (ZSTD_isError(written) || written != rawSize) {
+            throw std::runtime_error("Corrupt trajectory chunk.");
+        }
+        break;
+    }
+#else
+        throw std::runtime_error("Trajectory zstd compression needs a build with SOLAR_SYSTEM_WITH_ZSTD.");
+#endif
+    default:
+        throw std::runtime_error("Unknown trajectory compression.");
+    }
+
+    if (compression != TrajectoryCompression::None) {
+        unshuffleBytes(planes, wordCount, words);
+        undoXorDelta(reinterpret_cast<std::uint64_t*>(words), seriesCount, frameCount);
+    }
+
+    std::memcpy(times, words, frameCount * sizeof(double));
+    std::memcpy(values, words + frameCount * sizeof(double), (wordCount - frameCount) * sizeof(double));
+}
+
+void TrajectoryCodec::encodeBodyTable(const std::vector<std::string>& names, std::vector<unsigned char>& encoded) {
+    encoded.clear();
+    writeVarint(encoded, names.size());
+    for (const std::string& name : names) {
+        writeVarint(encoded, name.size());
+        encoded.insert(encoded.end(), name.begin(), name.end());
+    }
+}
+
+std::vector<std::string> TrajectoryCodec::decodeBodyTable(const unsigned char* encoded, std::size_t encodedSize) {
+    const unsigned char* cursor = encoded;
+    const unsigned char* end = encoded + encodedSize;
+
+    const std::size_t count = readVarint(cursor, end);
+    if (count > encodedSize) {
+        throw std::runtime_error("Corrupt trajectory body table.");
+    }
+
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t length = readVarint(cursor, end);
+        if (length > static_cast<std::size_t>(end - cursor)) {
+            throw std::runtime_error("Corrupt trajectory body table.");
+        }
+        names.emplace_back(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+    }
+    return names;
+}
@@ -0,0 +1,197 @@
+
+#include <utils/TrajectoryPlayer.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Utilities;
+
+namespace {
+
+    inline TrajectorySample readSample(const std::vector<double>& values, std::size_t body, std::size_t frame, std::size_t bodyCount, std::size_t frameCount) {
+        auto at = [&](TrajectoryColumn column) {
+            return values[TrajectoryCodec::valueIndex(column, body, frame, bodyCount, frameCount)];
+        };
+        return TrajectorySample{
+            Vector(at(TrajectoryColumn::PositionX), at(TrajectoryColumn::PositionY), at(TrajectoryColumn::PositionZ)),
+            Vector(at(TrajectoryColumn::VelocityX), at(TrajectoryColumn::VelocityY), at(TrajectoryColumn::VelocityZ))
+        };
+    }
+}
+
+TrajectoryPlayer::TrajectoryPlayer(const std::string& path, std::size_t prefetchChunks)
+    : archive(path), prefetchChunks(std::max<std::size_t>(prefetchChunks, 1)) {
+
+    if (archive.getChunkCount() == 0) {
+        throw std::runtime_error("Trajectory holds no frames: " + path);
+    }
+    time = archive.getStartTime();
+    prefetcher = std::thread([this] { prefetchLoop(); });
+}
+
+TrajectoryPlayer::~TrajectoryPlayer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    prefetcher.join();
+}
+
+void TrajectoryPlayer::seek(double newTime) {
+    time = std::clamp(newTime, archive.getStartTime(), archive.getEndTime());
+}
+
+void TrajectoryPlayer::advance(double wallSeconds) {
+    if (paused) {
+        return;
+    }
+    const double next = time + speed * wallSeconds;
+    seek(next);
+    if (next != time) {
+        paused = true;
+    }
+}
+
+void TrajectoryPlayer::prefetchLoop() {
+    std::vector<unsigned char> scratch;
+    const std::size_t chunkCount = archive.getChunkCount();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        // Nearest chunk in the direction of play that is not decoded yet
+        std::size_t missing = chunkCount;
+        for (std::size_t step = 0; step < prefetchChunks && missing == chunkCount; ++step) {
+            if (wantForward ? wantedChunk + step >= chunkCount : step > wantedChunk) {
+                break;
+            }
+            const std::size_t candidate = wantForward ? wantedChunk + step : wantedChunk - step;
+            auto found = std::find_if(loaded.begin(), loaded.end(), [candidate](const std::shared_ptr<const LoadedChunk>& chunk) {
+                return chunk->chunk == candidate;
+            });
+            if (found == loaded.end()) {
+                missing = candidate;
+            }
+        }
+        if (missing == chunkCount) {
+            wake.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        auto chunk = std::make_shared<LoadedChunk>();
+        chunk->chunk = missing;
+        try {
+            archive.readChunk(missing, scratch, chunk->times, chunk->values);
+        }
+        catch (const std::exception&) {
+            // Handed to the render loop by its next chunkFor(), which would only fail on the same file again
+            lock.lock();
+            prefetchError = std::current_exception();
+            return;
+        }
+        lock.lock();
+
+        // The clock may have jumped while decoding
+        if (missing + prefetchChunks >= wantedChunk && missing <= wantedChunk + prefetchChunks) {
+            loaded.push_back(std::move(chunk));
+        }
+        evictFarChunks();
+    }
+}
+
+void TrajectoryPlayer::evictFarChunks() {
+    // Chunks well away from the clock will not be needed again unless playback turns around, the caller holds mutex
+    loaded.erase(std::remove_if(loaded.begin(), loaded.end(), [this](const std::shared_ptr<const LoadedChunk>& entry) {
+        return entry->chunk + prefetchChunks < wantedChunk || entry->chunk > wantedChunk + prefetchChunks;
+    }), loaded.end());
+}
+
+std::shared_ptr<const TrajectoryPlayer::LoadedChunk> TrajectoryPlayer::chunkFor(std::size_t chunk) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : loaded) {
+            if (entry->chunk == chunk) {
+                return entry;
+            }
+        }
+        if (prefetchError) {
+            std::rethrow_exception(prefetchError);
+        }
+    }
+
+    ++prefetchMisses;
+    auto decoded = std::make_shared<LoadedChunk>();
+    decoded->chunk = chunk;
+    archive.readChunk(chunk, decodeScratch, decoded->times, decoded->values);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    loaded.push_back(decoded);
+    evictFarChunks();
+    return decoded;
+}
+
+const std::vector<std::uint32_t>& TrajectoryPlayer::remapToNextChunk(std::size_t chunk) {
+    if (remappedChunk != chunk) {
+        const std::vector<std::string>& names = archive.getChunkBodyNames(chunk);
+        remap.resize(names.size());
+        for (std::size_t body = 0; body < names.size(); ++body) {
+            remap[body] = archive.findBody(chunk + 1, names[body]).value_or(UINT32_MAX);
+        }
+        remappedChunk = chunk;
+    }
+    return remap;
+}
+
+const std::vector<std::string>& TrajectoryPlayer::sample(std::vector<TrajectorySample>& samples) {
+    const std::size_t chunk = archive.findChunk(time);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (wantedChunk != chunk || wantForward != (speed >= 0.0)) {
+            wantedChunk = chunk;
+            wantForward = speed >= 0.0;
+            wake.notify_one();
+        }
+    }
+
+    const std::shared_ptr<const LoadedChunk> current = chunkFor(chunk);
+
+    const TrajectoryIndexEntry& entry = archive.getChunk(chunk);
+    const std::size_t frameCount = entry.frameCount;
+    const std::size_t bodyCount = entry.bodyCount;
+    const auto after = std::upper_bound(current->times.begin(), current->times.end(), time);
+    const std::size_t frame = after == current->times.begin() ? 0 : static_cast<std::size_t>(after - current->times.begin()) - 1;
+
+    // The following frame is in this chunk or starts the next one, where the bodies may sit at other indices
+    std::shared_ptr<const LoadedChunk> following;
+    std::size_t followingFrame = 0;
+    std::size_t followingFrameCount = 0;
+    std::size_t followingBodyCount = bodyCount;
+    const std::vector<std::uint32_t>* followingIndex = nullptr;
+    if (time > current->times[frame]) {
+        if (frame + 1 < frameCount) {
+            following = current;
+            followingFrame = frame + 1;
+            followingFrameCount = frameCount;
+        }
+        else if (chunk + 1 < archive.getChunkCount()) {
+            following = chunkFor(chunk + 1);
+            followingFrameCount = archive.getChunk(chunk + 1).frameCount;
+            followingBodyCount = archive.getChunk(chunk + 1).bodyCount;
+            if (archive.getChunkBodyTable(chunk + 1) != archive.getChunkBodyTable(chunk)) {
+                followingIndex = &remapToNextChunk(chunk);
+            }
+        }
+    }
+
+    samples.resize(bodyCount);
+    for (std::size_t body = 0; body < bodyCount; ++body) {
+        TrajectorySample sample = readSample(current->values, body, frame, bodyCount, frameCount);
+        const std::uint32_t nextBody = followingIndex ? (*followingIndex)[body] : static_cast<std::uint32_t>(body);
+        if (following && nextBody != UINT32_MAX) {
+            const TrajectorySample next = readSample(following->values, nextBody, followingFrame, followingBodyCount, followingFrameCount);
+            sample = interpolateHermite(current->times[frame], sample, following->times[followingFrame], next, time);
+        }
+        samples[body] = sample;
+    }
+    return archive.getChunkBodyNames(chunk);
+}
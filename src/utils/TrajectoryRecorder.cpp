@@ -0,0 +1,283 @@
+
+#include <utils/TrajectoryRecorder.h>
+#include <celestial/SolarSystemModel.h>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Utilities;
+
+namespace {
+
+    // How long the writer sleeps when it finds the queue empty
+    constexpr std::chrono::milliseconds WRITER_IDLE_WAIT(1);
+
+    inline std::uint64_t packHandle(const SolarSystem::BodyHandle& handle) {
+        return (static_cast<std::uint64_t>(handle.slot) << 32) | handle.generation;
+    }
+}
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string& path, const TrajectoryRecorderSettings& settings)
+    : settings(settings), filled(settings.bufferedFrames), recycled(settings.bufferedFrames) {
+
+    if (settings.interval == 0 || settings.framesPerChunk == 0 || settings.bufferedFrames == 0) {
+        throw std::runtime_error("Trajectory recorder interval, chunk size and buffer size must be positive.");
+    }
+    if (!TrajectoryCodec::isAvailable(settings.compression)) {
+        throw std::runtime_error("Trajectory compression is not available in this build.");
+    }
+
+    output.open(path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + path);
+    }
+
+    TrajectoryFileHeader header = {};
+    std::memcpy(header.magic, TrajectoryCodec::MAGIC, sizeof(header.magic));
+    header.version = TrajectoryCodec::VERSION;
+    header.byteOrderMark = TrajectoryCodec::BYTE_ORDER_MARK;
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytesWritten += sizeof(header);
+
+    snapshots.resize(settings.bufferedFrames);
+    for (Snapshot& snapshot : snapshots) {
+        Snapshot* pointer = &snapshot;
+        recycled.tryPush(std::move(pointer));
+    }
+
+    writer = std::thread([this] { writerLoop(); });
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+    try {
+        close();
+    }
+    catch (const std::exception&) {
+        // Destructors cannot report a failed write, call close() to see it
+    }
+}
+
+bool TrajectoryRecorder::capture(const SolarSystem::SolarSystemModel& model, double simulationTime) {
+    if (closed || stepsSeen++ % settings.interval != 0) {
+        return false;
+    }
+    // Small steps added to a large simulation time can round away entirely
+    if (!(simulationTime > lastQueuedTime)) {
+        return false;
+    }
+
+    Snapshot* snapshot = nullptr;
+    if (!recycled.tryPop(snapshot)) {
+        if (settings.dropWhenFull) {
+            ++framesDropped;
+            return false;
+        }
+        while (!recycled.tryPop(snapshot)) {
+            std::this_thread::yield();
+        }
+    }
+
+    const auto& bodies = model.getCelestialBodies();
+    const SolarSystem::BodyRegistry& registry = model.getBodyRegistry();
+    const std::size_t bodyCount = bodies.size();
+
+    // Handles change exactly when a body is added or removed, which is far cheaper to test than the names
+    bool bodiesChanged = !bodyTableQueued || recordedHandles.size() != bodyCount;
+    for (std::size_t i = 0; i < bodyCount && !bodiesChanged; ++i) {
+        bodiesChanged = recordedHandles[i] != packHandle(registry.handleAt(i));
+    }
+
+    snapshot->time = simulationTime;
+    lastQueuedTime = simulationTime;
+    snapshot->bodyCount = bodyCount;
+    snapshot->bodiesChanged = bodiesChanged;
+    snapshot->columns.resize(TrajectoryCodec::COLUMN_COUNT * bodyCount);
+
+    double* positionX = snapshot->columns.data();
+    double* positionY = positionX + bodyCount;
+    double* positionZ = positionY + bodyCount;
+    double* velocityX = positionZ + bodyCount;
+    double* velocityY = velocityX + bodyCount;
+    double* velocityZ = velocityY + bodyCount;
+    for (std::size_t i = 0; i < bodyCount; ++i) {
+        const Vector& position = bodies[i]->getCurrentPosition();
+        const Vector& velocity = bodies[i]->getVelocity();
+        positionX[i] = position.getX();
+        positionY[i] = position.getY();
+        positionZ[i] = position.getZ();
+        velocityX[i] = velocity.getX();
+        velocityY[i] = velocity.getY();
+        velocityZ[i] = velocity.getZ();
+    }
+
+    if (bodiesChanged) {
+        snapshot->names.clear();
+        recordedHandles.resize(bodyCount);
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            snapshot->names.push_back(bodies[i]->getCelestialBodyName());
+            recordedHandles[i] = packHandle(registry.handleAt(i));
+        }
+        bodyTableQueued = true;
+    }
+
+    // Never fails, the queue holds every snapshot there is
+    filled.tryPush(std::move(snapshot));
+    return true;
+}
+
+void TrajectoryRecorder::close() {
+    if (closed) {
+        return;
+    }
+    closed = true;
+
+    stopping.store(true);
+    if (writer.joinable()) {
+        writer.join();
+    }
+    output.close();
+
+    if (writerError) {
+        std::rethrow_exception(writerError);
+    }
+}
+
+void TrajectoryRecorder::writerLoop() {
+    auto process = [this](Snapshot* snapshot) {
+        // After a failed write the remaining frames are only recycled, close() reports the error
+        if (!writerError) {
+            try {
+                appendFrame(*snapshot);
+            }
+            catch (...) {
+                writerError = std::current_exception();
+            }
+        }
+        recycled.tryPush(std::move(snapshot));
+    };
+
+    Snapshot* snapshot = nullptr;
+    for (;;) {
+        if (filled.tryPop(snapshot)) {
+            process(snapshot);
+            continue;
+        }
+        // Every frame queued before stopping was set is visible once stopping is
+        if (stopping.load()) {
+            while (filled.tryPop(snapshot)) {
+                process(snapshot);
+            }
+            break;
+        }
+        std::this_thread::sleep_for(WRITER_IDLE_WAIT);
+    }
+
+    if (!writerError) {
+        try {
+            flushChunk();
+            writeIndex();
+            output.flush();
+            if (!output) {
+                throw std::runtime_error("Could not write trajectory file.");
+            }
+        }
+        catch (...) {
+            writerError = std::current_exception();
+        }
+    }
+}
+
+void TrajectoryRecorder::appendFrame(const Snapshot& snapshot) {
+    if (snapshot.bodiesChanged) {
+        // A chunk never spans two body tables
+        flushChunk();
+        TrajectoryCodec::encodeBodyTable(snapshot.names, encoded);
+        bodyTableOffset = writeBlock(TrajectoryBlockType::BodyTable, TrajectoryCompression::None, nullptr, 0, encoded, encoded.size());
+    }
+
+    if (chunkHeader.frameCount == 0) {
+        chunkHeader.firstTime = snapshot.time;
+        chunkHeader.firstFrame = nextFrame;
+        chunkHeader.bodyCount = static_cast<std::uint32_t>(snapshot.bodyCount);
+        chunkTimes.clear();
+        chunkFrames.clear();
+    }
+
+    chunkTimes.push_back(snapshot.time);
+    chunkFrames.insert(chunkFrames.end(), snapshot.columns.begin(), snapshot.columns.end());
+    chunkHeader.lastTime = snapshot.time;
+    ++chunkHeader.frameCount;
+    ++nextFrame;
+    ++framesRecorded;
+
+    if (chunkHeader.frameCount == settings.framesPerChunk) {
+        flushChunk();
+    }
+}
+
+void TrajectoryRecorder::flushChunk() {
+    const std::size_t frameCount = chunkHeader.frameCount;
+    if (frameCount == 0) {
+        return;
+    }
+
+    // Frames arrive one after another, encoding wants every body's series over the chunk contiguous
+    const std::size_t seriesCount = TrajectoryCodec::COLUMN_COUNT * chunkHeader.bodyCount;
+    chunkValues.resize(seriesCount * frameCount);
+    for (std::size_t frame = 0; frame < frameCount; ++frame) {
+        const double* values = chunkFrames.data() + frame * seriesCount;
+        for (std::size_t series = 0; series < seriesCount; ++series) {
+            chunkValues[series * frameCount + frame] = values[series];
+        }
+    }
+
+    const std::size_t rawSize = TrajectoryCodec::encodeChunk(chunkHeader, chunkTimes.data(), chunkValues.data(), settings.compression, encodeScratch, encoded);
+    const std::uint64_t chunkOffset = writeBlock(TrajectoryBlockType::Chunk, settings.compression, &chunkHeader, sizeof(chunkHeader), encoded, rawSize);
+
+    index.push_back({ chunkHeader.firstTime, chunkHeader.lastTime, chunkHeader.firstFrame, chunkHeader.frameCount, chunkHeader.bodyCount,
+        chunkOffset, bodyTableOffset });
+    chunkHeader = TrajectoryChunkHeader{};
+}
+
+void TrajectoryRecorder::writeIndex() {
+    const unsigned char* entries = reinterpret_cast<const unsigned char*>(index.data());
+    encoded.assign(entries, entries + index.size() * sizeof(TrajectoryIndexEntry));
+
+    TrajectoryFileFooter footer = {};
+    footer.indexOffset = writeBlock(TrajectoryBlockType::Index, TrajectoryCompression::None, nullptr, 0, encoded, encoded.size());
+    footer.chunkCount = index.size();
+    std::memcpy(footer.magic, TrajectoryCodec::FOOTER_MAGIC, sizeof(footer.magic));
+
+    output.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    if (!output) {
+        throw std::runtime_error("Could not write trajectory file.");
+    }
+    bytesWritten += sizeof(footer);
+}
+
+std::uint64_t TrajectoryRecorder::writeBlock(TrajectoryBlockType type, TrajectoryCompression compression, const void* prefix, std::size_t prefixSize,
+    const std::vector<unsigned char>& payload, std::size_t rawSize) {
+
+    TrajectoryBlockHeader header = {};
+    header.type = static_cast<std::uint32_t>(type);
+    header.compression = static_cast<std::uint32_t>(compression);
+    header.storedSize = prefixSize + payload.size();
+    header.rawSize = rawSize;
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (prefixSize > 0) {
+        output.write(static_cast<const char*>(prefix), static_cast<std::streamsize>(prefixSize));
+    }
+    output.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+    // Keeps the next block aligned for readers that use chunks in place
+    const std::uint64_t offset = bytesWritten.load();
+    const std::uint64_t end = offset + sizeof(header) + header.storedSize;
+    const char padding[TrajectoryCodec::BLOCK_ALIGNMENT] = {};
+    output.write(padding, static_cast<std::streamsize>(TrajectoryCodec::alignBlock(end) - end));
+    if (!output) {
+        throw std::runtime_error("Could not write trajectory file.");
+    }
+    bytesWritten = TrajectoryCodec::alignBlock(end);
+    return offset;
+}
@@ -0,0 +1,89 @@
+
+#include <utils/TrajectoryRenderer.h>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Utilities;
+
+namespace {
+
+    // Bodies no catalog describes are drawn as asteroids, sprites of no radius in this colour
+    const glm::vec3 SMALL_BODY_COLOR(0.6f, 0.58f, 0.55f);
+}
+
+void TrajectoryRenderer::initialize(GLuint shaderProgram) {
+    if (!sphereRenderer.isInitialized()) {
+        sphereRenderer.initialize(shaderProgram);
+    }
+    pointSpriteRenderer.initialize();
+}
+
+void TrajectoryRenderer::shutdown() {
+    sphereRenderer.shutdown();
+    pointSpriteRenderer.shutdown();
+}
+
+void TrajectoryRenderer::setAppearance(const std::string& name, float radius, const glm::vec3& color) {
+    appearances[name] = Appearance{ radius, color };
+    appearancesChanged = true;
+}
+
+std::size_t TrajectoryRenderer::addAppearances(const std::vector<CelestialBodyRecord>& records) {
+    for (const CelestialBodyRecord& record : records) {
+        // The colour belongs to the body class, which only the factory for the record's type knows
+        const std::unique_ptr<SolarSystem::CelestialBody> body = CelestialBodyJSONLoader::CreateBody(record);
+        setAppearance(record.name, static_cast<float>(record.radius), body->getColor());
+    }
+    return records.size();
+}
+
+void TrajectoryRenderer::mapAppearances(const std::vector<std::string>& names) {
+    if (&names == mappedNames && !appearancesChanged) {
+        return;
+    }
+    mappedAppearances.assign(names.size(), Appearance{ 0.0f, SMALL_BODY_COLOR });
+    for (std::size_t body = 0; body < names.size(); ++body) {
+        auto found = appearances.find(names[body]);
+        if (found != appearances.end()) {
+            mappedAppearances[body] = found->second;
+        }
+    }
+    mappedNames = &names;
+    appearancesChanged = false;
+}
+
+void TrajectoryRenderer::draw(TrajectoryPlayer& player, const glm::mat4& view, const glm::mat4& projection) {
+    const std::vector<std::string>& names = player.sample(samples);
+    mapAppearances(names);
+
+    // A sphere of radius r at view depth d covers r / d * projection[1][1] of the half viewport height
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const float pixelsPerUnitAtUnitDepth = projection[1][1] * 0.5f * static_cast<float>(viewport[3]);
+
+    sprites.clear();
+    meshCount = 0;
+    for (std::size_t body = 0; body < samples.size(); ++body) {
+        const Vector& position = samples[body].position;
+        const Appearance& appearance = mappedAppearances[body];
+        const glm::vec3 worldPosition(static_cast<float>(position.getX()), static_cast<float>(position.getY()), static_cast<float>(position.getZ()));
+        const glm::vec4 viewPosition = view * glm::vec4(worldPosition, 1.0f);
+        const float radius = appearance.radius;
+        const float depth = std::abs(viewPosition.z);
+
+        // The camera inside or touching the sphere gets the finest mesh
+        const float pixelRadius = depth > radius ? radius / depth * pixelsPerUnitAtUnitDepth : std::numeric_limits<float>::max();
+        if (pixelRadius < PointSpriteRenderer::MESH_PIXEL_RADIUS) {
+            // In view space, already at hand, so the sprites are drawn with an identity view
+            sprites.push_back(PointSprite{ viewPosition.x, viewPosition.y, viewPosition.z, radius, PointSpriteRenderer::packColor(appearance.color) });
+        }
+        else {
+            const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), worldPosition), glm::vec3(radius, radius, radius));
+            sphereRenderer.addLevelOfDetail(model, appearance.color, pixelRadius);
+            ++meshCount;
+        }
+    }
+    sphereRenderer.draw(view, projection);
+    pointSpriteRenderer.draw(sprites.data(), sprites.size(), glm::mat4(1.0f), projection);
+}
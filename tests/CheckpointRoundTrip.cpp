@@ -0,0 +1,184 @@
+// Checks that a restart resumes bit for bit: a run is checkpointed, written, read back and restored into a new
+// model, and both models must then step to identical states with every integrator. The continued run is also
+// recorded, and the trajectory archive has to return every recorded state exactly at its frame time.
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <celestial/SolarSystemModel.h>
+#include <celestial/Star.h>
+#include <celestial/Planet.h>
+#include <celestial/Asteroid.h>
+#include <utils/CheckpointFile.h>
+#include <utils/TrajectoryArchive.h>
+#include <utils/TrajectoryRecorder.h>
+
+namespace {
+
+    constexpr float TIMESTEP = 3600.0f;
+    constexpr float FPS = 30.0f;
+    constexpr int STEPS_BEFORE_CHECKPOINT = 40;
+    constexpr int STEPS_AFTER_CHECKPOINT = 100;
+
+    // Puts the Earth and Moon in an encounter, as in SteadyStateAllocations
+    constexpr double ENCOUNTER_RATIO = 128.0;
+
+    // Small enough that the recording spans several chunks
+    constexpr std::size_t FRAMES_PER_CHUNK = 16;
+
+    void addBodies(SolarSystem::SolarSystemModel& model) {
+        const double earthSpeed = 29.78;
+        model.reserveCelestialBodies(6);
+        model.emplaceCelestialBody<SolarSystem::Star>(1.989e30, Utilities::Vector(0, 0, 0), 696340.0, "Sun", Utilities::Vector(0, 0, 0), 0.0, 3.828e26, 5772.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(3.301e23, Utilities::Vector(0, 47.36, 0), 2439.7, "Mercury", Utilities::Vector(5.79e7, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(5.972e24, Utilities::Vector(0, earthSpeed, 0), 6371.0, "Earth", Utilities::Vector(1.496e8, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(7.342e22, Utilities::Vector(0, earthSpeed + 1.022, 0), 1737.4, "Moon", Utilities::Vector(1.496e8 + 384400.0, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(1.898e27, Utilities::Vector(0, 13.07, 0), 69911.0, "Jupiter", Utilities::Vector(7.785e8, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Asteroid>(9.39e20, Utilities::Vector(0, 17.9, 0), 473.0, "Ceres", Utilities::Vector(4.14e8, 0, 0), 0.0);
+    }
+
+    bool sameVector(const Utilities::Vector& a, const Utilities::Vector& b) {
+        return a.getX() == b.getX() && a.getY() == b.getY() && a.getZ() == b.getZ();
+    }
+
+    // Returns the name of the first body whose state differs, or an empty string
+    std::string firstDifference(const SolarSystem::SolarSystemModel& expected, const SolarSystem::SolarSystemModel& actual) {
+        const auto& expectedBodies = expected.getCelestialBodies();
+        const auto& actualBodies = actual.getCelestialBodies();
+        if (expectedBodies.size() != actualBodies.size()) {
+            return "the body count";
+        }
+        for (std::size_t i = 0; i < expectedBodies.size(); ++i) {
+            if (expectedBodies[i]->getCelestialBodyName() != actualBodies[i]->getCelestialBodyName()
+                || !sameVector(expectedBodies[i]->getCurrentPosition(), actualBodies[i]->getCurrentPosition())
+                || !sameVector(expectedBodies[i]->getVelocity(), actualBodies[i]->getVelocity())) {
+                return expectedBodies[i]->getCelestialBodyName();
+            }
+        }
+        return std::string();
+    }
+
+    struct RecordedState {
+        double time;
+        std::string name;
+        Utilities::Vector position;
+        Utilities::Vector velocity;
+    };
+
+    // Number of recorded states the archive does not return exactly
+    int countArchiveMismatches(const std::string& path, const std::vector<RecordedState>& states) {
+        Utilities::TrajectoryArchive archive(path);
+        if (archive.getChunkCount() < 2) {
+            std::cerr << "The recording fits in one chunk, chunk boundaries went unchecked" << std::endl;
+            return 1;
+        }
+
+        int mismatches = 0;
+        Utilities::TrajectorySample sample;
+        for (const RecordedState& state : states) {
+            if (!archive.sample(state.name, state.time, sample) || !sameVector(sample.position, state.position) || !sameVector(sample.velocity, state.velocity)) {
+                ++mismatches;
+            }
+        }
+        // Between two frames the answer comes from interpolation, it only has to exist
+        if (!archive.sample(states.front().name, 0.5 * (states.front().time + states.back().time), sample)) {
+            ++mismatches;
+        }
+        return mismatches;
+    }
+}
+
+int main() {
+    struct Configuration {
+        std::string name;
+        SolarSystem::IntegrationMethod method;
+        bool closeEncounters;
+    };
+    const Configuration configurations[] = {
+        { "kinematic", SolarSystem::IntegrationMethod::Kinematic, false },
+        { "Adams-Bashforth-Moulton", SolarSystem::IntegrationMethod::AdamsBashforthMoulton, false },
+        { "Adams-Bashforth-Moulton with close encounters", SolarSystem::IntegrationMethod::AdamsBashforthMoulton, true },
+    };
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string checkpointPath = (directory / "CheckpointRoundTrip.checkpoint").string();
+    const std::string recordingPath = (directory / "CheckpointRoundTrip.trajectory").string();
+
+    int failures = 0;
+    for (const Configuration& configuration : configurations) {
+        SolarSystem::SolarSystemModel original;
+        addBodies(original);
+        original.setIntegrationMethod(configuration.method, 10);
+        original.setCloseEncounterHandling(configuration.closeEncounters, ENCOUNTER_RATIO);
+
+        double simulationTime = 0.0;
+        for (int step = 0; step < STEPS_BEFORE_CHECKPOINT; ++step) {
+            original.advance(TIMESTEP, FPS);
+            simulationTime += TIMESTEP;
+        }
+
+        SolarSystem::ModelCheckpoint checkpoint = original.captureCheckpoint();
+        checkpoint.simulationTime = simulationTime;
+        Utilities::CheckpointFile::Write(checkpoint, checkpointPath);
+        const SolarSystem::ModelCheckpoint restoredCheckpoint = Utilities::CheckpointFile::Read(checkpointPath);
+        SolarSystem::SolarSystemModel restored;
+        restored.restoreCheckpoint(restoredCheckpoint);
+        if (restoredCheckpoint.simulationTime != simulationTime) {
+            std::cerr << configuration.name << ": the simulation time did not survive the checkpoint" << std::endl;
+            ++failures;
+        }
+
+        Utilities::TrajectoryRecorderSettings recorderSettings;
+        recorderSettings.framesPerChunk = FRAMES_PER_CHUNK;
+        recorderSettings.dropWhenFull = false;
+        Utilities::TrajectoryRecorder recorder(recordingPath, recorderSettings);
+        std::vector<RecordedState> recordedStates;
+
+        int divergedAt = -1;
+        std::string divergedBody;
+        for (int step = 0; step < STEPS_AFTER_CHECKPOINT; ++step) {
+            original.advance(TIMESTEP, FPS);
+            restored.advance(TIMESTEP, FPS);
+            simulationTime += TIMESTEP;
+            if (divergedAt < 0) {
+                divergedBody = firstDifference(original, restored);
+                divergedAt = divergedBody.empty() ? -1 : step;
+            }
+
+            recorder.capture(original, simulationTime);
+            for (const auto& body : original.getCelestialBodies()) {
+                recordedStates.push_back(RecordedState{ simulationTime, body->getCelestialBodyName(), body->getCurrentPosition(), body->getVelocity() });
+            }
+        }
+        recorder.close();
+
+        if (divergedAt >= 0) {
+            std::cerr << configuration.name << ": " << divergedBody << " diverged " << divergedAt + 1 << " steps after the restart" << std::endl;
+            ++failures;
+        }
+        else {
+            std::cout << configuration.name << ": identical for " << STEPS_AFTER_CHECKPOINT << " steps after the restart" << std::endl;
+        }
+
+        const int mismatches = countArchiveMismatches(recordingPath, recordedStates);
+        if (mismatches != 0) {
+            std::cerr << configuration.name << ": " << mismatches << " archive queries did not return the recorded state" << std::endl;
+            ++failures;
+        }
+    }
+
+    // A checkpoint cut short has to be refused rather than restored with missing state
+    std::filesystem::resize_file(checkpointPath, std::filesystem::file_size(checkpointPath) / 2);
+    try {
+        Utilities::CheckpointFile::Read(checkpointPath);
+        std::cerr << "A truncated checkpoint was read without an error" << std::endl;
+        ++failures;
+    }
+    catch (const std::exception&) {
+    }
+
+    std::filesystem::remove(checkpointPath);
+    std::filesystem::remove(recordingPath);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
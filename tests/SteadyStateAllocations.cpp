@@ -0,0 +1,99 @@
+
+// Checks that once warmed up, advance() makes no heap allocations with any integrator. Built by CMakeLists.txt
+// with SOLAR_SYSTEM_COUNT_ALLOCATIONS, so AllocationCounter sees every call to the global operator new.
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <celestial/SolarSystemModel.h>
+#include <celestial/Star.h>
+#include <celestial/Planet.h>
+#include <celestial/Asteroid.h>
+#include <utils/AllocationCounter.h>
+#include <utils/UtilitiesNamespace.h>
+
+namespace {
+
+    constexpr float TIMESTEP = 3600.0f;
+    constexpr float FPS = 30.0f;
+    constexpr int WARM_UP_STEPS = 64;
+    constexpr int MEASURED_STEPS = 256;
+
+    // Puts the Earth and Moon, about 4.3 days of dynamical time apart, in an encounter and nothing else
+    constexpr double ENCOUNTER_RATIO = 128.0;
+
+    // Ceres and the Moon are there so a small body and a close pair are always part of the step
+    void addBodies(SolarSystem::SolarSystemModel& model) {
+        const double earthSpeed = 29.78;
+        model.reserveCelestialBodies(6);
+        model.emplaceCelestialBody<SolarSystem::Star>(1.989e30, Utilities::Vector(0, 0, 0), 696340.0, "Sun", Utilities::Vector(0, 0, 0), 0.0, 3.828e26, 5772.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(3.301e23, Utilities::Vector(0, 47.36, 0), 2439.7, "Mercury", Utilities::Vector(5.79e7, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(5.972e24, Utilities::Vector(0, earthSpeed, 0), 6371.0, "Earth", Utilities::Vector(1.496e8, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(7.342e22, Utilities::Vector(0, earthSpeed + 1.022, 0), 1737.4, "Moon", Utilities::Vector(1.496e8 + 384400.0, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Planet>(1.898e27, Utilities::Vector(0, 13.07, 0), 69911.0, "Jupiter", Utilities::Vector(7.785e8, 0, 0), 0.0);
+        model.emplaceCelestialBody<SolarSystem::Asteroid>(9.39e20, Utilities::Vector(0, 17.9, 0), 473.0, "Ceres", Utilities::Vector(4.14e8, 0, 0), 0.0);
+    }
+
+    // Advances past the warm up, then returns the allocations made by the measured steps
+    std::size_t measureAllocations(SolarSystem::SolarSystemModel& model) {
+        for (int step = 0; step < WARM_UP_STEPS; ++step) {
+            model.advance(TIMESTEP, FPS);
+        }
+        const std::size_t before = Utilities::AllocationCounter::getCount();
+        for (int step = 0; step < MEASURED_STEPS; ++step) {
+            model.advance(TIMESTEP, FPS);
+        }
+        return Utilities::AllocationCounter::getCount() - before;
+    }
+}
+
+int main() {
+    if (!Utilities::AllocationCounter::isEnabled()) {
+        std::cerr << "Build with SOLAR_SYSTEM_COUNT_ALLOCATIONS to count allocations" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    struct Configuration {
+        std::string name;
+        SolarSystem::IntegrationMethod method;
+        bool closeEncounters;
+    };
+    const Configuration configurations[] = {
+        { "kinematic", SolarSystem::IntegrationMethod::Kinematic, false },
+        { "Adams-Bashforth-Moulton", SolarSystem::IntegrationMethod::AdamsBashforthMoulton, false },
+        { "Adams-Bashforth-Moulton with close encounters", SolarSystem::IntegrationMethod::AdamsBashforthMoulton, true },
+    };
+
+    // Makes sure the counter really sees the heap before trusting a zero from it. Stored through a volatile
+    // pointer, the optimizer would otherwise drop the unused new and delete pair.
+    const std::size_t probe = Utilities::AllocationCounter::getCount();
+    int* volatile probeAllocation = new int(0);
+    delete probeAllocation;
+    if (Utilities::AllocationCounter::getCount() == probe) {
+        std::cerr << "The counting operator new is not linked in" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+    for (const Configuration& configuration : configurations) {
+        // Each integrator starts from the same bodies, the kinematic one drifts far from a real orbit
+        SolarSystem::SolarSystemModel model;
+        addBodies(model);
+        model.setIntegrationMethod(configuration.method, 10);
+        model.setCloseEncounterHandling(configuration.closeEncounters, ENCOUNTER_RATIO);
+        const std::size_t allocations = measureAllocations(model);
+        std::cout << configuration.name << ": " << allocations << " allocations in " << MEASURED_STEPS << " steps" << std::endl;
+        failures += allocations == 0 ? 0 : 1;
+
+        if (configuration.closeEncounters) {
+            std::size_t encounterBodies = 0;
+            for (const auto& group : model.getCloseEncounterGroups()) {
+                encounterBodies += group.size() > 1 ? group.size() : 0;
+            }
+            if (encounterBodies == 0) {
+                std::cerr << "No close encounter was open, the encounter path went unmeasured" << std::endl;
+                ++failures;
+            }
+        }
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}